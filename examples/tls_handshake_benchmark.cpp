@@ -0,0 +1,143 @@
+/*
+ * Example: TLS handshake benchmark against a local MQTT broker
+ *
+ * Compares connect latency and peak heap use of a full TLS handshake with
+ * a resumed one (BearSSL session), with and without MFLN-sized buffers.
+ * Each round is TLS connect + MQTT CONNECT, like RemoteDataSource::connect().
+ *
+ * Broker side, e.g. mosquitto with a self-signed CA:
+ *   listener 8883
+ *   cafile   ca.crt
+ *   certfile server.crt
+ *   keyfile  server.key
+ * Paste ca.crt into BENCH_BROKER_CA to also time certificate validation;
+ * without it the handshake is run with setInsecure().
+ */
+
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+#include <umm_malloc/umm_malloc.h>
+
+#include "../lib/env.h"
+#include "../src/hal/arduino/arduino_hal.h"
+#include "../src/data/mqtt/mqtt_client.h"
+
+#ifndef BENCH_BROKER_HOST
+#define BENCH_BROKER_HOST "192.168.1.10"
+#endif
+#ifndef BENCH_BROKER_PORT
+#define BENCH_BROKER_PORT 8883
+#endif
+#ifndef BENCH_ROUNDS
+#define BENCH_ROUNDS 5
+#endif
+#ifndef BENCH_MFLN_SIZE
+#define BENCH_MFLN_SIZE 1024
+#endif
+
+#ifdef BENCH_BROKER_CA
+BearSSL::X509List brokerCa(BENCH_BROKER_CA);
+#endif
+
+struct BenchResult
+{
+    uint32_t totalMs = 0;
+    uint32_t worstMs = 0;
+    uint32_t peakHeap = 0; // Largest drop below the free heap before connecting
+    int failures = 0;
+};
+
+// One TLS + MQTT connect; session is nullptr for a full handshake
+static bool connectOnce(BearSSL::Session *session, bool mfln, BenchResult &result)
+{
+    ArduinoNetworkClient network;
+    WiFiClientSecure &client = network.secure();
+#ifdef BENCH_BROKER_CA
+    client.setTrustAnchors(&brokerCa);
+    client.setX509Time(time(nullptr));
+#else
+    client.setInsecure();
+#endif
+    client.setBufferSizes(mfln ? BENCH_MFLN_SIZE : 16384, BENCH_MFLN_SIZE);
+    if (session)
+        client.setSession(session);
+
+    MqttClient mqtt(network);
+    mqtt.setServer(BENCH_BROKER_HOST, BENCH_BROKER_PORT);
+
+    uint32_t heapBefore = ESP.getFreeHeap();
+    umm_free_heap_size_min_reset();
+    uint32_t started = millis();
+
+    bool connected = mqtt.connect("tls-bench");
+
+    uint32_t elapsed = millis() - started;
+    uint32_t peak = heapBefore - umm_free_heap_size_min();
+    mqtt.disconnect();
+
+    if (!connected)
+    {
+        result.failures++;
+        return false;
+    }
+    result.totalMs += elapsed;
+    if (elapsed > result.worstMs)
+        result.worstMs = elapsed;
+    if (peak > result.peakHeap)
+        result.peakHeap = peak;
+    return true;
+}
+
+static void runCase(const char *name, bool resume, bool mfln)
+{
+    BenchResult result;
+    BearSSL::Session session;
+
+    // A resumed run needs one full handshake to obtain the session
+    if (resume)
+        connectOnce(&session, mfln, result);
+    result = BenchResult();
+
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+        connectOnce(resume ? &session : nullptr, mfln, result);
+
+    int ok = BENCH_ROUNDS - result.failures;
+    Serial.printf("%-18s avg %5lu ms  worst %5lu ms  peak heap %6lu B  failures %d\n", name,
+                  ok ? (unsigned long)(result.totalMs / ok) : 0UL, (unsigned long)result.worstMs,
+                  (unsigned long)result.peakHeap, result.failures);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    Serial.println("\nTLS handshake benchmark");
+
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    while (WiFi.status() != WL_CONNECTED)
+        delay(100);
+
+#ifdef BENCH_BROKER_CA
+    // Certificate validity needs the real time
+    configTime(0, 0, "pool.ntp.org");
+    while (time(nullptr) < 1600000000)
+        delay(100);
+#endif
+
+    bool mflnSupported = WiFiClientSecure::probeMaxFragmentLength(BENCH_BROKER_HOST, BENCH_BROKER_PORT,
+                                                                  BENCH_MFLN_SIZE);
+    Serial.printf("Broker %s:%d, MFLN %d %s\n", BENCH_BROKER_HOST, BENCH_BROKER_PORT, BENCH_MFLN_SIZE,
+                  mflnSupported ? "supported" : "not supported");
+
+    runCase("full", false, false);
+    runCase("resumed", true, false);
+    if (mflnSupported)
+    {
+        runCase("full + MFLN", false, true);
+        runCase("resumed + MFLN", true, true);
+    }
+}
+
+void loop()
+{
+}
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Decode TraceBuffer dumps (src/utils/trace.h) back to text.
+
+Input is either the serial "trace" command output (lines "TRACE <hex>",
+other lines are ignored) or raw binary dumps as published by the
+"dumpTrace" direct method, several of them concatenated:
+
+    pio device monitor | tee serial.log
+    python3 scripts/decode_trace.py serial.log
+    python3 scripts/decode_trace.py --binary trace.bin
+
+Event names and formats come from src/utils/trace_events.def, so the
+decoder must read the .def of the firmware that made the dump.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+MAGIC = 0x31435254  # "TRC1"
+HEADER = struct.Struct("<IHHII")
+RECORD = struct.Struct("<IHBB4I")
+
+DEFAULT_DEF = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src", "utils", "trace_events.def")
+EVENT_LINE = re.compile(r'^TRACE_EVENT\(\s*(\w+)\s*,\s*(\w+)\s*,\s*(\w+)\s*,\s*"(.*)"\s*\)\s*$')
+
+
+def load_events(path):
+    """Events in id order, as (name, module, level, format)."""
+    events = []
+    with open(path) as f:
+        for line in f:
+            match = EVENT_LINE.match(line.strip())
+            if match:
+                events.append(match.groups())
+    return events
+
+
+def argument(raw, kind):
+    if kind == 0:
+        return struct.unpack("<i", struct.pack("<I", raw))[0]
+    if kind == 2:
+        return struct.unpack("<f", struct.pack("<I", raw))[0]
+    return raw
+
+
+def format_record(events, record, now_ms):
+    timestamp, event, count, types, *raw = RECORD.unpack(record)
+    args = [argument(raw[i], (types >> (i * 2)) & 3) for i in range(min(count, 4))]
+    age = "{:>9.3f}s".format((timestamp - now_ms) / 1000.0) if now_ms is not None else ""
+
+    if event >= len(events):
+        return "{:>10} {} unknown event {} {}".format(timestamp, age, event, args)
+    name, module, level, fmt = events[event]
+    try:
+        text = fmt.format(*args)
+    except (IndexError, ValueError):
+        text = "{} {}".format(fmt, args)
+    return "{:>10} {} {:<5} {:<4} {:<20} {}".format(timestamp, age, level, module, name, text)
+
+
+def decode(events, data, out):
+    """Decodes concatenated dumps; returns the number of records."""
+    offset = 0
+    total = 0
+    while offset + HEADER.size <= len(data):
+        magic, record_size, count, dropped, now_ms = HEADER.unpack_from(data, offset)
+        if magic != MAGIC or record_size != RECORD.size:
+            raise ValueError("no trace header at byte {}".format(offset))
+        offset += HEADER.size
+
+        out.write("-- dump at {} ms, {} records, {} overwritten before it\n".format(now_ms, count, dropped))
+        for _ in range(count):
+            if offset + RECORD.size > len(data):
+                out.write("-- dump cut short\n")
+                return total
+            out.write(format_record(events, data[offset:offset + RECORD.size], now_ms) + "\n")
+            offset += RECORD.size
+            total += 1
+    return total
+
+
+def hex_lines(text):
+    data = bytearray()
+    for line in text.splitlines():
+        line = line.strip()
+        if line.startswith("TRACE "):
+            data += bytes.fromhex(line[6:])
+    return bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", nargs="?", help="dump file (default stdin)")
+    parser.add_argument("--binary", action="store_true", help="input is raw binary dumps")
+    parser.add_argument("--events", default=DEFAULT_DEF, help="trace_events.def to decode with")
+    options = parser.parse_args()
+
+    events = load_events(options.events)
+    if options.binary:
+        stream = open(options.input, "rb") if options.input else sys.stdin.buffer
+        data = stream.read()
+    else:
+        stream = open(options.input) if options.input else sys.stdin
+        data = hex_lines(stream.read())
+
+    if decode(events, data, sys.stdout) == 0:
+        sys.stderr.write("no trace records found\n")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Default token lifetime; connect() refreshes SAS_TOKEN_REFRESH_MARGIN_S early
+#ifndef SAS_TOKEN_TTL_S
+#define SAS_TOKEN_TTL_S 3600
+#endif
+
+#ifndef SAS_TOKEN_REFRESH_MARGIN_S
+#define SAS_TOKEN_REFRESH_MARGIN_S 300
+#endif
+
+// Azure IoT Hub shared access signature, signed on the device with
+// HMAC-SHA256 (mbedTLS). Same algorithm as generate_token.py:
+//   sr  = urlencode(<host>/devices/<id>).lower()
+//   sig = urlencode(base64(HMAC(base64decode(key), sr + "\n" + se)))
+class SasToken
+{
+public:
+    static const size_t MAX_LENGTH = 256;
+
+    // Writes "SharedAccessSignature sr=...&sig=...&se=..." into out.
+    // expiresAt is absolute epoch seconds. Returns the length, or 0 if the
+    // key is not valid base64 or out is too small.
+    static size_t generate(char *out, size_t capacity, const char *resourceUri, const char *base64Key,
+                           uint32_t expiresAt);
+
+    // The se= field of a token (e.g. one from the backend), 0 if absent
+    static uint32_t expiry(const char *token);
+
+    // Percent-encodes everything but unreserved characters; lowerCase also
+    // folds letters and hex digits, as the token's sr field requires.
+    static size_t urlEncode(char *out, size_t capacity, const char *text, bool lowerCase);
+};
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Minimal CBOR (RFC 8949) subset for telemetry: integers, text strings,
+// definite-length arrays and maps. No heap; the writer fills a caller
+// buffer and the reader walks one in place.
+
+class CborWriter
+{
+private:
+    uint8_t *buffer;
+    size_t capacity;
+    size_t length = 0;
+    bool overflow = false;
+
+    void put(uint8_t byte)
+    {
+        if (length < capacity)
+            buffer[length++] = byte;
+        else
+            overflow = true;
+    }
+
+    void head(uint8_t major, uint64_t value)
+    {
+        major <<= 5;
+        if (value < 24)
+        {
+            put((uint8_t)(major | value));
+        }
+        else if (value <= 0xFF)
+        {
+            put(major | 24);
+            put((uint8_t)value);
+        }
+        else if (value <= 0xFFFF)
+        {
+            put(major | 25);
+            put((uint8_t)(value >> 8));
+            put((uint8_t)value);
+        }
+        else if (value <= 0xFFFFFFFFULL)
+        {
+            put(major | 26);
+            for (int shift = 24; shift >= 0; shift -= 8)
+                put((uint8_t)(value >> shift));
+        }
+        else
+        {
+            put(major | 27);
+            for (int shift = 56; shift >= 0; shift -= 8)
+                put((uint8_t)(value >> shift));
+        }
+    }
+
+public:
+    CborWriter(uint8_t *out, size_t size) : buffer(out), capacity(size) {}
+
+    void writeUint(uint64_t value) { head(0, value); }
+
+    void writeInt(int64_t value)
+    {
+        if (value >= 0)
+            head(0, (uint64_t)value);
+        else
+            head(1, (uint64_t)(-1 - value));
+    }
+
+    void writeText(const char *text, size_t textLength)
+    {
+        head(3, textLength);
+        for (size_t i = 0; i < textLength; i++)
+            put((uint8_t)text[i]);
+    }
+
+    void writeText(const char *text) { writeText(text, strlen(text)); }
+    void writeArray(size_t items) { head(4, items); }
+    void writeMap(size_t pairs) { head(5, pairs); }
+
+    bool ok() const { return !overflow; }
+    size_t size() const { return length; }
+};
+
+class CborReader
+{
+public:
+    enum Major : uint8_t
+    {
+        UINT = 0,
+        NEGINT = 1,
+        BYTES = 2,
+        TEXT = 3,
+        ARRAY = 4,
+        MAP = 5,
+        TAG = 6,
+        SIMPLE = 7
+    };
+
+private:
+    const uint8_t *data;
+    size_t length;
+    size_t position = 0;
+    bool error = false;
+
+    bool head(uint8_t &major, uint64_t &value)
+    {
+        if (position >= length)
+            return fail();
+
+        uint8_t initial = data[position++];
+        major = initial >> 5;
+        uint8_t info = initial & 0x1F;
+
+        if (info < 24)
+        {
+            value = info;
+            return true;
+        }
+        if (info > 27)
+            return fail(); // Indefinite lengths are not used
+
+        size_t bytes = (size_t)1 << (info - 24);
+        if (position + bytes > length)
+            return fail();
+
+        value = 0;
+        for (size_t i = 0; i < bytes; i++)
+            value = (value << 8) | data[position++];
+        return true;
+    }
+
+    bool fail()
+    {
+        error = true;
+        return false;
+    }
+
+public:
+    CborReader(const uint8_t *in, size_t size) : data(in), length(size) {}
+
+    bool ok() const { return !error; }
+    bool atEnd() const { return position >= length; }
+
+    bool peekMajor(uint8_t &major) const
+    {
+        if (position >= length)
+            return false;
+        major = data[position] >> 5;
+        return true;
+    }
+
+    bool readUint(uint64_t &value)
+    {
+        uint8_t major;
+        return head(major, value) && (major == UINT || fail());
+    }
+
+    bool readInt(int64_t &value)
+    {
+        uint8_t major;
+        uint64_t raw;
+        if (!head(major, raw))
+            return false;
+        if (major == UINT)
+            value = (int64_t)raw;
+        else if (major == NEGINT)
+            value = -1 - (int64_t)raw;
+        else
+            return fail();
+        return true;
+    }
+
+    // Copies a text string into out (always NUL terminated, truncated to fit)
+    bool readText(char *out, size_t outSize)
+    {
+        uint8_t major;
+        uint64_t textLength;
+        if (!head(major, textLength) || major != TEXT || position + textLength > length)
+            return fail();
+
+        size_t copy = textLength < outSize - 1 ? (size_t)textLength : outSize - 1;
+        memcpy(out, data + position, copy);
+        out[copy] = '\0';
+        position += (size_t)textLength;
+        return true;
+    }
+
+    bool readArray(size_t &items)
+    {
+        uint8_t major;
+        uint64_t value;
+        if (!head(major, value) || major != ARRAY)
+            return fail();
+        items = (size_t)value;
+        return true;
+    }
+
+    bool readMap(size_t &pairs)
+    {
+        uint8_t major;
+        uint64_t value;
+        if (!head(major, value) || major != MAP)
+            return fail();
+        pairs = (size_t)value;
+        return true;
+    }
+
+    // Skips one complete item, so unknown keys can be ignored
+    bool skip(int depth = 0)
+    {
+        if (depth > 8)
+            return fail();
+
+        uint8_t major;
+        uint64_t value;
+        if (!head(major, value))
+            return false;
+
+        switch (major)
+        {
+        case BYTES:
+        case TEXT:
+            if (position + value > length)
+                return fail();
+            position += (size_t)value;
+            return true;
+        case ARRAY:
+            for (uint64_t i = 0; i < value; i++)
+                if (!skip(depth + 1))
+                    return false;
+            return true;
+        case MAP:
+            for (uint64_t i = 0; i < value * 2; i++)
+                if (!skip(depth + 1))
+                    return false;
+            return true;
+        case TAG:
+            return skip(depth + 1);
+        default:
+            return true;
+        }
+    }
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Minimal JSON emitter into a caller buffer, the text counterpart of
+// CborWriter. Commas are inserted automatically; values with decimals are
+// written from scaled integers so no float formatting is needed. Strings
+// are copied verbatim (callers only pass identifiers and timestamps).
+
+class JsonWriter
+{
+private:
+    static const uint8_t MAX_DEPTH = 4;
+
+    char *buffer;
+    size_t capacity;
+    size_t length = 0;
+    bool overflow = false;
+    uint8_t depth = 0;
+    bool needComma[MAX_DEPTH + 1] = {false};
+
+    void put(char c)
+    {
+        // Keep one byte for the terminator
+        if (length + 1 < capacity)
+            buffer[length++] = c;
+        else
+            overflow = true;
+    }
+
+    void put(const char *text)
+    {
+        while (*text)
+            put(*text++);
+    }
+
+    void putUint(uint32_t value)
+    {
+        char digits[10];
+        uint8_t count = 0;
+        do
+        {
+            digits[count++] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value);
+        while (count)
+            put(digits[--count]);
+    }
+
+    void separator()
+    {
+        if (needComma[depth])
+            put(',');
+        needComma[depth] = true;
+    }
+
+    void open(char c)
+    {
+        separator();
+        put(c);
+        if (depth < MAX_DEPTH)
+            needComma[++depth] = false;
+        else
+            overflow = true;
+    }
+
+    void close(char c)
+    {
+        put(c);
+        if (depth)
+            depth--;
+    }
+
+public:
+    JsonWriter(char *out, size_t size) : buffer(out), capacity(size)
+    {
+        if (capacity)
+            buffer[0] = '\0';
+    }
+
+    void beginObject() { open('{'); }
+    void endObject() { close('}'); }
+    void beginArray() { open('['); }
+    void endArray() { close(']'); }
+
+    // Object member name; the next value call supplies its value
+    void key(const char *name)
+    {
+        separator();
+        put('"');
+        put(name);
+        put("\":");
+        needComma[depth] = false;
+    }
+
+    void writeString(const char *text)
+    {
+        separator();
+        put('"');
+        put(text);
+        put('"');
+    }
+
+    void writeBool(bool value)
+    {
+        separator();
+        put(value ? "true" : "false");
+    }
+
+    void writeUint(uint32_t value)
+    {
+        separator();
+        putUint(value);
+    }
+
+    void writeInt(int32_t value)
+    {
+        separator();
+        if (value < 0)
+        {
+            put('-');
+            putUint((uint32_t)0 - (uint32_t)value);
+        }
+        else
+        {
+            putUint((uint32_t)value);
+        }
+    }
+
+    // value / 10^decimals, e.g. writeFixed(3681, 2) -> 36.81
+    void writeFixed(int32_t value, uint8_t decimals)
+    {
+        separator();
+        uint32_t magnitude = value < 0 ? (uint32_t)0 - (uint32_t)value : (uint32_t)value;
+        if (value < 0)
+            put('-');
+
+        uint32_t divisor = 1;
+        for (uint8_t i = 0; i < decimals; i++)
+            divisor *= 10;
+
+        putUint(magnitude / divisor);
+        if (decimals)
+        {
+            put('.');
+            uint32_t fraction = magnitude % divisor;
+            for (uint32_t place = divisor / 10; place; place /= 10)
+            {
+                put((char)('0' + fraction / place));
+                fraction %= place;
+            }
+        }
+    }
+
+    // NUL terminates and reports whether everything fitted
+    bool finish()
+    {
+        if (capacity)
+            buffer[length < capacity ? length : capacity - 1] = '\0';
+        return ok();
+    }
+
+    bool ok() const { return !overflow && depth == 0; }
+    size_t size() const { return length; }
+};
@@ -0,0 +1,178 @@
+#include "telemetry_codec.h"
+#include "cbor.h"
+#include "json_writer.h"
+
+#include <math.h>
+#include <time.h>
+
+static int32_t scaled(float value, int32_t scale)
+{
+    return (int32_t)lroundf(value * scale);
+}
+
+static void writeSummary(CborWriter &writer, const VitalSummary &summary, int32_t scale)
+{
+    writer.writeArray(3);
+    writer.writeInt(scaled(summary.mean, scale));
+    writer.writeInt(scaled(summary.min, scale));
+    writer.writeInt(scaled(summary.max, scale));
+}
+
+size_t TelemetryCodec::encodeReading(uint8_t *out, size_t capacity, const char *deviceId, uint32_t epochSeconds,
+                                     float pulseRate, float temperature, float spO2, uint8_t flags)
+{
+    CborWriter writer(out, capacity);
+    writer.writeMap(flags ? 7 : 6);
+    writer.writeUint(TKEY_VERSION);
+    writer.writeUint(TELEMETRY_SCHEMA_VERSION);
+    writer.writeUint(TKEY_DEVICE_ID);
+    writer.writeText(deviceId);
+    writer.writeUint(TKEY_TIMESTAMP);
+    writer.writeUint(epochSeconds);
+    writer.writeUint(TKEY_PULSE_RATE);
+    writer.writeInt(scaled(pulseRate, PULSE_RATE_SCALE));
+    writer.writeUint(TKEY_TEMPERATURE);
+    writer.writeInt(scaled(temperature, TEMPERATURE_SCALE));
+    writer.writeUint(TKEY_SPO2);
+    writer.writeInt(scaled(spO2, SPO2_SCALE));
+    if (flags)
+    {
+        writer.writeUint(TKEY_FLAGS);
+        writer.writeUint(flags);
+    }
+    return writer.ok() ? writer.size() : 0;
+}
+
+size_t TelemetryCodec::encodeBatch(uint8_t *out, size_t capacity, const char *deviceId, uint32_t baseEpochSeconds,
+                                   const TelemetryBatch &batch, uint8_t flags)
+{
+    CborWriter writer(out, capacity);
+    writer.writeMap(flags ? 6 : 5);
+    writer.writeUint(TKEY_VERSION);
+    writer.writeUint(TELEMETRY_SCHEMA_VERSION);
+    writer.writeUint(TKEY_DEVICE_ID);
+    writer.writeText(deviceId);
+    writer.writeUint(TKEY_TIMESTAMP);
+    writer.writeUint(baseEpochSeconds);
+    writer.writeUint(TKEY_WINDOW_MS);
+    writer.writeUint(batch.windowMs);
+    if (flags)
+    {
+        writer.writeUint(TKEY_FLAGS);
+        writer.writeUint(flags);
+    }
+    writer.writeUint(TKEY_WINDOWS);
+    writer.writeArray(batch.count);
+
+    for (uint8_t i = 0; i < batch.count; i++)
+    {
+        const TelemetryWindow &w = batch.windows[i];
+        writer.writeMap(6);
+        writer.writeUint(WKEY_OFFSET);
+        writer.writeUint(w.offsetMs / 1000);
+        writer.writeUint(WKEY_SAMPLES);
+        writer.writeUint(w.samples);
+        writer.writeUint(WKEY_QUALITY);
+        writer.writeUint(w.quality);
+        writer.writeUint(WKEY_PULSE_RATE);
+        writeSummary(writer, w.bpm, PULSE_RATE_SCALE);
+        writer.writeUint(WKEY_TEMPERATURE);
+        writeSummary(writer, w.temperature, TEMPERATURE_SCALE);
+        writer.writeUint(WKEY_SPO2);
+        writeSummary(writer, w.spO2, SPO2_SCALE);
+    }
+
+    return writer.ok() ? writer.size() : 0;
+}
+
+// ISO 8601 UTC, e.g. 2025-10-09T08:53:20Z
+static void formatTimestamp(char (&out)[24], uint32_t epochSeconds)
+{
+    time_t seconds = (time_t)epochSeconds;
+    struct tm parts;
+    gmtime_r(&seconds, &parts);
+    strftime(out, sizeof(out), "%Y-%m-%dT%H:%M:%SZ", &parts);
+}
+
+// "timestamp" when the wall clock is known, else "uptime" seconds plus
+// "timeSynced": false so ingestion can place it by arrival time
+static void writeTimeJson(JsonWriter &writer, uint32_t seconds, uint8_t flags)
+{
+    if (flags & TELEMETRY_FLAG_MONOTONIC_TIME)
+    {
+        writer.key("uptime");
+        writer.writeUint(seconds);
+        writer.key("timeSynced");
+        writer.writeBool(false);
+        return;
+    }
+
+    char timestamp[24];
+    formatTimestamp(timestamp, seconds);
+    writer.key("timestamp");
+    writer.writeString(timestamp);
+}
+
+static void writeSummaryJson(JsonWriter &writer, const char *key, const VitalSummary &summary, int32_t scale,
+                             uint8_t decimals)
+{
+    writer.key(key);
+    writer.beginArray();
+    writer.writeFixed(scaled(summary.mean, scale), decimals);
+    writer.writeFixed(scaled(summary.min, scale), decimals);
+    writer.writeFixed(scaled(summary.max, scale), decimals);
+    writer.endArray();
+}
+
+size_t TelemetryCodec::encodeReadingJson(char *out, size_t capacity, const char *deviceId, uint32_t epochSeconds,
+                                         float pulseRate, float temperature, float spO2, uint8_t flags)
+{
+    JsonWriter writer(out, capacity);
+    writer.beginObject();
+    writer.key("deviceId");
+    writer.writeString(deviceId);
+    writer.key("pulseRate");
+    writer.writeFixed(scaled(pulseRate, PULSE_RATE_SCALE), 1);
+    writer.key("temperature");
+    writer.writeFixed(scaled(temperature, TEMPERATURE_SCALE), 2);
+    writer.key("sp02");
+    writer.writeFixed(scaled(spO2, SPO2_SCALE), 1);
+    writeTimeJson(writer, epochSeconds, flags);
+    writer.endObject();
+    return writer.finish() ? writer.size() : 0;
+}
+
+// {"deviceId","timestamp","windowMs","windows":[{"t","n","q","pulseRate":[mean,min,max],...}]}
+size_t TelemetryCodec::encodeBatchJson(char *out, size_t capacity, const char *deviceId, uint32_t baseEpochSeconds,
+                                       const TelemetryBatch &batch, uint8_t flags)
+{
+    JsonWriter writer(out, capacity);
+    writer.beginObject();
+    writer.key("deviceId");
+    writer.writeString(deviceId);
+    writeTimeJson(writer, baseEpochSeconds, flags);
+    writer.key("windowMs");
+    writer.writeUint(batch.windowMs);
+    writer.key("windows");
+    writer.beginArray();
+
+    for (uint8_t i = 0; i < batch.count; i++)
+    {
+        const TelemetryWindow &w = batch.windows[i];
+        writer.beginObject();
+        writer.key("t");
+        writer.writeUint(w.offsetMs / 1000);
+        writer.key("n");
+        writer.writeUint(w.samples);
+        writer.key("q");
+        writer.writeUint(w.quality);
+        writeSummaryJson(writer, "pulseRate", w.bpm, PULSE_RATE_SCALE, 1);
+        writeSummaryJson(writer, "temperature", w.temperature, TEMPERATURE_SCALE, 2);
+        writeSummaryJson(writer, "sp02", w.spO2, SPO2_SCALE, 1);
+        writer.endObject();
+    }
+
+    writer.endArray();
+    writer.endObject();
+    return writer.finish() ? writer.size() : 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_schema.h"
+#include "../telemetry_batch.h"
+
+// Worst case is a full JSON batch, ~115 bytes per window
+#ifndef TELEMETRY_PAYLOAD_CAPACITY
+#define TELEMETRY_PAYLOAD_CAPACITY (128 + TELEMETRY_BATCH_SIZE * 128)
+#endif
+
+// Encodes telemetry into a caller buffer without touching the heap, as
+// CBOR with integer keys or as JSON with the original field names.
+// Returns the encoded length, or 0 if the buffer was too small. With
+// TELEMETRY_FLAG_MONOTONIC_TIME the timestamp is seconds since boot.
+class TelemetryCodec
+{
+public:
+    static size_t encodeReading(uint8_t *out, size_t capacity, const char *deviceId, uint32_t epochSeconds,
+                                float pulseRate, float temperature, float spO2, uint8_t flags = 0);
+
+    static size_t encodeBatch(uint8_t *out, size_t capacity, const char *deviceId, uint32_t baseEpochSeconds,
+                              const TelemetryBatch &batch, uint8_t flags = 0);
+
+    // JSON output is NUL terminated (not counted in the length)
+    static size_t encodeReadingJson(char *out, size_t capacity, const char *deviceId, uint32_t epochSeconds,
+                                    float pulseRate, float temperature, float spO2, uint8_t flags = 0);
+
+    static size_t encodeBatchJson(char *out, size_t capacity, const char *deviceId, uint32_t baseEpochSeconds,
+                                  const TelemetryBatch &batch, uint8_t flags = 0);
+
+    // Build-time selected format (TELEMETRY_CODEC)
+    static size_t encodeReadingSelected(uint8_t *out, size_t capacity, const char *deviceId, uint32_t epochSeconds,
+                                        float pulseRate, float temperature, float spO2, uint8_t flags = 0)
+    {
+#if TELEMETRY_CODEC == TELEMETRY_CODEC_CBOR
+        return encodeReading(out, capacity, deviceId, epochSeconds, pulseRate, temperature, spO2, flags);
+#else
+        return encodeReadingJson((char *)out, capacity, deviceId, epochSeconds, pulseRate, temperature, spO2, flags);
+#endif
+    }
+
+    static size_t encodeBatchSelected(uint8_t *out, size_t capacity, const char *deviceId, uint32_t baseEpochSeconds,
+                                      const TelemetryBatch &batch, uint8_t flags = 0)
+    {
+#if TELEMETRY_CODEC == TELEMETRY_CODEC_CBOR
+        return encodeBatch(out, capacity, deviceId, baseEpochSeconds, batch, flags);
+#else
+        return encodeBatchJson((char *)out, capacity, deviceId, baseEpochSeconds, batch, flags);
+#endif
+    }
+};
@@ -0,0 +1,155 @@
+#include "telemetry_decoder.h"
+#include "cbor.h"
+
+#include <string.h>
+
+static bool readScaled(CborReader &reader, float &value, int32_t scale)
+{
+    int64_t raw;
+    if (!reader.readInt(raw))
+        return false;
+    value = (float)raw / scale;
+    return true;
+}
+
+static bool readSummary(CborReader &reader, float values[3], int32_t scale)
+{
+    size_t items;
+    if (!reader.readArray(items))
+        return false;
+
+    for (size_t i = 0; i < items; i++)
+    {
+        if (i < 3)
+        {
+            if (!readScaled(reader, values[i], scale))
+                return false;
+        }
+        else if (!reader.skip())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool readWindow(CborReader &reader, DecodedWindow &window)
+{
+    size_t pairs;
+    if (!reader.readMap(pairs))
+        return false;
+
+    for (size_t i = 0; i < pairs; i++)
+    {
+        uint64_t key, value = 0;
+        if (!reader.readUint(key))
+            return false;
+
+        bool ok = true;
+        switch (key)
+        {
+        case WKEY_OFFSET:
+            ok = reader.readUint(value);
+            window.offsetSeconds = (uint32_t)value;
+            break;
+        case WKEY_SAMPLES:
+            ok = reader.readUint(value);
+            window.samples = (uint16_t)value;
+            break;
+        case WKEY_QUALITY:
+            ok = reader.readUint(value);
+            window.quality = (uint8_t)value;
+            break;
+        case WKEY_PULSE_RATE:
+            ok = readSummary(reader, window.pulseRate, PULSE_RATE_SCALE);
+            break;
+        case WKEY_TEMPERATURE:
+            ok = readSummary(reader, window.temperature, TEMPERATURE_SCALE);
+            break;
+        case WKEY_SPO2:
+            ok = readSummary(reader, window.spO2, SPO2_SCALE);
+            break;
+        default:
+            ok = reader.skip();
+            break;
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+bool decodeTelemetry(const uint8_t *data, size_t length, DecodedTelemetry &out)
+{
+    memset(&out, 0, sizeof(out));
+    CborReader reader(data, length);
+
+    size_t pairs;
+    if (!reader.readMap(pairs))
+        return false;
+
+    for (size_t i = 0; i < pairs; i++)
+    {
+        uint64_t key, value = 0;
+        if (!reader.readUint(key))
+            return false;
+
+        bool ok = true;
+        switch (key)
+        {
+        case TKEY_VERSION:
+            ok = reader.readUint(value);
+            out.version = (uint8_t)value;
+            break;
+        case TKEY_DEVICE_ID:
+            ok = reader.readText(out.deviceId, sizeof(out.deviceId));
+            break;
+        case TKEY_TIMESTAMP:
+            ok = reader.readUint(value);
+            out.timestamp = (uint32_t)value;
+            break;
+        case TKEY_FLAGS:
+            ok = reader.readUint(value);
+            out.flags = (uint8_t)value;
+            break;
+        case TKEY_WINDOW_MS:
+            ok = reader.readUint(value);
+            out.windowMs = (uint32_t)value;
+            break;
+        case TKEY_PULSE_RATE:
+            ok = readScaled(reader, out.pulseRate, PULSE_RATE_SCALE);
+            break;
+        case TKEY_TEMPERATURE:
+            ok = readScaled(reader, out.temperature, TEMPERATURE_SCALE);
+            break;
+        case TKEY_SPO2:
+            ok = readScaled(reader, out.spO2, SPO2_SCALE);
+            break;
+        case TKEY_WINDOWS:
+        {
+            size_t items;
+            ok = reader.readArray(items);
+            for (size_t w = 0; ok && w < items; w++)
+            {
+                if (out.windowCount < DecodedTelemetry::MAX_WINDOWS)
+                {
+                    ok = readWindow(reader, out.windows[out.windowCount++]);
+                }
+                else
+                {
+                    ok = reader.skip();
+                    out.windowsDropped++;
+                }
+            }
+            break;
+        }
+        default:
+            ok = reader.skip();
+            break;
+        }
+        if (!ok)
+            return false;
+    }
+
+    return out.version != 0 && out.version <= TELEMETRY_SCHEMA_VERSION;
+}
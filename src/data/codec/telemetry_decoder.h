@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_schema.h"
+
+// Decoder for the binary telemetry schema, for the ingestion side. Depends
+// only on cbor.h and telemetry_schema.h, so it builds without the firmware.
+
+struct DecodedWindow
+{
+    uint32_t offsetSeconds;
+    uint16_t samples;
+    uint8_t quality;
+    float pulseRate[3]; // mean, min, max
+    float temperature[3];
+    float spO2[3];
+};
+
+struct DecodedTelemetry
+{
+    static const uint8_t MAX_WINDOWS = 64;
+
+    uint8_t version;
+    char deviceId[40];
+    uint32_t timestamp; // Epoch seconds, or seconds since boot with the flag below
+    uint8_t flags;      // TelemetryFlags
+    uint32_t windowMs;
+
+    // Single reading (when windowCount == 0)
+    float pulseRate;
+    float temperature;
+    float spO2;
+
+    uint8_t windowCount;
+    uint16_t windowsDropped; // Beyond MAX_WINDOWS
+    DecodedWindow windows[MAX_WINDOWS];
+
+    bool isBatch() const { return windowCount > 0 || windowsDropped > 0; }
+    bool monotonicTime() const { return flags & TELEMETRY_FLAG_MONOTONIC_TIME; }
+};
+
+// Returns false on malformed input. Unknown keys are skipped.
+bool decodeTelemetry(const uint8_t *data, size_t length, DecodedTelemetry &out);
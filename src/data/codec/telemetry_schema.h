@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// Binary telemetry schema shared by the firmware encoder and the ingestion
+// decoder. Keys are small integers (one CBOR byte each) and vitals are
+// scaled integers. Bump TELEMETRY_SCHEMA_VERSION on incompatible changes;
+// decoders skip keys they do not know.
+
+#define TELEMETRY_CODEC_JSON 0
+#define TELEMETRY_CODEC_CBOR 1
+
+// Payload format used by the firmware; override with -DTELEMETRY_CODEC=1
+#ifndef TELEMETRY_CODEC
+#define TELEMETRY_CODEC TELEMETRY_CODEC_JSON
+#endif
+
+static const uint8_t TELEMETRY_SCHEMA_VERSION = 1;
+
+// Top-level map keys
+enum TelemetryKey : uint8_t
+{
+    TKEY_VERSION = 0,
+    TKEY_DEVICE_ID = 1,
+    TKEY_TIMESTAMP = 2, // Epoch seconds (of the first window for batches)
+    TKEY_WINDOW_MS = 3,
+    TKEY_WINDOWS = 4,   // Array of window maps
+    TKEY_PULSE_RATE = 5, // Single reading
+    TKEY_TEMPERATURE = 6,
+    TKEY_SPO2 = 7,
+    TKEY_FLAGS = 8 // TelemetryFlags; absent means 0
+};
+
+enum TelemetryFlags : uint8_t
+{
+    // Wall clock was unknown: TKEY_TIMESTAMP is seconds since boot
+    TELEMETRY_FLAG_MONOTONIC_TIME = 0x01
+};
+
+// Window map keys
+enum TelemetryWindowKey : uint8_t
+{
+    WKEY_OFFSET = 0,  // Seconds after TKEY_TIMESTAMP
+    WKEY_SAMPLES = 1,
+    WKEY_QUALITY = 2, // Percent of samples with contact
+    WKEY_PULSE_RATE = 3, // [mean, min, max]
+    WKEY_TEMPERATURE = 4,
+    WKEY_SPO2 = 5
+};
+
+// Fixed-point scales
+static const int32_t PULSE_RATE_SCALE = 10;   // 0.1 bpm
+static const int32_t TEMPERATURE_SCALE = 100; // 0.01 degC
+static const int32_t SPO2_SCALE = 10;         // 0.1 %
+
+// Azure IoT Hub message property so routing knows the body is not JSON
+#define TELEMETRY_CBOR_TOPIC_PROPERTIES "$.ct=application%2Fcbor"
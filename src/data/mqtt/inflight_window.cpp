@@ -0,0 +1,133 @@
+#include "inflight_window.h"
+
+#include <string.h>
+
+#include "../../utils/stage_profiler.h"
+
+static_assert(sizeof(InflightWindow) <= MQTT_INFLIGHT_RAM_BUDGET, "In-flight window outgrew its RAM budget");
+
+InflightWindow::InflightWindow(MqttClient &client, Clock &clock) : mqtt(client), clock(clock)
+{
+    for (Slot &slot : slots)
+        slot.used = false;
+}
+
+void InflightWindow::begin(DeliveryListener *deliveryListener)
+{
+    listener = deliveryListener;
+    mqtt.setAckHandler(this);
+}
+
+bool InflightWindow::send(Slot &slot)
+{
+    if (!mqtt.connected())
+        return false;
+
+    PROFILE_SCOPE(STAGE_PUBLISH);
+    bool dup = slot.attempts > 0;
+    if (!mqtt.publish(slot.topic, slot.payload, slot.length, 1, slot.packetId, dup))
+        return false;
+
+    slot.sentMs = clock.millis();
+    slot.attempts++;
+    if (dup)
+        resent++;
+    return true;
+}
+
+bool InflightWindow::publish(const char *topic, const uint8_t *payload, size_t length, uint32_t tag)
+{
+    size_t topicLength = strlen(topic);
+    if (length > MQTT_INFLIGHT_PAYLOAD || topicLength >= MQTT_INFLIGHT_TOPIC)
+        return false;
+
+    for (Slot &slot : slots)
+    {
+        if (slot.used)
+            continue;
+
+        slot.used = true;
+        memcpy(slot.topic, topic, topicLength + 1);
+        slot.tag = tag;
+        slot.packetId = mqtt.newPacketId();
+        slot.length = (uint16_t)length;
+        slot.attempts = 0;
+        slot.queuedMs = clock.millis();
+        memcpy(slot.payload, payload, length);
+
+        // Not connected: stays queued until poll() finds the link up
+        send(slot);
+        return true;
+    }
+    return false;
+}
+
+void InflightWindow::poll()
+{
+    if (!mqtt.connected())
+        return;
+
+    uint32_t now = clock.millis();
+    for (Slot &slot : slots)
+    {
+        if (!slot.used)
+            continue;
+        if (slot.attempts == 0 || now - slot.sentMs >= MQTT_ACK_TIMEOUT_MS)
+        {
+            if (!send(slot))
+                return; // Connection dropped; the rest waits for the reconnect
+        }
+    }
+}
+
+void InflightWindow::resendAll()
+{
+    for (Slot &slot : slots)
+    {
+        if (slot.used)
+            slot.sentMs = clock.millis() - MQTT_ACK_TIMEOUT_MS;
+    }
+    poll();
+}
+
+bool InflightWindow::drain(uint32_t timeoutMs)
+{
+    uint32_t started = clock.millis();
+    while (!empty() && clock.millis() - started < timeoutMs)
+    {
+        if (!mqtt.loop())
+            return empty();
+        poll();
+        clock.delay(1);
+    }
+    return empty();
+}
+
+void InflightWindow::onPuback(uint16_t packetId)
+{
+    for (Slot &slot : slots)
+    {
+        if (slot.used && slot.packetId == packetId)
+        {
+            slot.used = false;
+            delivered++;
+            if (listener)
+                listener->onDelivered(slot.tag, clock.millis() - slot.queuedMs);
+            return;
+        }
+    }
+
+    // Ack for a message already acked (a DUP resend crossed the first PUBACK)
+    unknownAcks++;
+}
+
+size_t InflightWindow::pending() const
+{
+    size_t count = 0;
+    for (const Slot &slot : slots)
+    {
+        if (slot.used)
+            count++;
+    }
+    return count;
+}
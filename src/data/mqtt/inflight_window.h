@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mqtt_client.h"
+#include "../codec/telemetry_codec.h"
+
+// QoS 1 messages allowed on the wire before PUBACKs come back. Every slot
+// holds a whole batch payload, about 1 KB of static RAM each.
+#ifndef MQTT_INFLIGHT_WINDOW
+#define MQTT_INFLIGHT_WINDOW 3
+#endif
+
+// Largest payload and topic a slot holds
+#ifndef MQTT_INFLIGHT_PAYLOAD
+#define MQTT_INFLIGHT_PAYLOAD TELEMETRY_PAYLOAD_CAPACITY
+#endif
+#ifndef MQTT_INFLIGHT_TOPIC
+#define MQTT_INFLIGHT_TOPIC 96
+#endif
+
+// Static RAM the window may take; checked at compile time so a larger
+// batch or window shows up here, not as a heap shortage during TLS
+#ifndef MQTT_INFLIGHT_RAM_BUDGET
+#define MQTT_INFLIGHT_RAM_BUDGET 3200
+#endif
+
+// No PUBACK after this long: resend with DUP set
+#ifndef MQTT_ACK_TIMEOUT_MS
+#define MQTT_ACK_TIMEOUT_MS 10000
+#endif
+
+// Told when the broker has acknowledged a message. tag is whatever the
+// caller passed to publish(), e.g. which buffered samples it carried.
+class DeliveryListener
+{
+public:
+    virtual ~DeliveryListener() {}
+    virtual void onDelivered(uint32_t tag, uint32_t latencyMs) = 0;
+};
+
+// Fixed table of QoS 1 publishes awaiting PUBACK. Each slot keeps its own
+// copy of topic and payload until the ack arrives, so the caller's buffer
+// can be reused at once and nothing is lost on a dropped connection:
+// unacked messages go out again (DUP) after a timeout or reconnect. Up to
+// MQTT_INFLIGHT_WINDOW messages are outstanding at once instead of
+// stop-and-wait.
+class InflightWindow : public MqttAckHandler
+{
+private:
+    struct Slot
+    {
+        char topic[MQTT_INFLIGHT_TOPIC];
+        uint32_t tag;
+        uint32_t queuedMs;
+        uint32_t sentMs;
+        uint16_t packetId;
+        uint16_t length;
+        uint8_t attempts; // 0 = not written to the socket yet
+        bool used;
+        uint8_t payload[MQTT_INFLIGHT_PAYLOAD];
+    };
+
+    MqttClient &mqtt;
+    Clock &clock;
+    DeliveryListener *listener = nullptr;
+    Slot slots[MQTT_INFLIGHT_WINDOW];
+
+    bool send(Slot &slot);
+
+public:
+    // Counters since boot
+    uint32_t delivered = 0;
+    uint32_t resent = 0;
+    uint32_t unknownAcks = 0;
+
+    InflightWindow(MqttClient &client, Clock &clock = systemClock());
+
+    // Registers for the client's PUBACKs
+    void begin(DeliveryListener *deliveryListener = nullptr);
+
+    // Copies the message into a free slot and sends it if connected.
+    // False if the window is full or the message too large.
+    bool publish(const char *topic, const uint8_t *payload, size_t length, uint32_t tag = 0);
+
+    // Sends slots not on the wire yet and resends timed-out ones. Call
+    // after MqttClient::loop().
+    void poll();
+
+    // After a reconnect: with a clean session the broker forgot every
+    // unacked id, so all of them are sent again
+    void resendAll();
+
+    // Runs the client and the window until everything is acked or the
+    // timeout passes; true if the window is empty
+    bool drain(uint32_t timeoutMs);
+
+    void onPuback(uint16_t packetId) override;
+
+    size_t pending() const;
+    bool full() const { return pending() >= MQTT_INFLIGHT_WINDOW; }
+    bool empty() const { return pending() == 0; }
+};
@@ -0,0 +1,370 @@
+#include "mqtt_client.h"
+
+#include <string.h>
+
+#include "../../utils/stage_profiler.h"
+
+// Control packet types (high nibble of the fixed header)
+static const uint8_t MQTT_CONNECT = 0x10;
+static const uint8_t MQTT_CONNACK = 0x20;
+static const uint8_t MQTT_PUBLISH = 0x30;
+static const uint8_t MQTT_PUBACK = 0x40;
+static const uint8_t MQTT_SUBSCRIBE = 0x82; // Reserved flags 0010
+static const uint8_t MQTT_SUBACK = 0x90;
+static const uint8_t MQTT_PINGREQ = 0xC0;
+static const uint8_t MQTT_PINGRESP = 0xD0;
+static const uint8_t MQTT_DISCONNECT = 0xE0;
+
+// Fixed header, topic and packet id are sent in one write (one TLS record);
+// longer topics fall back to a separate write
+static const size_t HEADER_SCRATCH = 128;
+
+static size_t encodeLength(uint8_t *out, size_t length)
+{
+    size_t used = 0;
+    do
+    {
+        uint8_t digit = length % 128;
+        length /= 128;
+        if (length > 0)
+            digit |= 0x80;
+        out[used++] = digit;
+    } while (length > 0 && used < 4);
+    return used;
+}
+
+static size_t putString(uint8_t *out, const char *text)
+{
+    size_t length = strlen(text);
+    out[0] = (uint8_t)(length >> 8);
+    out[1] = (uint8_t)length;
+    memcpy(out + 2, text, length);
+    return length + 2;
+}
+
+MqttClient::MqttClient(NetworkClient &network, Clock &clock) : net(network), clock(clock) {}
+
+bool MqttClient::writeAll(const uint8_t *data, size_t length)
+{
+    if (length == 0)
+        return true;
+    if (net.write(data, length) != length)
+    {
+        drop(CONNECTION_LOST);
+        return false;
+    }
+    lastOutMs = clock.millis();
+    return true;
+}
+
+bool MqttClient::writePacket(uint8_t header, const uint8_t *body, size_t length)
+{
+    uint8_t head[5];
+    head[0] = header;
+    size_t used = 1 + encodeLength(head + 1, length);
+    return writeAll(head, used) && writeAll(body, length);
+}
+
+void MqttClient::drop(int reason)
+{
+    net.stop();
+    connState = reason;
+    pingOutstanding = false;
+}
+
+bool MqttClient::connect(const char *clientId, const char *username, const char *password)
+{
+    if (connected())
+        return true;
+    PROFILE_SCOPE(STAGE_MQTT_CONNECT);
+
+    bool transport;
+    {
+        // The TLS handshake on the board
+        PROFILE_SCOPE(STAGE_TLS_HANDSHAKE);
+        transport = host != nullptr && net.connect(host, port);
+    }
+    if (!transport)
+    {
+        connState = CONNECT_FAILED;
+        return false;
+    }
+
+    size_t clientLength = strlen(clientId);
+    size_t userLength = username ? strlen(username) : 0;
+    size_t passLength = password ? strlen(password) : 0;
+    size_t bodyLength = 10 + 2 + clientLength + (username ? 2 + userLength : 0) + (password ? 2 + passLength : 0);
+
+    // Variable header: protocol name, level 4, flags, keep alive
+    uint8_t head[5 + 10];
+    head[0] = MQTT_CONNECT;
+    size_t used = 1 + encodeLength(head + 1, bodyLength);
+    const uint8_t variable[] = {0, 4, 'M', 'Q', 'T', 'T', 4,
+                                (uint8_t)(0x02 | (username ? 0x80 : 0) | (password ? 0x40 : 0)),
+                                (uint8_t)(keepAliveS >> 8), (uint8_t)keepAliveS};
+    memcpy(head + used, variable, sizeof(variable));
+    used += sizeof(variable);
+
+    uint8_t prefix[2];
+    bool sent = writeAll(head, used);
+    prefix[0] = (uint8_t)(clientLength >> 8);
+    prefix[1] = (uint8_t)clientLength;
+    sent = sent && writeAll(prefix, 2) && writeAll((const uint8_t *)clientId, clientLength);
+    if (username)
+    {
+        prefix[0] = (uint8_t)(userLength >> 8);
+        prefix[1] = (uint8_t)userLength;
+        sent = sent && writeAll(prefix, 2) && writeAll((const uint8_t *)username, userLength);
+    }
+    if (password)
+    {
+        prefix[0] = (uint8_t)(passLength >> 8);
+        prefix[1] = (uint8_t)passLength;
+        sent = sent && writeAll(prefix, 2) && writeAll((const uint8_t *)password, passLength);
+    }
+    if (!sent)
+    {
+        drop(CONNECT_FAILED);
+        return false;
+    }
+
+    uint8_t header;
+    size_t length;
+    bool truncated;
+    if (!readPacket(header, length, truncated))
+    {
+        drop(CONNECTION_TIMEOUT);
+        return false;
+    }
+    if (header != MQTT_CONNACK || length != 2)
+    {
+        drop(CONNECT_FAILED);
+        return false;
+    }
+    if (rx[1] != 0)
+    {
+        drop(rx[1]);
+        return false;
+    }
+
+    connState = CONNECTED;
+    lastInMs = lastOutMs = clock.millis();
+    pingOutstanding = false;
+    return true;
+}
+
+bool MqttClient::connected()
+{
+    if (connState != CONNECTED)
+        return false;
+    if (!net.connected())
+    {
+        drop(CONNECTION_LOST);
+        return false;
+    }
+    return true;
+}
+
+void MqttClient::disconnect()
+{
+    if (connState == CONNECTED)
+    {
+        uint8_t packet[2] = {MQTT_DISCONNECT, 0};
+        net.write(packet, sizeof(packet));
+    }
+    drop(DISCONNECTED);
+}
+
+uint16_t MqttClient::newPacketId()
+{
+    uint16_t id = nextPacketId++;
+    if (nextPacketId == 0)
+        nextPacketId = 1;
+    return id;
+}
+
+bool MqttClient::publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos, uint16_t packetId,
+                         bool dup)
+{
+    if (!connected())
+        return false;
+
+    size_t topicLength = strlen(topic);
+    size_t bodyLength = 2 + topicLength + (qos ? 2 : 0) + length;
+
+    uint8_t head[HEADER_SCRATCH];
+    head[0] = MQTT_PUBLISH | (dup ? 0x08 : 0) | (uint8_t)(qos << 1);
+    size_t used = 1 + encodeLength(head + 1, bodyLength);
+    head[used++] = (uint8_t)(topicLength >> 8);
+    head[used++] = (uint8_t)topicLength;
+
+    bool sent;
+    if (used + topicLength + 2 <= sizeof(head))
+    {
+        memcpy(head + used, topic, topicLength);
+        used += topicLength;
+        if (qos)
+        {
+            head[used++] = (uint8_t)(packetId >> 8);
+            head[used++] = (uint8_t)packetId;
+        }
+        sent = writeAll(head, used);
+    }
+    else
+    {
+        uint8_t id[2] = {(uint8_t)(packetId >> 8), (uint8_t)packetId};
+        sent = writeAll(head, used) && writeAll((const uint8_t *)topic, topicLength) && (!qos || writeAll(id, 2));
+    }
+
+    return sent && writeAll(payload, length);
+}
+
+bool MqttClient::subscribe(const char *topic, uint8_t qos)
+{
+    if (!connected())
+        return false;
+
+    uint8_t body[HEADER_SCRATCH];
+    size_t topicLength = strlen(topic);
+    if (topicLength + 5 > sizeof(body))
+        return false;
+
+    uint16_t id = newPacketId();
+    body[0] = (uint8_t)(id >> 8);
+    body[1] = (uint8_t)id;
+    size_t used = 2 + putString(body + 2, topic);
+    body[used++] = qos;
+    return writePacket(MQTT_SUBSCRIBE, body, used);
+}
+
+bool MqttClient::readByte(uint8_t &value)
+{
+    uint32_t started = clock.millis();
+    while (net.available() <= 0)
+    {
+        if (!net.connected() || clock.millis() - started >= socketTimeoutMs)
+            return false;
+        clock.delay(1);
+    }
+    return net.read(&value, 1) == 1;
+}
+
+// One whole packet into rx. The part that does not fit is read and
+// discarded, with truncated set.
+bool MqttClient::readPacket(uint8_t &header, size_t &length, bool &truncated)
+{
+    if (!readByte(header))
+        return false;
+
+    length = 0;
+    uint32_t multiplier = 1;
+    uint8_t digit;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!readByte(digit))
+            return false;
+        length += (digit & 0x7F) * multiplier;
+        multiplier *= 128;
+        if (!(digit & 0x80))
+            break;
+    }
+
+    truncated = length > sizeof(rx);
+    for (size_t i = 0; i < length; i++)
+    {
+        uint8_t byte;
+        if (!readByte(byte))
+            return false;
+        if (i < sizeof(rx))
+            rx[i] = byte;
+    }
+
+    lastInMs = clock.millis();
+    return true;
+}
+
+void MqttClient::handlePacket(uint8_t header, size_t length)
+{
+    switch (header & 0xF0)
+    {
+    case MQTT_PUBLISH:
+    {
+        if (length < 2)
+            return;
+        uint8_t qos = (header >> 1) & 0x03;
+        size_t topicLength = ((size_t)rx[0] << 8) | rx[1];
+        size_t idBytes = qos ? 2 : 0;
+        if (2 + topicLength + idBytes > length)
+            return;
+
+        uint16_t id = qos ? (uint16_t)((rx[2 + topicLength] << 8) | rx[3 + topicLength]) : 0;
+
+        // Shift the topic down over its length prefix to NUL terminate it in place
+        memmove(rx, rx + 2, topicLength);
+        rx[topicLength] = '\0';
+        uint8_t *payload = rx + 2 + topicLength + idBytes;
+        if (callback)
+            callback((char *)rx, payload, (unsigned int)(length - 2 - topicLength - idBytes));
+
+        if (qos == 1)
+        {
+            uint8_t ack[2] = {(uint8_t)(id >> 8), (uint8_t)id};
+            writePacket(MQTT_PUBACK, ack, sizeof(ack));
+        }
+        break;
+    }
+    case MQTT_PUBACK:
+        if (length >= 2 && ackHandler)
+            ackHandler->onPuback((uint16_t)((rx[0] << 8) | rx[1]));
+        break;
+    case MQTT_PINGREQ:
+    {
+        uint8_t response[2] = {MQTT_PINGRESP, 0};
+        writeAll(response, sizeof(response));
+        break;
+    }
+    case MQTT_PINGRESP:
+        pingOutstanding = false;
+        break;
+    case MQTT_SUBACK: // Subscriptions are not tracked
+    default:
+        break;
+    }
+}
+
+bool MqttClient::loop()
+{
+    if (!connected())
+        return false;
+
+    uint32_t now = clock.millis();
+    uint32_t keepAliveMs = keepAliveS * 1000UL;
+    if (keepAliveMs && (now - lastOutMs >= keepAliveMs || now - lastInMs >= keepAliveMs))
+    {
+        if (pingOutstanding)
+        {
+            drop(CONNECTION_TIMEOUT);
+            return false;
+        }
+        uint8_t ping[2] = {MQTT_PINGREQ, 0};
+        if (!writeAll(ping, sizeof(ping)))
+            return false;
+        pingOutstanding = true;
+        lastInMs = now;
+    }
+
+    while (net.available() > 0)
+    {
+        uint8_t header;
+        size_t length;
+        bool truncated;
+        if (!readPacket(header, length, truncated))
+        {
+            drop(CONNECTION_LOST);
+            return false;
+        }
+        if (!truncated)
+            handlePacket(header, length);
+    }
+    return connected();
+}
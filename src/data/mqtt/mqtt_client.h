@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+
+// Largest incoming packet (direct method calls, acks). Bigger ones are
+// read and dropped.
+#ifndef MQTT_RX_BUFFER_SIZE
+#define MQTT_RX_BUFFER_SIZE 256
+#endif
+
+// Told about every PUBACK; the in-flight window uses it to release slots
+class MqttAckHandler
+{
+public:
+    virtual ~MqttAckHandler() {}
+    virtual void onPuback(uint16_t packetId) = 0;
+};
+
+typedef void (*MqttMessageCallback)(char *topic, uint8_t *payload, unsigned int length);
+
+// MQTT 3.1.1 client over the NetworkClient HAL. Replaces PubSubClient,
+// which only publishes at QoS 0 and discards PUBACKs. Publishes are
+// written straight to the socket (header, then the caller's payload), so
+// the send path neither copies nor allocates. state() uses PubSubClient's
+// codes, so existing logging still applies.
+class MqttClient
+{
+public:
+    enum State : int
+    {
+        CONNECTION_TIMEOUT = -4,
+        CONNECTION_LOST = -3,
+        CONNECT_FAILED = -2,
+        DISCONNECTED = -1,
+        CONNECTED = 0,
+        // 1..5: CONNACK return codes
+    };
+
+private:
+    NetworkClient &net;
+    Clock &clock;
+
+    const char *host = nullptr;
+    uint16_t port = 1883;
+    uint16_t keepAliveS = 60;
+    uint32_t socketTimeoutMs = 15000;
+
+    int connState = DISCONNECTED;
+    uint32_t lastOutMs = 0;
+    uint32_t lastInMs = 0;
+    bool pingOutstanding = false;
+    uint16_t nextPacketId = 1;
+
+    MqttMessageCallback callback = nullptr;
+    MqttAckHandler *ackHandler = nullptr;
+
+    uint8_t rx[MQTT_RX_BUFFER_SIZE];
+
+    bool writeAll(const uint8_t *data, size_t length);
+    bool writePacket(uint8_t header, const uint8_t *body, size_t length);
+    bool readByte(uint8_t &value);
+    bool readPacket(uint8_t &header, size_t &length, bool &truncated);
+    void handlePacket(uint8_t header, size_t length);
+    void drop(int reason);
+
+public:
+    MqttClient(NetworkClient &network, Clock &clock = systemClock());
+
+    void setServer(const char *hostName, uint16_t portNumber)
+    {
+        host = hostName;
+        port = portNumber;
+    }
+    void setKeepAlive(uint16_t seconds) { keepAliveS = seconds; }
+    void setSocketTimeout(uint16_t seconds) { socketTimeoutMs = seconds * 1000UL; }
+    void setCallback(MqttMessageCallback handler) { callback = handler; }
+    void setAckHandler(MqttAckHandler *handler) { ackHandler = handler; }
+
+    // Clean session CONNECT; blocks for the CONNACK up to the socket timeout
+    bool connect(const char *clientId, const char *username = nullptr, const char *password = nullptr);
+    bool connected();
+    int state() const { return connState; }
+    void disconnect();
+
+    // Next non-zero packet identifier
+    uint16_t newPacketId();
+
+    // qos 0 or 1. packetId is ignored at QoS 0; dup marks a resend.
+    bool publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos = 0, uint16_t packetId = 0,
+                 bool dup = false);
+    bool subscribe(const char *topic, uint8_t qos = 0);
+
+    // Reads whatever arrived and keeps the connection alive. Call often.
+    bool loop();
+};
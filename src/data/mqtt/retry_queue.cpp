@@ -0,0 +1,147 @@
+#include "retry_queue.h"
+
+#include <string.h>
+
+static_assert(sizeof(RetryQueue) <= RETRY_QUEUE_RAM_BUDGET, "Retry queue outgrew its RAM budget");
+
+RetryQueue::RetryQueue(Clock &clock) : clock(clock)
+{
+    for (Entry &entry : entries)
+        entry.used = false;
+}
+
+void RetryQueue::begin(uint32_t seed)
+{
+    rngState = seed ? seed : 1;
+}
+
+// xorshift32: enough to decorrelate retries, no library state involved
+uint32_t RetryQueue::random()
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+uint32_t RetryQueue::backoffMs(uint8_t attempts)
+{
+    uint32_t delay = RETRY_BASE_MS;
+    for (uint8_t i = 0; i < attempts && delay < RETRY_MAX_BACKOFF_MS; i++)
+        delay <<= 1;
+    return delay < RETRY_MAX_BACKOFF_MS ? delay : RETRY_MAX_BACKOFF_MS;
+}
+
+RetryQueue::Entry *RetryQueue::victimFor(Priority priority)
+{
+    Entry *victim = nullptr;
+    for (Entry &entry : entries)
+    {
+        if (!entry.used || entry.priority > priority)
+            continue;
+        if (!victim || entry.priority < victim->priority ||
+            (entry.priority == victim->priority && older(entry, *victim)))
+            victim = &entry;
+    }
+    return victim;
+}
+
+bool RetryQueue::push(const char *topic, const uint8_t *payload, size_t length, Priority priority, uint32_t tag,
+                      uint32_t ttlMs)
+{
+    size_t topicLength = strlen(topic);
+    if (length > RETRY_QUEUE_PAYLOAD || topicLength >= MQTT_INFLIGHT_TOPIC)
+    {
+        rejected++;
+        return false;
+    }
+
+    Entry *slot = nullptr;
+    for (Entry &entry : entries)
+    {
+        if (!entry.used)
+        {
+            slot = &entry;
+            break;
+        }
+    }
+    if (!slot)
+    {
+        slot = victimFor(priority);
+        if (!slot)
+        {
+            rejected++;
+            return false;
+        }
+        evicted++;
+    }
+
+    uint32_t now = clock.millis();
+    memcpy(slot->topic, topic, topicLength + 1);
+    memcpy(slot->payload, payload, length);
+    slot->length = (uint16_t)length;
+    slot->priority = priority;
+    slot->attempts = 0;
+    slot->used = true;
+    slot->tag = tag;
+    slot->sequence = nextSequence++;
+    slot->queuedMs = now;
+    slot->readyMs = now;
+    slot->ttlMs = ttlMs;
+    queued++;
+    return true;
+}
+
+RetryQueue::Entry *RetryQueue::nextReady()
+{
+    uint32_t now = clock.millis();
+    Entry *best = nullptr;
+    for (Entry &entry : entries)
+    {
+        if (!entry.used)
+            continue;
+        if (entry.ttlMs && now - entry.queuedMs >= entry.ttlMs)
+        {
+            entry.used = false;
+            expired++;
+            continue;
+        }
+        if (!reached(now, entry.readyMs))
+            continue;
+        if (!best || entry.priority > best->priority ||
+            (entry.priority == best->priority && older(entry, *best)))
+            best = &entry;
+    }
+    return best;
+}
+
+void RetryQueue::remove(Entry *entry)
+{
+    entry->used = false;
+}
+
+void RetryQueue::retryLater(Entry *entry)
+{
+    entry->attempts++;
+    if (entry->attempts >= RETRY_MAX_ATTEMPTS)
+    {
+        entry->used = false;
+        expired++;
+        return;
+    }
+
+    // "Equal jitter": half the backoff fixed, the other half random
+    uint32_t delay = backoffMs(entry->attempts);
+    entry->readyMs = clock.millis() + delay / 2 + random() % (delay / 2 + 1);
+}
+
+size_t RetryQueue::size() const
+{
+    size_t count = 0;
+    for (const Entry &entry : entries)
+    {
+        if (entry.used)
+            count++;
+    }
+    return count;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+#include "inflight_window.h"
+
+// Messages held while they cannot be handed to the client
+#ifndef RETRY_QUEUE_SLOTS
+#define RETRY_QUEUE_SLOTS 5
+#endif
+
+// Largest payload an entry holds. Logged batches stay in the telemetry log
+// until acked and are never queued here, so this only has to fit single
+// readings and direct-method replies.
+#ifndef RETRY_QUEUE_PAYLOAD
+#define RETRY_QUEUE_PAYLOAD 256
+#endif
+
+// Static RAM the queue may take, checked at compile time
+#ifndef RETRY_QUEUE_RAM_BUDGET
+#define RETRY_QUEUE_RAM_BUDGET 2048
+#endif
+
+// Backoff before attempt n is RETRY_BASE_MS << n, capped at
+// RETRY_MAX_BACKOFF_MS, with the upper half of it randomised
+#ifndef RETRY_BASE_MS
+#define RETRY_BASE_MS 2000
+#endif
+#ifndef RETRY_MAX_BACKOFF_MS
+#define RETRY_MAX_BACKOFF_MS 60000
+#endif
+
+// Failed attempts before an entry is given up
+#ifndef RETRY_MAX_ATTEMPTS
+#define RETRY_MAX_ATTEMPTS 6
+#endif
+
+// Fixed table of messages waiting to be retried. Topic and payload are
+// copied into the slot, so nothing is allocated once the object exists.
+// nextReady() hands out the highest priority entry whose backoff has
+// passed, oldest first; a full queue makes room by evicting the oldest
+// entry of the lowest priority below the new one.
+class RetryQueue
+{
+public:
+    enum Priority : uint8_t
+    {
+        TELEMETRY = 0,
+        RESPONSE = 1 // Direct-method replies: the hub is waiting on them
+    };
+
+    struct Entry
+    {
+        char topic[MQTT_INFLIGHT_TOPIC];
+        uint8_t payload[RETRY_QUEUE_PAYLOAD];
+        uint16_t length;
+        Priority priority;
+        uint8_t attempts;
+        bool used;
+        uint32_t tag;
+        uint32_t sequence; // Push order
+        uint32_t queuedMs;
+        uint32_t readyMs; // Not handed out before this
+        uint32_t ttlMs;   // 0 = never expires
+    };
+
+private:
+    Clock &clock;
+    Entry entries[RETRY_QUEUE_SLOTS];
+    uint32_t nextSequence = 0;
+    uint32_t rngState = 1;
+
+    uint32_t random();
+    Entry *victimFor(Priority priority);
+    static bool reached(uint32_t now, uint32_t deadline) { return (int32_t)(now - deadline) >= 0; }
+    static bool older(const Entry &a, const Entry &b) { return (int32_t)(a.sequence - b.sequence) < 0; }
+
+public:
+    // Counters since boot
+    uint32_t queued = 0;
+    uint32_t evicted = 0;
+    uint32_t rejected = 0;
+    uint32_t expired = 0; // Out of attempts or past their deadline
+
+    explicit RetryQueue(Clock &clock = systemClock());
+
+    // Seeds the backoff jitter; devices started together then spread out
+    void begin(uint32_t seed);
+
+    // Copies the message in; ready at once. ttlMs > 0 drops it if not sent
+    // by then. False if it does not fit or the queue is full of entries of
+    // at least its priority.
+    bool push(const char *topic, const uint8_t *payload, size_t length, Priority priority, uint32_t tag = 0,
+              uint32_t ttlMs = 0);
+
+    // Next entry to try, or nullptr. Expired entries are dropped on the way.
+    Entry *nextReady();
+
+    // The entry went out: free its slot
+    void remove(Entry *entry);
+    // The attempt failed: back off, or drop it once out of attempts
+    void retryLater(Entry *entry);
+
+    // Backoff that precedes attempt number attempts (0-based), before jitter
+    static uint32_t backoffMs(uint8_t attempts);
+
+    // Slot i, or nullptr when unused
+    const Entry *at(size_t i) const { return i < RETRY_QUEUE_SLOTS && entries[i].used ? &entries[i] : nullptr; }
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    static size_t capacity() { return RETRY_QUEUE_SLOTS; }
+};
@@ -2,16 +2,45 @@
 
 #include <ESP8266WiFi.h>
 #include <ESP8266HTTPClient.h>
-#include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include <ctime>
-#include <vector>
 #include <time.h>
 
 #include "../../lib/env.h"
+#include "../hal/arduino/arduino_hal.h"
+#include "telemetry_sink.h"
+#include "codec/telemetry_codec.h"
+#include "mqtt/mqtt_client.h"
+#include "mqtt/inflight_window.h"
+#include "mqtt/retry_queue.h"
+#include "telemetry_log.h"
+#include "auth/sas_token.h"
+#include "../state/wake/wake_state.h"
+#include "../state/wake/wake_probe.h"
+#include "../state/wake/tls_session_store.h"
+#include "../state/device/device_state.h"
+#include "../state/time/time_service.h"
+#include "../state/duty/duty_cycle.h"
+#include "../state/memory/memory_monitor.h"
+#include "wifi_connection.h"
+#include "../utils/trace.h"
+#include "../utils/stage_profiler.h"
 // Remove problematic include that causes circular dependency
 // #include "../utils/others.h"
 
+// IoT Hub stops waiting for a direct-method reply after its response
+// timeout (30 s by default); a queued reply older than this is dropped
+#ifndef DIRECT_METHOD_RESPONSE_TTL_MS
+#define DIRECT_METHOD_RESPONSE_TTL_MS 30000
+#endif
+
+// TLS record size asked for through MFLN. Without MFLN the receive buffer
+// must hold a full 16 KB record; the transmit side can always be small.
+#ifndef TLS_MFLN_SIZE
+#define TLS_MFLN_SIZE 1024
+#endif
+#define TLS_FULL_RECORD_SIZE 16384
+
 struct SensorData
 {
     float temperature;
@@ -19,115 +48,191 @@ struct SensorData
     float spO2;
 };
 
-// Retry queue structure for failed data
-struct QueuedData
-{
-    String payload;
-    String topic;
-    unsigned long timestamp;
-    int retryCount;
-};
-
-class RemoteDataSource
+class RemoteDataSource : public TelemetrySink, public DeliveryListener
 {
 private:
-    WiFiClientSecure wifiClient;
-    PubSubClient mqttClient;
+    ArduinoNetworkClient network;
+    WiFiClientSecure &wifiClient = network.secure();
+    MqttClient mqttClient;
+    // Telemetry goes out at QoS 1 and counts as sent only once PUBACKed
+    InflightWindow inflight;
 
     const char *host = AZURE_IOT_HOST;
+    const uint16_t port = 8883;
     const String deviceId = "1";
     const String shareKey = AZURE_SHARED_KEY;
     String sasToken = "";
     unsigned long tokenExpiryTime = 0; // Token expiry tracking
 
-    // Retry queue for failed data transmissions
-    std::vector<QueuedData> retryQueue;
-    static const int MAX_QUEUE_SIZE = 5; // Reduced from 10 to save memory
-    static const int MAX_RETRIES = 2;    // Reduced from 3 to save memory
+    // Messages that could not be handed to the client yet, fixed slots
+    RetryQueue retryQueue;
+    // Set in in-flight tags of messages drained from telemetryLog
+    static const uint32_t LOG_TAG = 0x80000000;
 
     // Data transmission verification tracking
     unsigned long totalDataSent = 0;
     unsigned long totalDataFailed = 0;
     unsigned long lastSuccessfulSend = 0;
-    String lastSentPayload = "";
+    char lastSentPayload[80] = "";
     bool lastSendStatus = false;
 
+    WifiSettings wifiSettings = {WIFI_SSID, WIFI_PASSWORD, {0, 0, 0, 0}};
+    bool networkSetUp = false;
+    bool cachedTokenChecked = false;
+
     // Message tracking for QoS verification
     uint16_t messageId = 0;
     unsigned long lastPublishTime = 0;
 
+    // Built once in begin(); publishes format into payloadBuffer, so the
+    // send path does not allocate
+    char telemetryTopic[96] = "";
+    uint8_t payloadBuffer[TELEMETRY_PAYLOAD_CAPACITY];
+
+    // Written back by BearSSL after each handshake and mirrored into RTC
+    // memory, so the next wake can resume instead of a full handshake
+    BearSSL::Session tlsSession;
+    static_assert(sizeof(br_ssl_session_parameters) <= TlsSessionRecord::SESSION_CAPACITY,
+                  "TLS session does not fit its RTC block");
+#if defined(AZURE_IOT_ROOT_CA)
+    BearSSL::X509List trustAnchors{AZURE_IOT_ROOT_CA};
+#elif defined(AZURE_IOT_PUBLIC_KEY)
+    BearSSL::PublicKey pinnedKey{AZURE_IOT_PUBLIC_KEY};
+#endif
+
 public:
-    RemoteDataSource() : mqttClient(wifiClient)
+    RemoteDataSource() : mqttClient(network), inflight(mqttClient)
     {
 
         mqttClient.setCallback(mqttCallback);
-        mqttClient.setBufferSize(256); // Reduced buffer size to prevent stack overflow
-        instance = this;               // Set static instance for callback access
+        inflight.begin(this);
+        instance = this; // Set static instance for callback access
     }
 
+    // Restores RTC state and starts the Wi-Fi join, then returns so sensors
+    // can warm up while the radio associates. Time and token follow in
+    // onNetworkUp() once the link is connected.
     void begin()
     {
+        buildTelemetryTopic();
+
         // Print available stack space for debugging
         Serial.printf("Free stack at begin(): %d bytes\n", ESP.getFreeContStack());
 
-        wifiClient.setInsecure();
-        wifiClient.setTimeout(5000); // Further reduced timeout to 5 seconds
-        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-        Serial.print("Connecting to WiFi");
-
-        int wifiTimeout = 0;
-        while (WiFi.status() != WL_CONNECTED && wifiTimeout < 20) // Reduced timeout
+        // State left in RTC memory by the previous wake, if any
+        bool warm = wakeState.restore();
+        wakeProbe.setWarm(warm);
+        if (warm)
         {
-            delay(500);
-            Serial.print(".");
-            wifiTimeout++;
+            Serial.printf("[WAKE] Restored RTC state (wake #%lu)\n", (unsigned long)wakeState.wakeCount());
+            // The previous wake could not report its own end
+            stageProfiler.record(STAGE_WAKE_TO_SLEEP, wakeState.lastAwakeMs() * 1000UL);
+            stageProfiler.record(STAGE_SLEEP_ENTRY, wakeState.lastSleepEntryUs());
         }
+        timeService.restore();
+        memoryMonitor.restore();
+        retryQueue.begin(ESP.random());
 
-        if (WiFi.status() == WL_CONNECTED)
-        {
-            Serial.println("\nWiFi connected.");
-            Serial.printf("IP address: %s\n", WiFi.localIP().toString().c_str());
-            syncTime();
-        }
+        if (telemetryLog.begin())
+            Serial.printf("[LOG] Telemetry log ready, %lu bytes unsent\n", (unsigned long)telemetryLog.backlogBytes());
         else
-        {
-            Serial.println("\nWiFi connection failed!");
-            return;
-        }
+            Serial.println("[LOG] Telemetry log unavailable, sending directly");
+
+        configureTls();
+        wifiClient.setTimeout(5000); // Further reduced timeout to 5 seconds
+
+        wifiSettings = {deviceState.getWifiSSID(), deviceState.getWifiPassword(), deviceState.getStaticIp()};
+        Serial.printf("Connecting to WiFi '%s' in the background\n", wifiSettings.ssid);
+        wifiConnection.start(wifiSettings);
+    }
+
+    // Advances the Wi-Fi join; true once the network is up and set up
+    bool pollNetwork()
+    {
+        if (networkSetUp)
+            return true;
+        if (wifiConnection.tick() != WifiConnection::State::CONNECTED)
+            return false;
+
+        onNetworkUp();
+        networkSetUp = true;
+        return true;
+    }
+
+    // Restarts the join if the last one failed and returns at once; the
+    // network task's pollNetwork() carries it from there
+    void restartJoinIfFailed()
+    {
+        WifiConnection::State state = wifiConnection.state();
+        if (state == WifiConnection::State::FAILED || state == WifiConnection::State::IDLE)
+            wifiConnection.start(wifiSettings);
+    }
+
+    void onNetworkUp()
+    {
+        Serial.printf("WiFi connected. IP address: %s (channel %d)\n", WiFi.localIP().toString().c_str(),
+                      WiFi.channel());
 
-        // Generate fresh SAS token with stack monitoring
-        Serial.printf("Free stack before SAS token: %d bytes\n", ESP.getFreeContStack());
-        sasToken = requestSasToken(host, deviceId, shareKey);
-        Serial.printf("Free stack after SAS token: %d bytes\n", ESP.getFreeContStack());
-        // Set token expiry time (refresh 5 minutes before actual expiry)
-        // Assuming token valid for 3600 seconds (1 hour)
-        tokenExpiryTime = millis() + 3300UL * 1000UL; // Refresh 5 minutes early
+        // The RTC estimate (if any) stays in use until SNTP answers
+        if (wakeState.needsTimeSync())
+            timeService.startSync();
     }
 
-    void syncTime()
+    // Once per boot, before signing a new one: the token left in RTC memory
+    void useCachedToken()
     {
-        configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-        Serial.print("Waiting for NTP time sync...");
-        time_t now = time(nullptr);
-        while (now < 8 * 3600 * 2)
-        { // Wait until we get a valid time
-            delay(500);
-            Serial.print(".");
-            now = time(nullptr);
+        if (cachedTokenChecked)
+            return;
+        cachedTokenChecked = true;
+
+        uint32_t now = timeService.now();
+        if (wakeState.tokenValid(now, SAS_TOKEN_REFRESH_MARGIN_S))
+        {
+            sasToken = wakeState.token();
+            tokenExpiryTime = millis() + (wakeState.tokenExpiresAt() - now - SAS_TOKEN_REFRESH_MARGIN_S) * 1000UL;
+            Serial.println("[WAKE] Reusing SAS token from RTC");
         }
-        Serial.println(" done!");
     }
 
-    String getTimestamp()
+    // Signs a token locally; the backend /sas endpoint is only a fallback
+    // (e.g. a key that does not decode). Expiry is tracked on millis() and
+    // refreshed SAS_TOKEN_REFRESH_MARGIN_S early.
+    void refreshSasToken()
     {
-        time_t now = time(nullptr);
-        struct tm *timeinfo = gmtime(&now);
-        char buf[30];
-        strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", timeinfo);
-        return String(buf);
+        PROFILE_SCOPE(STAGE_TOKEN);
+        char token[SasToken::MAX_LENGTH];
+        char resourceUri[96];
+        snprintf(resourceUri, sizeof(resourceUri), "%s/devices/%s", host, deviceId.c_str());
+
+        // Expiry needs wall-clock time; without it let the backend sign
+        uint32_t now = timeService.now();
+        bool clockValid = now != 0;
+
+        unsigned long started = millis();
+        if (clockValid &&
+            SasToken::generate(token, sizeof(token), resourceUri, shareKey.c_str(), now + SAS_TOKEN_TTL_S) > 0)
+        {
+            sasToken = token;
+            Serial.printf("SAS token signed locally in %lu ms\n", millis() - started);
+        }
+        else
+        {
+            Serial.printf("Local SAS signing %s, requesting token from backend\n",
+                          clockValid ? "failed" : "needs NTP time");
+            sasToken = requestSasToken(host, deviceId, shareKey);
+        }
+
+        tokenExpiryTime = millis() + (SAS_TOKEN_TTL_S - SAS_TOKEN_REFRESH_MARGIN_S) * 1000UL;
+        if (!sasToken.startsWith("Error"))
+            wakeState.recordToken(sasToken.c_str(), SasToken::expiry(sasToken.c_str()));
+        memoryMonitor.checkpoint(MEM_TOKEN);
     }
 
-    bool connect(int maxRetries = 3)
+    // Runs from scheduled tasks, so it never waits for Wi-Fi or SNTP: until
+    // both are ready it (re)starts the join and returns false. Attempts are
+    // made back to back; callers pace retries. The TLS handshake itself
+    // still blocks.
+    bool connect(int maxRetries = 3) override
     {
         // Prevent recursive calls that can cause stack overflow
         static bool connecting = false;
@@ -144,37 +249,59 @@ public:
             return true;
         }
 
+        if (!pollNetwork())
+        {
+            restartJoinIfFailed();
+            connecting = false;
+            return false;
+        }
+
+        // Token reuse and signing need wall-clock time; SNTP normally
+        // answered while the sensors were warming up
+        if (!timeService.settled())
+        {
+            connecting = false;
+            return false;
+        }
+        useCachedToken();
+
         // Check if token needs refresh
         if (millis() > tokenExpiryTime)
         {
             Serial.println("SAS token expired, regenerating...");
-            sasToken = requestSasToken(host, deviceId, shareKey);
-            tokenExpiryTime = millis() + 3300UL * 1000UL; // Refresh 5 minutes early
+            refreshSasToken();
         }
 
         if (sasToken.isEmpty() || sasToken.startsWith("Error"))
         {
             Serial.printf("Invalid SAS token: %s\n", sasToken.c_str());
             // Try to regenerate token
-            sasToken = requestSasToken(host, deviceId, shareKey);
-            tokenExpiryTime = millis() + 3300UL * 1000UL;
+            refreshSasToken();
             if (sasToken.isEmpty() || sasToken.startsWith("Error"))
             {
                 connecting = false;
                 return false;
             }
         }
+        wakeProbe.mark(WAKE_TOKEN);
+        prepareTlsConnect();
 
         String clientId = deviceId;
         String username = String(AZURE_IOT_HOST) + "/" + deviceId + "/?api-version=2021-04-12";
 
-        mqttClient.setServer(AZURE_IOT_HOST, 8883);
+        mqttClient.setServer(AZURE_IOT_HOST, port);
         mqttClient.setKeepAlive(60);
         mqttClient.setSocketTimeout(60); // 15 second socket timeout
 
         for (int attempt = 1; attempt <= maxRetries; attempt++)
         {
-            Serial.printf("MQTT connection attempt %d/%d\n", attempt, maxRetries);
+            TRACE(MQTT_CONNECT_ATTEMPT, attempt, maxRetries);
+
+            // Same session ID after the handshake means the server resumed it
+            uint8_t offeredId[32];
+            memcpy(offeredId, tlsSession.getSession()->session_id, sizeof(offeredId));
+            bool offered = tlsSession.getSession()->session_id_len != 0;
+            unsigned long started = millis();
 
             bool connected = mqttClient.connect(
                 clientId.c_str(),
@@ -183,7 +310,18 @@ public:
 
             if (connected)
             {
-                Serial.println("Connected to Azure IoT Hub.");
+                bool resumed = offered && memcmp(offeredId, tlsSession.getSession()->session_id, sizeof(offeredId)) == 0;
+                TRACE(MQTT_CONNECTED, millis() - started, resumed);
+                memoryMonitor.checkpoint(MEM_TLS_CONNECT);
+                tlsSessionStore.saveSession(tlsSession.getSession(), sizeof(br_ssl_session_parameters));
+                wakeProbe.mark(WAKE_MQTT);
+
+                // Clean session: the broker forgot anything still unacked
+                if (!inflight.empty())
+                {
+                    Serial.printf("[MQTT] Resending %u unacknowledged messages\n", (unsigned)inflight.pending());
+                    inflight.resendAll();
+                }
 
                 // Subscribe to direct methods topic
                 String methodTopic = "$iothub/methods/POST/#";
@@ -201,48 +339,16 @@ public:
             }
             else
             {
-                int state = mqttClient.state();
-                Serial.printf("Connection failed. State: %d\n", state);
-
-                // Print state meanings for debugging
-                switch (state)
+                // A failed handshake (e.g. pin mismatch) should not be resumed
+                char sslError[64];
+                int sslCode = wifiClient.getLastSSLError(sslError, sizeof(sslError));
+                TRACE(MQTT_CONNECT_FAILED, mqttClient.state(), sslCode);
+                Serial.printf("Connection failed. State: %d\n", mqttClient.state());
+                if (sslCode != 0)
                 {
-                case -4:
-                    Serial.println("MQTT_CONNECTION_TIMEOUT - the server didn't respond within the keepalive time");
-                    break;
-                case -3:
-                    Serial.println("MQTT_CONNECTION_LOST - the network connection was broken");
-                    break;
-                case -2:
-                    Serial.println("MQTT_CONNECT_FAILED - the network connection failed");
-                    break;
-                case -1:
-                    Serial.println("MQTT_DISCONNECTED - the client is disconnected cleanly");
-                    break;
-                case 1:
-                    Serial.println("MQTT_CONNECT_BAD_PROTOCOL - the server doesn't support the requested version of MQTT");
-                    break;
-                case 2:
-                    Serial.println("MQTT_CONNECT_BAD_CLIENT_ID - the server rejected the client identifier");
-                    break;
-                case 3:
-                    Serial.println("MQTT_CONNECT_UNAVAILABLE - the server was unable to accept the connection");
-                    break;
-                case 4:
-                    Serial.println("MQTT_CONNECT_BAD_CREDENTIALS - the username/password were rejected");
-                    break;
-                case 5:
-                    Serial.println("MQTT_CONNECT_UNAUTHORIZED - the client was not authorized to connect");
-                    break;
-                default:
-                    Serial.println("Unknown error");
-                    break;
-                }
-
-                if (attempt < maxRetries)
-                {
-                    Serial.printf("Retrying in 3 seconds...\n");
-                    delay(3000);
+                    Serial.printf("[TLS] Handshake error %d: %s\n", sslCode, sslError);
+                    tlsSessionStore.forgetSession();
+                    memset(tlsSession.getSession(), 0, sizeof(br_ssl_session_parameters));
                 }
             }
         }
@@ -263,9 +369,22 @@ public:
         }
         inLoop = true;
 
+        timeService.tick();
+
+        // Wi-Fi still associating: nothing to service yet. A failed join is
+        // restarted through connect() below, which returns straight away.
+        if (!pollNetwork() && wifiConnection.state() != WifiConnection::State::FAILED)
+        {
+            inLoop = false;
+            return;
+        }
+
         if (mqttClient.connected())
         {
+            // Reads PUBACKs first, so poll() only resends what is still unacked
             mqttClient.loop();
+            inflight.poll();
+            drainLog();
 
             // Process retry queue
             processRetryQueue();
@@ -275,7 +394,8 @@ public:
             // Try to reconnect if disconnected
             static unsigned long lastReconnectAttempt = 0;
             unsigned long now = millis();
-            if (now - lastReconnectAttempt > 5000) // Try reconnect every 5 seconds
+            // Wait for SNTP (or its timeout) here rather than blocking in connect()
+            if (timeService.settled() && now - lastReconnectAttempt > 5000) // Try reconnect every 5 seconds
             {
                 lastReconnectAttempt = now;
                 Serial.println("MQTT disconnected. Attempting to reconnect...");
@@ -292,16 +412,50 @@ public:
         return mqttClient.connected();
     }
 
-    // Add disconnect method for clean shutdown
+    bool connected() override
+    {
+        return mqttClient.connected();
+    }
+
+    // Wi-Fi up and SNTP answered (or given up on); a failed join is
+    // restarted rather than waited for
+    bool networkReady() override
+    {
+        restartJoinIfFailed();
+        return pollNetwork() && timeService.settled();
+    }
+
+    bool allDelivered() override
+    {
+        return inflight.empty() && !telemetryLog.hasUnread() && retryQueue.empty();
+    }
+
+    // Add disconnect method for clean shutdown. Waits for outstanding
+    // PUBACKs first so the last batch is not cut off.
     void disconnect()
     {
         if (mqttClient.connected())
         {
+            if (!inflight.drain(MQTT_ACK_TIMEOUT_MS))
+                Serial.printf("[MQTT] %u messages still unacknowledged\n", (unsigned)inflight.pending());
             mqttClient.disconnect();
             Serial.println("MQTT disconnected.");
         }
     }
 
+    // PUBACK for a telemetry message: only now does it count as sent
+    void onDelivered(uint32_t tag, uint32_t latencyMs) override
+    {
+        if (tag & LOG_TAG)
+            telemetryLog.acknowledge(tag & ~LOG_TAG);
+
+        totalDataSent++;
+        lastSuccessfulSend = millis();
+        lastSendStatus = true;
+        wakeProbe.mark(WAKE_FIRST_PUBLISH);
+        TRACE(MQTT_PUBACK, tag, latencyMs, totalDataSent);
+    }
+
     // Get detailed transmission statistics
     void printTransmissionStats()
     {
@@ -326,8 +480,14 @@ public:
         }
 
         Serial.printf("📱 Connection status: %s\n", mqttClient.connected() ? "CONNECTED" : "DISCONNECTED");
-        Serial.printf("🔄 Retry queue size: %d/%d\n", retryQueue.size(), MAX_QUEUE_SIZE);
-        Serial.printf("📄 Last payload: %s\n", lastSentPayload.c_str());
+        Serial.printf("📨 Awaiting PUBACK: %u/%d (resent %lu)\n", (unsigned)inflight.pending(), MQTT_INFLIGHT_WINDOW,
+                      (unsigned long)inflight.resent);
+        Serial.printf("🔄 Retry queue size: %u/%u (evicted %lu, expired %lu)\n", (unsigned)retryQueue.size(),
+                      (unsigned)RetryQueue::capacity(), (unsigned long)retryQueue.evicted,
+                      (unsigned long)retryQueue.expired);
+        Serial.printf("💾 Log backlog: %lu bytes (%lu segments dropped)\n", (unsigned long)telemetryLog.backlogBytes(),
+                      (unsigned long)telemetryLog.droppedSegments);
+        Serial.printf("📄 Last payload: %s\n", lastSentPayload);
         Serial.println("==========================================\n");
     }
 
@@ -365,156 +525,258 @@ public:
         }
     }
 
-    bool sendData(float pulseRate, float temperature, float spO2)
+    bool sendData(float pulseRate, float temperature, float spO2) override
     {
 
-        // Create payload for logging and tracking
-        char logPayload[80];
-        snprintf(logPayload, sizeof(logPayload),
+        // Short summary for logging and tracking
+        snprintf(lastSentPayload, sizeof(lastSentPayload),
                  "{\"deviceId\":\"%s\",\"pulseRate\":%d,\"temperature\":%d,\"spO2\":%d}",
                  deviceId.c_str(), (int)round(pulseRate), (int)round(temperature), (int)round(spO2));
-        lastSentPayload = String(logPayload);
 
-        Serial.printf("[SEND] Attempting to send: %s\n", logPayload);
-        Serial.printf("[STATS] Previous success: %lu, failures: %lu\n", totalDataSent, totalDataFailed);
+        // Switch to MQTT to avoid HTTPS stack overflow
+        // MQTT uses much less stack than HTTPS
+        bool result = sendDataViaMQTT(pulseRate, temperature, spO2);
 
-        // Print connection status for verification
-        if (mqttClient.connected())
-        {
-            Serial.println("[MQTT] Client connected - proceeding with QoS 1 transmission");
-        }
-        else
+        // Sent/acknowledged counts are updated from onDelivered()
+        if (!result)
         {
-            Serial.println("[MQTT] Client not connected - will attempt reconnection");
+            totalDataFailed++;
+            lastSendStatus = false;
+            Serial.printf("[FAILED] Data could not be queued for sending! Total failures: %lu\n", totalDataFailed);
         }
 
-        // Switch to MQTT to avoid HTTPS stack overflow
-        // MQTT uses much less stack than HTTPS
-        bool result = sendDataViaMQTT(pulseRate, temperature, spO2);
+        return result;
+
+        // HTTP disabled due to stack overflow issues
+        // return sendDataViaHTTP(pulseRate, temperature, spO2);
+    }
 
-        // Update statistics and provide detailed feedback
-        if (result)
+    // Send a batch of window summaries as one telemetry message. The batch
+    // goes to the flash log first and is published from there, so it
+    // survives a dropped link or reboot until the broker acknowledges it.
+    bool sendBatch(const TelemetryBatch &batch) override
+    {
+        uint8_t flags;
+        uint32_t baseTime = batchTime(batch, flags);
+        if (telemetryLog.appendBatch(batch, baseTime, flags))
         {
-            totalDataSent++;
-            lastSuccessfulSend = millis();
-            lastSendStatus = true;
-            Serial.printf("[SUCCESS] Data handed off to TCP layer! Total sent: %lu\n", totalDataSent);
-            Serial.println("[INFO] Note: This confirms TCP handoff, not Azure IoT Hub receipt");
-            Serial.println("[INFO] Monitor Azure IoT Hub to verify actual receipt");
+            drainLog();
+            return true;
         }
-        else
+
+        bool result = sendBatchViaMQTT(batch);
+
+        if (!result)
         {
             totalDataFailed++;
             lastSendStatus = false;
-            Serial.printf("[FAILED] Data send failed at TCP layer! Total failures: %lu\n", totalDataFailed);
+            Serial.printf("[FAILED] Batch could not be queued for sending! Total failures: %lu\n", totalDataFailed);
         }
 
         return result;
+    }
 
-        // HTTP disabled due to stack overflow issues
-        // return sendDataViaHTTP(pulseRate, temperature, spO2);
+    // Stage latency histograms as one QoS 0 message. Sleep entry and
+    // wake-to-sleep are the previous wake's, carried over in RTC memory.
+    bool publishMetrics()
+    {
+        char topic[MQTT_INFLIGHT_TOPIC];
+        snprintf(topic, sizeof(topic), "devices/%s/messages/events/$.ct=application%%2Fjson&type=metrics",
+                 deviceId.c_str());
+
+        size_t length = stageProfiler.formatMetrics((char *)payloadBuffer, sizeof(payloadBuffer), FIRMWARE_VERSION);
+        return length > 0 && mqttClient.connected() && mqttClient.publish(topic, payloadBuffer, length);
+    }
+
+    // Device health as one QoS 0 message: battery, link and the memory
+    // watermarks for this wake ("mem") and across wakes ("memWorst")
+    bool publishHealth()
+    {
+        char topic[MQTT_INFLIGHT_TOPIC];
+        snprintf(topic, sizeof(topic), "devices/%s/messages/events/$.ct=application%%2Fjson&type=health",
+                 deviceId.c_str());
+
+        char *out = (char *)payloadBuffer;
+        size_t capacity = sizeof(payloadBuffer);
+        MemorySnapshot now = systemMemory().snapshot();
+        int used = snprintf(out, capacity,
+                            "{\"fw\":\"%s\",\"wake\":%lu,\"battery\":%d,\"rssi\":%d,\"heap\":[%lu,%lu,%u,%lu],\"mem\":",
+                            FIRMWARE_VERSION, (unsigned long)wakeState.wakeCount(), deviceState.getBatteryPercent(),
+                            WiFi.isConnected() ? (int)WiFi.RSSI() : 0, (unsigned long)now.freeHeap,
+                            (unsigned long)now.maxFreeBlock, now.fragmentation, (unsigned long)now.freeStack);
+        if (used <= 0 || (size_t)used >= capacity)
+            return false;
+
+        size_t length = used;
+        size_t part = memoryMonitor.formatJson(out + length, capacity - length, false);
+        if (part == 0)
+            return false;
+        length += part;
+        used = snprintf(out + length, capacity - length, ",\"memWorst\":");
+        length += used;
+        part = length < capacity ? memoryMonitor.formatJson(out + length, capacity - length, true) : 0;
+        if (part == 0 || length + part + 1 >= capacity)
+            return false;
+        length += part;
+        out[length++] = '}';
+
+        return mqttClient.connected() && mqttClient.publish(topic, payloadBuffer, length);
     }
 
 private:
-    // Method 1: Send telemetry via MQTT with QoS 1 for delivery confirmation
-    bool sendDataViaMQTT(float pulseRate, float temperature, float spO2)
+    // Server authentication from env.h, strongest first: a root CA (survives
+    // leaf certificate rotation), the leaf public key, or its SHA-1
+    // fingerprint. Without one the link is encrypted but not authenticated.
+    void configureTls()
     {
-        if (!mqttClient.connected())
+#if defined(AZURE_IOT_ROOT_CA)
+        wifiClient.setTrustAnchors(&trustAnchors);
+        Serial.println("[TLS] Verifying IoT Hub against pinned root CA");
+#elif defined(AZURE_IOT_PUBLIC_KEY)
+        wifiClient.setKnownKey(&pinnedKey);
+        Serial.println("[TLS] Verifying IoT Hub against pinned public key");
+#elif defined(AZURE_IOT_FINGERPRINT)
+        wifiClient.setFingerprint(AZURE_IOT_FINGERPRINT);
+        Serial.println("[TLS] Verifying IoT Hub against pinned fingerprint");
+#else
+        wifiClient.setInsecure();
+        Serial.println("[TLS] WARNING: no AZURE_IOT_ROOT_CA, AZURE_IOT_PUBLIC_KEY or AZURE_IOT_FINGERPRINT in env.h, "
+                       "server certificate is not verified");
+#endif
+
+        wifiClient.setSession(&tlsSession);
+        if (tlsSessionStore.restore(host, port) &&
+            tlsSessionStore.session(tlsSession.getSession(), sizeof(br_ssl_session_parameters)))
+            Serial.println("[TLS] Restored session from RTC, next handshake can resume");
+    }
+
+    // Just before the handshake: record size (probed once per cold boot,
+    // then remembered in RTC) and the time for certificate validity checks
+    void prepareTlsConnect()
+    {
+        if (tlsSessionStore.mfln() == TlsSessionStore::MFLN_UNKNOWN)
         {
-            Serial.println("MQTT not connected. Attempting reconnect...");
-            if (!connect())
-                return false;
+            bool supported = WiFiClientSecure::probeMaxFragmentLength(host, port, TLS_MFLN_SIZE);
+            tlsSessionStore.recordMfln(supported);
+            Serial.printf("[TLS] MFLN %u %s by server\n", TLS_MFLN_SIZE, supported ? "supported" : "not supported");
         }
 
-        // Create proper telemetry payload using JsonDocument
-        JsonDocument doc;
-        doc["deviceId"] = deviceId;
-        doc["pulseRate"] = pulseRate;
-        doc["temperature"] = temperature;
-        doc["sp02"] = spO2;
-        // Add timestamp
-        doc["timestamp"] = getTimestamp();
+        bool mfln = tlsSessionStore.mfln() == TlsSessionStore::MFLN_SUPPORTED;
+        wifiClient.setBufferSizes(mfln ? TLS_MFLN_SIZE : TLS_FULL_RECORD_SIZE, TLS_MFLN_SIZE);
 
-        char payload[256]; // Increased buffer size to accommodate timestamp
-        serializeJson(doc, payload);
+        uint32_t now = timeService.now();
+        if (now != 0)
+            wifiClient.setX509Time(now);
+    }
 
-        // MQTT topic for telemetry (device-to-cloud messages)
-        String topic = "devices/" + String(deviceId) + "/messages/events/";
+    void buildTelemetryTopic()
+    {
+        snprintf(telemetryTopic, sizeof(telemetryTopic), "devices/%s/messages/events/%s", deviceId.c_str(),
+                 TELEMETRY_CODEC == TELEMETRY_CODEC_CBOR ? TELEMETRY_CBOR_TOPIC_PROPERTIES : "");
+    }
 
-        Serial.printf("[MQTT] Publishing to topic: %s\n", topic.c_str());
-        Serial.printf("[MQTT] Payload: %s\n", payload);
+    // Wall-clock time of the first window, converted from its millis() stamp now
+    uint32_t batchTime(const TelemetryBatch &batch, uint8_t &flags)
+    {
+        flags = 0;
+        uint32_t baseTime = timeService.epochAt(batch.baseMs);
+        if (baseTime == 0)
+        {
+            baseTime = batch.baseMs / 1000;
+            flags = TELEMETRY_FLAG_MONOTONIC_TIME;
+        }
+        return baseTime;
+    }
+
+    // Publishes unread log entries while the window has room. Each message
+    // carries its log tag; the PUBACK moves the log cursor past it.
+    void drainLog()
+    {
+        if (!mqttClient.connected())
+            return;
+        if (telemetryTopic[0] == '\0')
+            buildTelemetryTopic();
+
+        TelemetryBatch batch;
+        uint32_t baseTime, tag;
+        uint8_t flags;
+        while (!inflight.full() && telemetryLog.readBatch(batch, baseTime, flags, tag))
+        {
+            size_t length = TelemetryCodec::encodeBatchSelected(payloadBuffer, sizeof(payloadBuffer), deviceId.c_str(),
+                                                                baseTime, batch, flags);
+            if (length == 0 || !inflight.publish(telemetryTopic, payloadBuffer, length, LOG_TAG | tag))
+            {
+                // Cannot fit a message even into an empty slot: skip it
+                // rather than hold the cursor back forever
+                Serial.printf("[LOG] Dropping logged batch %lu, payload does not fit\n", (unsigned long)tag);
+                telemetryLog.acknowledge(tag);
+                continue;
+            }
+            lastPublishTime = millis();
+            TRACE(MQTT_LOG_PUBLISH, tag, batch.count, length);
+            memoryMonitor.checkpoint(MEM_PUBLISH);
+        }
+    }
+
+    // Summaries of all windows in one message, timestamped at the first window
+    bool sendBatchViaMQTT(const TelemetryBatch &batch)
+    {
+        uint8_t flags;
+        uint32_t baseTime = batchTime(batch, flags);
+        size_t length = TelemetryCodec::encodeBatchSelected(payloadBuffer, sizeof(payloadBuffer), deviceId.c_str(),
+                                                            baseTime, batch, flags);
+        return publishTelemetry(length);
+    }
+
+    // Method 1: Send telemetry via MQTT
+    bool sendDataViaMQTT(float pulseRate, float temperature, float spO2)
+    {
+        uint8_t flags = 0;
+        uint32_t now = timeService.now();
+        if (now == 0)
+        {
+            now = millis() / 1000;
+            flags = TELEMETRY_FLAG_MONOTONIC_TIME;
+        }
+        size_t length = TelemetryCodec::encodeReadingSelected(payloadBuffer, sizeof(payloadBuffer), deviceId.c_str(),
+                                                              now, pulseRate, temperature, spO2, flags);
+        return publishTelemetry(length);
+    }
+
+    // Hands payloadBuffer to the in-flight window, which copies it into a
+    // slot and publishes it at QoS 1. Only a full window falls back to the
+    // retry queue, whose entries fit a single reading but not a batch.
+    bool publishTelemetry(size_t length)
+    {
+        if (length == 0)
+        {
+            Serial.println("[MQTT] Payload does not fit the telemetry buffer");
+            return false;
+        }
+        if (telemetryTopic[0] == '\0')
+            buildTelemetryTopic();
 
-        // Generate unique message ID for tracking
         messageId++;
         if (messageId == 0)
             messageId = 1; // Avoid 0 as message ID
         lastPublishTime = millis();
 
-        Serial.printf("[MQTT] Using message tracking ID: %u\n", messageId);
-
-        // PubSubClient doesn't support QoS directly, but we can still track delivery
-        // by monitoring connection status and implementing application-level ACK
-        bool success = mqttClient.publish(topic.c_str(), payload);
+        bool success = inflight.publish(telemetryTopic, payloadBuffer, length, messageId);
 
         if (success)
         {
-            Serial.println("[MQTT] ✅ Message handed off to TCP layer successfully");
-            Serial.printf("[MQTT] Message ID %u sent at %lu ms\n", messageId, lastPublishTime);
-            Serial.println("Payload sent:");
-            Serial.println(payload);
-            Serial.println("[INFO] 🔍 To verify Azure IoT Hub receipt:");
-            Serial.println("[INFO]   - Azure Portal: IoT Hub > Devices > Device Telemetry");
-            Serial.println("[INFO]   - Azure Portal: IoT Hub > Monitoring > Metrics");
-            Serial.println("[INFO]   - Check 'Telemetry messages sent' and 'Device-to-cloud messages' metrics");
+            TRACE(MQTT_PUBLISH, messageId, length);
+            memoryMonitor.checkpoint(MEM_PUBLISH);
             return true;
         }
-        else
-        {
-            Serial.println("[MQTT] ❌ Failed to publish message.");
-            Serial.printf("[MQTT] Client State: %d\n", mqttClient.state());
 
-            // Decode MQTT client state for better debugging
-            switch (mqttClient.state())
-            {
-            case -4:
-                Serial.println("[MQTT] State: CONNECTION_TIMEOUT");
-                break;
-            case -3:
-                Serial.println("[MQTT] State: CONNECTION_LOST");
-                break;
-            case -2:
-                Serial.println("[MQTT] State: CONNECT_FAILED");
-                break;
-            case -1:
-                Serial.println("[MQTT] State: DISCONNECTED");
-                break;
-            case 0:
-                Serial.println("[MQTT] State: CONNECTED");
-                break;
-            case 1:
-                Serial.println("[MQTT] State: CONNECT_BAD_PROTOCOL");
-                break;
-            case 2:
-                Serial.println("[MQTT] State: CONNECT_BAD_CLIENT_ID");
-                break;
-            case 3:
-                Serial.println("[MQTT] State: CONNECT_UNAVAILABLE");
-                break;
-            case 4:
-                Serial.println("[MQTT] State: CONNECT_BAD_CREDENTIALS");
-                break;
-            case 5:
-                Serial.println("[MQTT] State: CONNECT_UNAUTHORIZED");
-                break;
-            default:
-                Serial.printf("[MQTT] State: UNKNOWN (%d)\n", mqttClient.state());
-                break;
-            }
-
-            // Add to retry queue if space available
-            addToRetryQueue(topic, String(payload));
-            return false;
-        }
+        TRACE(MQTT_WINDOW_FULL, inflight.pending(), mqttClient.state());
+        if (retryQueue.push(telemetryTopic, payloadBuffer, length, RetryQueue::TELEMETRY, messageId))
+            TRACE(MQTT_RETRY_QUEUED, messageId, retryQueue.size());
+        else
+            Serial.printf("[MQTT] Message %lu (%u bytes) dropped, retry queue cannot take it\n",
+                          (unsigned long)messageId, (unsigned)length);
+        return false;
     }
 
     // Method 2: Send telemetry via HTTP REST API (like Python example)
@@ -582,78 +844,56 @@ private:
     //  > if theres no device in database, then create new device to azure
     //  > else use existing device
 
-    // Add data to retry queue
-    void addToRetryQueue(const String &topic, const String &payload)
-    {
-        if (retryQueue.size() >= MAX_QUEUE_SIZE)
-        {
-            Serial.println("[RETRY] Queue full, removing oldest entry");
-            retryQueue.erase(retryQueue.begin());
-        }
-
-        QueuedData data;
-        data.topic = topic;
-        data.payload = payload;
-        data.timestamp = millis();
-        data.retryCount = 0;
-
-        retryQueue.push_back(data);
-        Serial.printf("[RETRY] Added to queue. Queue size: %d\n", retryQueue.size());
-    }
-
-    // Process retry queue
+    // Hands ready entries to the client, direct-method replies first.
+    // Telemetry waits while the in-flight window is full without using up
+    // an attempt; a failed publish backs the entry off.
     void processRetryQueue()
     {
-        if (retryQueue.empty() || !mqttClient.connected())
+        while (mqttClient.connected())
         {
-            return;
-        }
+            RetryQueue::Entry *entry = retryQueue.nextReady();
+            if (!entry)
+                return;
 
-        unsigned long now = millis();
-        for (auto it = retryQueue.begin(); it != retryQueue.end();)
-        {
-            // Wait at least 30 seconds between retries
-            if (now - it->timestamp > 30000)
+            bool success;
+            if (entry->priority == RetryQueue::RESPONSE)
             {
-                Serial.printf("[RETRY] Attempting retry %d/%d for topic: %s\n",
-                              it->retryCount + 1, MAX_RETRIES, it->topic.c_str());
-
-                bool success = mqttClient.publish(it->topic.c_str(), it->payload.c_str());
+                success = mqttClient.publish(entry->topic, entry->payload, entry->length);
+            }
+            else
+            {
+                if (inflight.full())
+                    return;
+                success = inflight.publish(entry->topic, entry->payload, entry->length, entry->tag);
+            }
 
-                if (success)
-                {
-                    Serial.println("[RETRY] Retry successful, removing from queue");
-                    it = retryQueue.erase(it);
-                }
-                else
-                {
-                    it->retryCount++;
-                    if (it->retryCount >= MAX_RETRIES)
-                    {
-                        Serial.println("[RETRY] Max retries reached, removing from queue");
-                        it = retryQueue.erase(it);
-                    }
-                    else
-                    {
-                        it->timestamp = now; // Update for next retry
-                        ++it;
-                    }
-                }
+            if (success)
+            {
+                TRACE(MQTT_RETRY_SENT, entry->attempts, (uint8_t)entry->priority);
+                retryQueue.remove(entry);
             }
             else
             {
-                ++it;
+                TRACE(MQTT_RETRY_FAILED, entry->attempts + 1, (uint8_t)entry->priority);
+                retryQueue.retryLater(entry);
             }
         }
     }
 
+    // Fallback only: a TLS handshake plus HTTP POST that sends the key to the backend
     String requestSasToken(const String &uri, const String &deviceId, const String &primaryKey)
     {
         HTTPClient http;
         String serverUrl = "https://ternak-aja-backend-c7fad0cgb8dmchh0.canadacentral-01.azurewebsites.net/sas";
 
+        // Own client: the hub's pins and cached session do not apply to the backend
+        WiFiClientSecure backendClient;
+        backendClient.setInsecure();
+        backendClient.setBufferSizes(TLS_FULL_RECORD_SIZE, TLS_MFLN_SIZE);
+        backendClient.setTimeout(5000);
+
         // Initialize HTTP client with minimal settings to reduce stack usage
-        if (!http.begin(wifiClient, serverUrl))
+        if (!http.begin(backendClient, serverUrl))
         {
             Serial.println("HTTP client initialization failed");
             return "Error: HTTP init failed";
@@ -725,7 +965,7 @@ private:
         }
         message[length] = '\0'; // Null terminate
 
-        Serial.printf("Message arrived [%s] %.*s\n", topic, (int)length, message);
+        TRACE(MQTT_RX, length);
 
         // Handle direct methods (like Python example)
         if (strncmp(topic, "$iothub/methods/POST/", 21) == 0)
@@ -738,7 +978,7 @@ private:
 
             if (methodEnd)
             {
-                char methodBuffer[16]; // Even smaller buffer for method name
+                char methodBuffer[24]; // Longest method name is setSleepInterval
                 size_t methodLen = methodEnd - methodStart;
                 if (methodLen >= sizeof(methodBuffer))
                     methodLen = sizeof(methodBuffer) - 1;
@@ -793,9 +1033,41 @@ private:
         }
         else if (methodName == "setSleepInterval")
         {
-            // Simplified - just acknowledge without parsing to save stack
-            response = "{\"result\":\"OK\"}";
-            Serial.printf("Direct method: setSleepInterval received\n");
+            // {"seconds": n} pins the sleep, {"min": a, "max": b} bounds the
+            // adaptive policy, {} hands it back the full range
+            JsonDocument doc;
+            if (deserializeJson(doc, payload))
+            {
+                response = "{\"error\":\"Invalid JSON\"}";
+                statusCode = 400;
+            }
+            else
+            {
+                uint32_t seconds = doc["seconds"] | 0;
+                uint32_t minS = doc["min"] | seconds;
+                uint32_t maxS = doc["max"] | seconds;
+                // Past the deep-sleep limit the bounds are trimmed; the ack
+                // says so and carries what was applied
+                bool exact = dutyCycle.setBounds(minS, maxS);
+                static char ack[80];
+                snprintf(ack, sizeof(ack), "{\"result\":\"%s\",\"min\":%lu,\"max\":%lu,\"limit\":%lu}",
+                         exact ? "OK" : "TRIMMED", (unsigned long)dutyCycle.boundMin(),
+                         (unsigned long)dutyCycle.boundMax(), (unsigned long)dutyCycle.maxSleepS());
+                response = ack;
+                Serial.printf("Direct method: sleep bounded to [%lu, %lu] s%s\n", (unsigned long)dutyCycle.boundMin(),
+                              (unsigned long)dutyCycle.boundMax(), exact ? "" : " (trimmed)");
+            }
+        }
+        else if (methodName == "dumpTrace")
+        {
+            // Binary trace ring as device-to-cloud messages
+            if (instance && instance->publishTrace())
+                response = "{\"result\":\"OK\"}";
+            else
+            {
+                response = "{\"error\":\"Trace not sent\"}";
+                statusCode = 500;
+            }
         }
         else
         {
@@ -812,26 +1084,41 @@ private:
         }
     }
 
+    // Publishes the trace ring at QoS 0 in as many messages as it takes,
+    // each a TraceBuffer dump that scripts/decode_trace.py reads
+    bool publishTrace()
+    {
+        char topic[MQTT_INFLIGHT_TOPIC];
+        snprintf(topic, sizeof(topic), "devices/%s/messages/events/$.ct=application%%2Foctet-stream&type=trace",
+                 deviceId.c_str());
+
+        // The window keeps its own copies, so payloadBuffer is free here
+        uint32_t from = 0;
+        size_t length;
+        while ((length = traceBuffer.dump(payloadBuffer, sizeof(payloadBuffer), from)) > 0)
+        {
+            if (!mqttClient.publish(topic, payloadBuffer, length))
+                return false;
+        }
+        return true;
+    }
+
     // Send response for direct method back to Azure IoT Hub
     void sendDirectMethodResponse(const String &requestId, int statusCode, const String &responseJson)
     {
-        String topic = "$iothub/methods/res/" + String(statusCode) + "/?$rid=" + requestId;
+        char topic[MQTT_INFLIGHT_TOPIC];
+        snprintf(topic, sizeof(topic), "$iothub/methods/res/%d/?$rid=%s", statusCode, requestId.c_str());
+        const uint8_t *payload = (const uint8_t *)responseJson.c_str();
 
-        if (mqttClient.connected())
+        if (mqttClient.connected() && mqttClient.publish(topic, payload, responseJson.length()))
         {
-            bool success = mqttClient.publish(topic.c_str(), responseJson.c_str());
-            if (success)
-            {
-                Serial.printf("[MQTT] Direct method response sent: %s -> %s\n", topic.c_str(), responseJson.c_str());
-            }
-            else
-            {
-                Serial.printf("[MQTT] Failed to send direct method response to topic: %s\n", topic.c_str());
-            }
-        }
-        else
-        {
-            Serial.println("[MQTT] Cannot send direct method response - not connected");
+            Serial.printf("[MQTT] Direct method response sent: %s -> %s\n", topic, responseJson.c_str());
+            return;
         }
+
+        // Queued ahead of any telemetry, until the hub stops waiting
+        Serial.printf("[MQTT] Direct method response to %s not sent, queued for retry\n", topic);
+        retryQueue.push(topic, payload, responseJson.length(), RetryQueue::RESPONSE, 0,
+                        DIRECT_METHOD_RESPONSE_TTL_MS);
     }
 };
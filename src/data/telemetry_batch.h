@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../utils/running_stats.h"
+
+// Length of one aggregated window and how many windows go in one message.
+// Override with -D in platformio.ini build_flags.
+#ifndef TELEMETRY_WINDOW_MS
+#define TELEMETRY_WINDOW_MS 10000
+#endif
+
+#ifndef TELEMETRY_BATCH_SIZE
+#define TELEMETRY_BATCH_SIZE 6
+#endif
+
+// 1: one message per batch of window summaries, 0: one averaged reading
+#ifndef TELEMETRY_BATCHING
+#define TELEMETRY_BATCHING 1
+#endif
+
+struct VitalSummary
+{
+    float mean;
+    float min;
+    float max;
+    uint16_t count; // Valid samples behind the numbers
+
+    void from(const RunningStats &stats)
+    {
+        mean = stats.mean();
+        min = stats.min();
+        max = stats.max();
+        count = (uint16_t)stats.count();
+    }
+};
+
+// Summary of one window, timestamped relative to the batch base
+struct TelemetryWindow
+{
+    uint32_t offsetMs;
+    uint16_t samples;
+    uint8_t quality; // Percent of samples with a finger on the sensor
+    VitalSummary bpm;
+    VitalSummary temperature;
+    VitalSummary spO2;
+};
+
+// Windows sharing one header (device id, base timestamp) on the wire.
+// baseMs is the millis() at which the first window started; the sender
+// converts it to wall-clock time when it builds the message.
+class TelemetryBatch
+{
+public:
+    static const uint8_t CAPACITY = TELEMETRY_BATCH_SIZE;
+
+    uint32_t baseMs = 0;
+    uint32_t windowMs = TELEMETRY_WINDOW_MS;
+    uint8_t count = 0;
+    TelemetryWindow windows[CAPACITY];
+
+    void clear() { count = 0; }
+    bool empty() const { return count == 0; }
+    bool full(uint8_t limit = CAPACITY) const { return count >= (limit < CAPACITY ? limit : CAPACITY); }
+
+    // Returns false when the batch is already full
+    bool add(uint32_t windowStartMs, const RunningStats &bpm, const RunningStats &temperature,
+             const RunningStats &spO2)
+    {
+        if (count >= CAPACITY)
+            return false;
+        if (count == 0)
+            baseMs = windowStartMs;
+
+        TelemetryWindow &window = windows[count++];
+        window.offsetMs = windowStartMs - baseMs;
+        window.samples = (uint16_t)(bpm.count() + bpm.skippedCount());
+        window.quality = window.samples ? (uint8_t)(bpm.count() * 100 / window.samples) : 0;
+        window.bpm.from(bpm);
+        window.temperature.from(temperature);
+        window.spO2.from(spO2);
+        return true;
+    }
+};
@@ -0,0 +1,467 @@
+#include "telemetry_log.h"
+#include "codec/telemetry_schema.h"
+#include "../utils/crc32.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t SEGMENT_MAGIC = 0x544C4F47; // "TLOG"
+static const uint32_t CURSOR_MAGIC = 0x54435552;  // "TCUR"
+static const uint8_t RECORD_MARKER = 0xA5;
+static const uint8_t RECORD_WINDOW = 1;
+static const char *CURSOR_PATH = "/tlog-cursor.bin";
+
+// Windows further apart than this start a new message
+static const uint32_t MAX_BATCH_SPAN_S = 86400;
+
+// Reads and appends go through a chunk of this size, so a segment is
+// scanned with a few file opens rather than one per record
+static const size_t CHUNK_BYTES = 512;
+
+struct SegmentHeader
+{
+    uint32_t magic;
+    uint32_t sequence;
+};
+
+struct RecordHeader
+{
+    uint16_t length;
+    uint8_t type;
+    uint8_t marker;
+    uint32_t crc; // Over the first four header bytes and the payload
+};
+
+struct CursorRecord
+{
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t offset;
+    uint32_t crc;
+};
+
+static const uint32_t DATA_START = sizeof(SegmentHeader);
+static const size_t RECORD_BYTES = sizeof(RecordHeader) + sizeof(LoggedWindow);
+
+static_assert(sizeof(LoggedWindow) == 32, "LoggedWindow is an on-flash format");
+static_assert(DATA_START + RECORD_BYTES <= TELEMETRY_LOG_SEGMENT_BYTES, "Segment too small for a record");
+
+TelemetryLog telemetryLog(systemFiles());
+
+enum ParseResult
+{
+    PARSE_OK,
+    PARSE_NEED_MORE,
+    PARSE_BAD
+};
+
+static uint32_t recordCrc(const RecordHeader &header, const void *payload)
+{
+    return crc32(payload, header.length, crc32(&header, offsetof(RecordHeader, crc)));
+}
+
+static ParseResult parseRecord(const uint8_t *data, size_t available, LoggedWindow &window, size_t &consumed)
+{
+    if (available < sizeof(RecordHeader))
+        return PARSE_NEED_MORE;
+
+    RecordHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.marker != RECORD_MARKER || header.type != RECORD_WINDOW || header.length != sizeof(LoggedWindow))
+        return PARSE_BAD;
+    if (available < sizeof(RecordHeader) + header.length)
+        return PARSE_NEED_MORE;
+    if (recordCrc(header, data + sizeof(RecordHeader)) != header.crc)
+        return PARSE_BAD;
+
+    memcpy(&window, data + sizeof(RecordHeader), sizeof(window));
+    consumed = sizeof(RecordHeader) + header.length;
+    return PARSE_OK;
+}
+
+static int16_t toFixed(float value, int32_t scale)
+{
+    long fixed = lroundf(value * scale);
+    if (fixed > INT16_MAX)
+        return INT16_MAX;
+    if (fixed < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)fixed;
+}
+
+static void toSummary(VitalSummary &summary, const int16_t fixed[3], int32_t scale, uint16_t count)
+{
+    summary.mean = (float)fixed[0] / scale;
+    summary.min = (float)fixed[1] / scale;
+    summary.max = (float)fixed[2] / scale;
+    summary.count = count;
+}
+
+TelemetryLog::TelemetryLog(FileStore &store) : files(store) {}
+
+void TelemetryLog::segmentPath(char *out, size_t size, uint32_t sequence)
+{
+    snprintf(out, size, "/tlog-%u.bin", (unsigned)(sequence % TELEMETRY_LOG_SEGMENTS));
+}
+
+bool TelemetryLog::before(const Position &a, const Position &b)
+{
+    return a.sequence < b.sequence || (a.sequence == b.sequence && a.offset < b.offset);
+}
+
+bool TelemetryLog::begin()
+{
+    ready = false;
+    if (!files.begin())
+        return false;
+
+    oldestSequence = headSequence = 0;
+    for (uint32_t slot = 0; slot < TELEMETRY_LOG_SEGMENTS; slot++)
+    {
+        char path[24];
+        segmentPath(path, sizeof(path), slot);
+        SegmentHeader header;
+        if (files.read(path, 0, &header, sizeof(header)) != (int)sizeof(header) || header.magic != SEGMENT_MAGIC ||
+            header.sequence == 0 || header.sequence % TELEMETRY_LOG_SEGMENTS != slot)
+            continue;
+
+        if (oldestSequence == 0 || header.sequence < oldestSequence)
+            oldestSequence = header.sequence;
+        if (header.sequence > headSequence)
+            headSequence = header.sequence;
+    }
+
+    if (headSequence == 0)
+    {
+        // Fresh partition
+        if (!startSegment(1))
+            return false;
+    }
+    else
+    {
+        // Segments older than a full ring are stale slots, not part of it
+        if (headSequence - oldestSequence >= TELEMETRY_LOG_SEGMENTS)
+            oldestSequence = headSequence - TELEMETRY_LOG_SEGMENTS + 1;
+
+        // A torn last record (power cut mid-write) would hide anything
+        // appended after it, so continue in a fresh segment
+        uint32_t end;
+        bool clean = validTail(headSequence, end);
+        headSize = end;
+        if (!clean && !startSegment(headSequence + 1))
+            return false;
+    }
+
+    loadCursor();
+    readPos = cursor;
+    pendingCount = 0;
+    ready = true;
+    return true;
+}
+
+// True if the segment is whole records up to its end; end is where the
+// valid records stop either way
+bool TelemetryLog::validTail(uint32_t sequence, uint32_t &end)
+{
+    char path[24];
+    segmentPath(path, sizeof(path), sequence);
+    long size = files.size(path);
+    end = DATA_START;
+    if (size < (long)DATA_START)
+        return false;
+
+    uint8_t chunk[CHUNK_BYTES];
+    uint32_t offset = DATA_START;
+    while (offset < (uint32_t)size)
+    {
+        int got = files.read(path, offset, chunk, sizeof(chunk));
+        if (got <= 0)
+            break;
+
+        size_t used = 0;
+        LoggedWindow window;
+        size_t consumed;
+        ParseResult result;
+        while ((result = parseRecord(chunk + used, (size_t)got - used, window, consumed)) == PARSE_OK)
+            used += consumed;
+
+        if (result == PARSE_BAD || used == 0)
+        {
+            end = offset + used;
+            return false;
+        }
+        offset += used;
+    }
+
+    end = offset;
+    return offset == (uint32_t)size;
+}
+
+bool TelemetryLog::startSegment(uint32_t sequence)
+{
+    while (oldestSequence != 0 && sequence - oldestSequence >= TELEMETRY_LOG_SEGMENTS)
+        dropOldest();
+
+    // Same slot as the segment just dropped: write() replaces it
+    char path[24];
+    segmentPath(path, sizeof(path), sequence);
+    SegmentHeader header = {SEGMENT_MAGIC, sequence};
+    if (!files.write(path, &header, sizeof(header)))
+        return false;
+
+    headSequence = sequence;
+    headSize = DATA_START;
+    if (oldestSequence == 0)
+        oldestSequence = sequence;
+    return true;
+}
+
+void TelemetryLog::dropOldest()
+{
+    if (cursor.sequence <= oldestSequence)
+        droppedSegments++; // Overwriting data that was never acknowledged
+
+    oldestSequence++;
+    Position first = {oldestSequence, DATA_START};
+    if (before(cursor, first))
+        cursor = first;
+    if (before(readPos, first))
+        readPos = first;
+    for (uint8_t i = 0; i < pendingCount; i++)
+    {
+        if (before(pending[i].end, first))
+            pending[i].end = first;
+    }
+}
+
+void TelemetryLog::loadCursor()
+{
+    CursorRecord record;
+    bool valid = files.read(CURSOR_PATH, 0, &record, sizeof(record)) == (int)sizeof(record) &&
+                 record.magic == CURSOR_MAGIC && record.crc == crc32(&record, offsetof(CursorRecord, crc));
+
+    Position first = {oldestSequence, DATA_START};
+    Position head = {headSequence, headSize};
+    cursor = valid ? Position{record.sequence, record.offset} : first;
+    if (before(cursor, first))
+        cursor = first;
+    if (before(head, cursor))
+        cursor = head;
+}
+
+bool TelemetryLog::saveCursor()
+{
+    CursorRecord record = {CURSOR_MAGIC, cursor.sequence, cursor.offset, 0};
+    record.crc = crc32(&record, offsetof(CursorRecord, crc));
+    return files.write(CURSOR_PATH, &record, sizeof(record));
+}
+
+bool TelemetryLog::append(const LoggedWindow &window)
+{
+    if (!ready)
+        return false;
+    if (headSize + RECORD_BYTES > TELEMETRY_LOG_SEGMENT_BYTES && !startSegment(headSequence + 1))
+        return false;
+
+    uint8_t record[RECORD_BYTES];
+    RecordHeader header = {sizeof(LoggedWindow), RECORD_WINDOW, RECORD_MARKER, 0};
+    header.crc = recordCrc(header, &window);
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), &window, sizeof(window));
+
+    char path[24];
+    segmentPath(path, sizeof(path), headSequence);
+    if (!files.append(path, record, sizeof(record)))
+        return false;
+
+    headSize += sizeof(record);
+    appended++;
+    return true;
+}
+
+bool TelemetryLog::appendBatch(const TelemetryBatch &batch, uint32_t baseTimestamp, uint8_t flags)
+{
+    if (!ready)
+        return false;
+
+    // Records are gathered and appended per chunk, split at segment ends
+    uint8_t chunk[CHUNK_BYTES];
+    size_t used = 0;
+    char path[24];
+
+    for (uint8_t i = 0; i < batch.count; i++)
+    {
+        const TelemetryWindow &w = batch.windows[i];
+        LoggedWindow window;
+        memset(&window, 0, sizeof(window));
+        window.timestamp = baseTimestamp + w.offsetMs / 1000;
+        window.windowMs = batch.windowMs;
+        window.samples = w.samples;
+        window.quality = w.quality;
+        window.flags = flags;
+        window.pulseRate[0] = toFixed(w.bpm.mean, PULSE_RATE_SCALE);
+        window.pulseRate[1] = toFixed(w.bpm.min, PULSE_RATE_SCALE);
+        window.pulseRate[2] = toFixed(w.bpm.max, PULSE_RATE_SCALE);
+        window.temperature[0] = toFixed(w.temperature.mean, TEMPERATURE_SCALE);
+        window.temperature[1] = toFixed(w.temperature.min, TEMPERATURE_SCALE);
+        window.temperature[2] = toFixed(w.temperature.max, TEMPERATURE_SCALE);
+        window.spO2[0] = toFixed(w.spO2.mean, SPO2_SCALE);
+        window.spO2[1] = toFixed(w.spO2.min, SPO2_SCALE);
+        window.spO2[2] = toFixed(w.spO2.max, SPO2_SCALE);
+
+        bool segmentFull = headSize + used + RECORD_BYTES > TELEMETRY_LOG_SEGMENT_BYTES;
+        if (segmentFull || used + RECORD_BYTES > sizeof(chunk))
+        {
+            segmentPath(path, sizeof(path), headSequence);
+            if (used && !files.append(path, chunk, used))
+                return false;
+            headSize += used;
+            used = 0;
+            if (segmentFull && !startSegment(headSequence + 1))
+                return false;
+        }
+
+        RecordHeader header = {sizeof(LoggedWindow), RECORD_WINDOW, RECORD_MARKER, 0};
+        header.crc = recordCrc(header, &window);
+        memcpy(chunk + used, &header, sizeof(header));
+        memcpy(chunk + used + sizeof(header), &window, sizeof(window));
+        used += RECORD_BYTES;
+        appended++;
+    }
+
+    segmentPath(path, sizeof(path), headSequence);
+    if (used && !files.append(path, chunk, used))
+        return false;
+    headSize += used;
+    return true;
+}
+
+uint8_t TelemetryLog::readBatch(TelemetryBatch &batch, uint32_t &baseTimestamp, uint8_t &flags, uint32_t &tag)
+{
+    batch.clear();
+    if (!ready || pendingCount >= TELEMETRY_LOG_MAX_PENDING)
+        return 0;
+
+    Position pos = readPos;
+    uint8_t chunk[CHUNK_BYTES];
+    bool stop = false;
+
+    while (!stop && batch.count < TelemetryBatch::CAPACITY && pos.sequence <= headSequence)
+    {
+        char path[24];
+        segmentPath(path, sizeof(path), pos.sequence);
+        long size = pos.sequence == headSequence ? (long)headSize : files.size(path);
+        if (size < 0 || pos.offset >= (uint32_t)size)
+        {
+            if (pos.sequence == headSequence)
+                break;
+            pos = {pos.sequence + 1, DATA_START};
+            continue;
+        }
+
+        size_t want = (uint32_t)size - pos.offset;
+        int got = files.read(path, pos.offset, chunk, want < sizeof(chunk) ? want : sizeof(chunk));
+
+        size_t used = 0;
+        ParseResult result = PARSE_BAD;
+        while (got > 0 && batch.count < TelemetryBatch::CAPACITY)
+        {
+            LoggedWindow window;
+            size_t consumed;
+            result = parseRecord(chunk + used, (size_t)got - used, window, consumed);
+            if (result != PARSE_OK)
+                break;
+
+            // Only windows that share a clock and window length go in one message
+            if (batch.count == 0)
+            {
+                baseTimestamp = window.timestamp;
+                flags = window.flags;
+                batch.windowMs = window.windowMs;
+                batch.baseMs = 0;
+            }
+            else if (window.flags != flags || window.windowMs != batch.windowMs ||
+                     window.timestamp < baseTimestamp || window.timestamp - baseTimestamp > MAX_BATCH_SPAN_S)
+            {
+                stop = true;
+                break;
+            }
+
+            TelemetryWindow &w = batch.windows[batch.count++];
+            w.offsetMs = (window.timestamp - baseTimestamp) * 1000;
+            w.samples = window.samples;
+            w.quality = window.quality;
+            toSummary(w.bpm, window.pulseRate, PULSE_RATE_SCALE, window.samples);
+            toSummary(w.temperature, window.temperature, TEMPERATURE_SCALE, window.samples);
+            toSummary(w.spO2, window.spO2, SPO2_SCALE, window.samples);
+            used += consumed;
+        }
+        pos.offset += used;
+
+        // Unreadable data: nothing after it in this segment can be trusted
+        if (got <= 0 || result == PARSE_BAD || (result == PARSE_NEED_MORE && used == 0))
+        {
+            if (pos.sequence == headSequence)
+                break;
+            pos = {pos.sequence + 1, DATA_START};
+        }
+    }
+
+    readPos = pos;
+    if (batch.count == 0)
+        return 0;
+
+    tag = nextTag++;
+    pending[pendingCount++] = {tag, pos, false};
+    return batch.count;
+}
+
+void TelemetryLog::acknowledge(uint32_t tag)
+{
+    for (uint8_t i = 0; i < pendingCount; i++)
+    {
+        if (pending[i].tag == tag)
+            pending[i].acked = true;
+    }
+
+    // Acks can arrive out of order; the cursor only moves over a contiguous run
+    uint8_t done = 0;
+    while (done < pendingCount && pending[done].acked)
+    {
+        cursor = pending[done].end;
+        done++;
+    }
+    if (done == 0)
+        return;
+
+    memmove(pending, pending + done, (pendingCount - done) * sizeof(Pending));
+    pendingCount -= done;
+    acknowledged += done;
+    saveCursor();
+}
+
+void TelemetryLog::rewind()
+{
+    pendingCount = 0;
+    readPos = cursor;
+}
+
+bool TelemetryLog::hasUnread() const
+{
+    Position head = {headSequence, headSize};
+    return ready && before(readPos, head);
+}
+
+uint32_t TelemetryLog::backlogBytes() const
+{
+    if (!ready)
+        return 0;
+    if (cursor.sequence == headSequence)
+        return headSize - cursor.offset;
+
+    // Full segments are counted at their maximum size
+    uint32_t bytes = TELEMETRY_LOG_SEGMENT_BYTES - cursor.offset;
+    bytes += (headSequence - cursor.sequence - 1) * TELEMETRY_LOG_SEGMENT_BYTES;
+    return bytes + headSize;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../hal/hal.h"
+#include "telemetry_batch.h"
+
+// Ring of TELEMETRY_LOG_SEGMENTS files of up to TELEMETRY_LOG_SEGMENT_BYTES
+// each. When all are full the oldest segment is deleted, unsent or not.
+#ifndef TELEMETRY_LOG_SEGMENTS
+#define TELEMETRY_LOG_SEGMENTS 8
+#endif
+
+#ifndef TELEMETRY_LOG_SEGMENT_BYTES
+#define TELEMETRY_LOG_SEGMENT_BYTES 4096
+#endif
+
+// Drained messages that may await an ack at once
+#ifndef TELEMETRY_LOG_MAX_PENDING
+#define TELEMETRY_LOG_MAX_PENDING 8
+#endif
+
+// One window summary on flash. Vitals use the wire fixed-point scales
+// (telemetry_schema.h), so a drained window encodes exactly as it would
+// have when live.
+struct LoggedWindow
+{
+    uint32_t timestamp; // Window start, epoch s (or s since boot with TELEMETRY_FLAG_MONOTONIC_TIME)
+    uint32_t windowMs;
+    uint16_t samples;
+    uint8_t quality;
+    uint8_t flags; // TelemetryFlags
+    int16_t pulseRate[3]; // mean, min, max
+    int16_t temperature[3];
+    int16_t spO2[3];
+    uint16_t reserved;
+};
+
+// Append-only store-and-forward log of window summaries on the FileStore.
+// Records are written once and never rewritten in place; writes walk
+// round the segment files, so flash wear is spread over the whole ring.
+// The read cursor is persisted only when the broker acknowledges what was
+// read, so a reboot or dropped link re-sends rather than loses data.
+class TelemetryLog
+{
+public:
+    struct Position
+    {
+        uint32_t sequence; // Segment
+        uint32_t offset;   // Byte offset in the segment file
+    };
+
+private:
+    struct Pending
+    {
+        uint32_t tag;
+        Position end;
+        bool acked;
+    };
+
+    FileStore &files;
+    bool ready = false;
+
+    uint32_t oldestSequence = 0;
+    uint32_t headSequence = 0;
+    uint32_t headSize = 0;
+
+    Position cursor = {0, 0};  // Acknowledged up to here (persisted)
+    Position readPos = {0, 0}; // Next record to hand out
+
+    Pending pending[TELEMETRY_LOG_MAX_PENDING];
+    uint8_t pendingCount = 0;
+    uint32_t nextTag = 1;
+
+    static void segmentPath(char *out, size_t size, uint32_t sequence);
+    bool startSegment(uint32_t sequence);
+    void dropOldest();
+    bool validTail(uint32_t sequence, uint32_t &end);
+    void loadCursor();
+    bool saveCursor();
+    static bool before(const Position &a, const Position &b);
+
+public:
+    // Counters since boot
+    uint32_t appended = 0;
+    uint32_t droppedSegments = 0;
+    uint32_t acknowledged = 0;
+
+    explicit TelemetryLog(FileStore &store);
+
+    // Mounts the file system and finds the head segment and cursor
+    bool begin();
+
+    bool append(const LoggedWindow &window);
+    // Every window of the batch, timestamped from baseTimestamp
+    bool appendBatch(const TelemetryBatch &batch, uint32_t baseTimestamp, uint8_t flags);
+
+    // Next run of unread windows (same clock source and window length, at
+    // most one batch) rebuilt as a TelemetryBatch. Returns the window
+    // count, 0 when nothing is unread or too many reads await an ack.
+    uint8_t readBatch(TelemetryBatch &batch, uint32_t &baseTimestamp, uint8_t &flags, uint32_t &tag);
+
+    // The message read under tag was delivered. The cursor moves over
+    // every acknowledged read in order and is saved.
+    void acknowledge(uint32_t tag);
+
+    // Forget outstanding reads; they are read again from the cursor
+    void rewind();
+
+    bool hasUnread() const;
+    uint32_t oldestSegment() const { return oldestSequence; }
+    uint32_t headSegment() const { return headSequence; }
+
+    // Bytes between the cursor and the head, segment headers included
+    uint32_t backlogBytes() const;
+};
+
+extern TelemetryLog telemetryLog;
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "telemetry_batch.h"
+
+// What the job needs from the uplink. RemoteDataSource implements it on the
+// board; the native build plugs in a recorder.
+class TelemetrySink
+{
+public:
+    virtual ~TelemetrySink() {}
+
+    // Non-blocking: advances the network join, true once it is usable
+    virtual bool networkReady() = 0;
+    virtual bool connected() = 0;
+    virtual bool connect(int maxRetries = 3) = 0;
+
+    virtual bool sendData(float pulseRate, float temperature, float spO2) = 0;
+    // One message carrying every window of the batch
+    virtual bool sendBatch(const TelemetryBatch &batch) = 0;
+
+    // Nothing queued, logged or awaiting an ack
+    virtual bool allDelivered() = 0;
+};
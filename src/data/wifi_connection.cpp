@@ -0,0 +1,119 @@
+#include "wifi_connection.h"
+#include "../state/wake/wake_probe.h"
+#include "../utils/stage_profiler.h"
+
+WifiConnection wifiConnection(systemWifi(), systemClock(), wakeState);
+
+static const char *const STATE_NAMES[] = {"idle", "directed", "scanning", "connected", "failed"};
+
+WifiConnection::WifiConnection(WifiLink &link, Clock &clock, WakeState &cache) : link(link), clock(clock), cache(cache)
+{
+}
+
+void WifiConnection::start(const WifiSettings &wifi)
+{
+    settings = wifi;
+    startedMs = clock.millis();
+    stageProfiler.start(STAGE_WIFI_JOIN);
+    directedMs = scanMs = 0;
+
+    if (!cache.hasNetwork())
+    {
+        startScan();
+        return;
+    }
+
+    // A configured static IP wins over the lease remembered from last wake
+    WifiLease lease = settings.staticIp;
+    if (lease.empty())
+        lease = {cache.ip(), cache.gateway(), cache.subnet(), cache.dns()};
+    usedStaticIp = !lease.empty();
+
+    link.setStaticIp(lease);
+    link.begin(settings.ssid, settings.password, cache.channel(), cache.bssid());
+    enter(State::DIRECTED);
+}
+
+void WifiConnection::startScan()
+{
+    // Only a configured address survives into the fallback; a cached lease
+    // may be what broke the directed join
+    usedStaticIp = !settings.staticIp.empty();
+    link.setStaticIp(settings.staticIp);
+    link.begin(settings.ssid, settings.password);
+    enter(State::SCANNING);
+}
+
+void WifiConnection::enter(State next)
+{
+    uint32_t now = clock.millis();
+    if (current == State::DIRECTED)
+        directedMs = now - phaseStartedMs;
+    else if (current == State::SCANNING)
+        scanMs = now - phaseStartedMs;
+
+    current = next;
+    phaseStartedMs = now;
+}
+
+WifiConnection::State WifiConnection::tick()
+{
+    if (current != State::DIRECTED && current != State::SCANNING)
+        return current;
+
+    WifiLinkStatus status = link.status();
+    uint32_t elapsed = clock.millis() - phaseStartedMs;
+
+    if (status == WifiLinkStatus::CONNECTED)
+    {
+        enter(State::CONNECTED);
+        onConnected();
+    }
+    else if (current == State::DIRECTED && (status == WifiLinkStatus::FAILED || elapsed >= WIFI_DIRECTED_TIMEOUT_MS))
+    {
+        HAL_LOG("[WIFI] Directed join failed after %lu ms, scanning\n", (unsigned long)elapsed);
+        cache.forgetNetwork();
+        link.disconnect();
+        startScan();
+    }
+    else if (current == State::SCANNING && (status == WifiLinkStatus::FAILED || elapsed >= WIFI_SCAN_TIMEOUT_MS))
+    {
+        enter(State::FAILED);
+        link.disconnect();
+        HAL_LOG("[WIFI] Connection failed\n");
+        printTimings();
+    }
+
+    return current;
+}
+
+void WifiConnection::onConnected()
+{
+    uint8_t bssid[6];
+    uint8_t channel = 0;
+    WifiLease lease = {0, 0, 0, 0};
+    link.associationInfo(bssid, channel, lease);
+    cache.recordNetwork(bssid, channel, lease.ip, lease.gateway, lease.subnet, lease.dns);
+
+    wakeProbe.mark(WAKE_WIFI);
+    stageProfiler.stop(STAGE_WIFI_JOIN);
+    printTimings();
+}
+
+bool WifiConnection::waitUntilConnected(uint32_t timeoutMs)
+{
+    uint32_t started = clock.millis();
+    while (tick() != State::CONNECTED && current != State::FAILED && current != State::IDLE &&
+           clock.millis() - started < timeoutMs)
+    {
+        clock.delay(10);
+    }
+    return connected();
+}
+
+void WifiConnection::printTimings() const
+{
+    HAL_LOG("[WIFI] %s: directed %lu ms, scan %lu ms, total %lu ms%s\n", STATE_NAMES[(uint8_t)current],
+            (unsigned long)directedMs, (unsigned long)scanMs, (unsigned long)(phaseStartedMs - startedMs),
+            usedStaticIp ? " (static IP)" : " (DHCP)");
+}
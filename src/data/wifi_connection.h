@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../hal/hal.h"
+#include "../state/wake/wake_state.h"
+
+#ifndef WIFI_DIRECTED_TIMEOUT_MS
+#define WIFI_DIRECTED_TIMEOUT_MS 3000
+#endif
+
+#ifndef WIFI_SCAN_TIMEOUT_MS
+#define WIFI_SCAN_TIMEOUT_MS 10000
+#endif
+
+struct WifiSettings
+{
+    const char *ssid;
+    const char *password;
+    WifiLease staticIp; // Empty: reuse the cached lease, else DHCP
+};
+
+// Brings the station link up without blocking: start() kicks off a
+// directed join to the channel/BSSID cached in WakeState (with a static IP
+// if one is configured or cached) and tick() advances it, falling back to
+// a full scan with DHCP if the directed join does not come up in time.
+class WifiConnection
+{
+public:
+    enum class State : uint8_t
+    {
+        IDLE,
+        DIRECTED, // Joining the cached AP
+        SCANNING, // Full scan + DHCP
+        CONNECTED,
+        FAILED
+    };
+
+private:
+    WifiLink &link;
+    Clock &clock;
+    WakeState &cache;
+    WifiSettings settings = {nullptr, nullptr, {0, 0, 0, 0}};
+
+    State current = State::IDLE;
+    uint32_t startedMs = 0;
+    uint32_t phaseStartedMs = 0;
+    uint32_t directedMs = 0;
+    uint32_t scanMs = 0;
+    bool usedStaticIp = false;
+
+    void startScan();
+    void enter(State next);
+    void onConnected();
+
+public:
+    WifiConnection(WifiLink &link, Clock &clock, WakeState &cache);
+
+    void start(const WifiSettings &wifi);
+    // Call from loop(); returns the state after any transition
+    State tick();
+    // Ticks (with clock.delay) until connected or failed, up to timeoutMs
+    bool waitUntilConnected(uint32_t timeoutMs);
+
+    State state() const { return current; }
+    bool connected() const { return current == State::CONNECTED; }
+    bool directedJoin() const { return directedMs != 0 && scanMs == 0 && connected(); }
+
+    // Per-phase durations of the last start(), in ms
+    uint32_t directedDuration() const { return directedMs; }
+    uint32_t scanDuration() const { return scanMs; }
+    void printTimings() const;
+};
+
+extern WifiConnection wifiConnection;
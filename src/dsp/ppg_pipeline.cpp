@@ -0,0 +1,150 @@
+#include "ppg_pipeline.h"
+#include "spo2_estimator.h"
+
+#include <math.h>
+
+void BiquadQ14::designBandPass(float sampleRateHz, float lowHz, float highHz)
+{
+    float centerHz = sqrtf(lowHz * highHz);
+    float q = centerHz / (highHz - lowHz);
+    float w0 = 2.0f * (float)M_PI * centerHz / sampleRateHz;
+    float alpha = sinf(w0) / (2.0f * q);
+    float a0 = 1.0f + alpha;
+
+    b0 = (int16_t)lroundf(alpha / a0 * 16384.0f);
+    b1 = 0;
+    b2 = (int16_t)-b0;
+    a1 = (int16_t)lroundf(-2.0f * cosf(w0) / a0 * 16384.0f);
+    a2 = (int16_t)lroundf((1.0f - alpha) / a0 * 16384.0f);
+    reset();
+}
+
+bool IbiSmoother::process(uint32_t intervalMs)
+{
+    if (intervalMs < minMs || intervalMs > maxMs)
+        return false;
+
+    if (averageMs == 0)
+    {
+        averageMs = (uint16_t)intervalMs;
+        return true;
+    }
+
+    // Outside +/-30% of the running average: probably a missed or extra beat.
+    // Three in a row means the rhythm really changed, so re-lock.
+    uint32_t tolerance = (averageMs * 77u) >> 8;
+    uint32_t diff = intervalMs > averageMs ? intervalMs - averageMs : averageMs - intervalMs;
+    if (diff > tolerance)
+    {
+        if (++rejects < 3)
+            return false;
+        averageMs = (uint16_t)intervalMs;
+        rejects = 0;
+        return true;
+    }
+
+    rejects = 0;
+    averageMs = (uint16_t)(averageMs + (((int32_t)intervalMs - (int32_t)averageMs) >> 2));
+    return true;
+}
+
+// log2 of the sample count closest to the given duration
+static uint8_t log2Samples(uint16_t sampleRateHz, uint16_t durationMs)
+{
+    uint32_t samples = (uint32_t)sampleRateHz * durationMs / 1000;
+    uint8_t shift = 0;
+    while (shift < 15 && (1UL << (shift + 1)) <= samples)
+    {
+        shift++;
+    }
+    return shift;
+}
+
+void PpgPipeline::begin(const PpgPipelineConfig &cfg)
+{
+    config = cfg;
+
+    // ~0.25 Hz DC tracker, ~1.3 s envelope decay
+    dcRemover.setTimeConstant(log2Samples(config.sampleRateHz, 640));
+    bandPass.designBandPass(config.sampleRateHz, config.minBpm / 60.0f, config.maxBpm / 60.0f);
+
+    // Refractory period of 80% of the shortest expected interval
+    uint16_t minIntervalMs = (uint16_t)(60000U / config.maxBpm);
+    uint16_t maxIntervalMs = (uint16_t)(60000U / config.minBpm);
+    peaks.configure((uint16_t)((uint32_t)minIntervalMs * 4 / 5 * config.sampleRateHz / 1000),
+                    log2Samples(config.sampleRateHz, 1300));
+    ibi.configure(minIntervalMs, maxIntervalMs);
+
+    beats = 0;
+    reset();
+}
+
+void PpgPipeline::attach(Spo2Estimator *estimator)
+{
+    spo2 = estimator;
+    if (spo2 != nullptr)
+    {
+        spo2->reset();
+        spo2->configure((uint16_t)((60000UL / config.maxBpm) * config.sampleRateHz / 2000));
+    }
+}
+
+void PpgPipeline::reset()
+{
+    dcRemover.reset();
+    bandPass.reset();
+    peaks.reset();
+    ibi.reset();
+    fingerPresent = false;
+}
+
+uint8_t PpgPipeline::processBlock(const PpgSample *samples, size_t count)
+{
+    uint8_t detected = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t ir = samples[i].ir;
+        if (ir < config.fingerThreshold)
+        {
+            // Tissue removed: drop filter history so it does not ring
+            if (fingerPresent)
+            {
+                reset();
+                if (spo2 != nullptr)
+                    spo2->markNoFinger();
+            }
+            continue;
+        }
+        fingerPresent = true;
+
+        if (spo2 != nullptr)
+            spo2->addSample(samples[i].red, ir);
+
+        int32_t ac = dcRemover.process(ir);
+        int32_t filtered = bandPass.process(config.invert ? -ac : ac);
+        uint32_t intervalSamples = peaks.process(filtered);
+
+        if (intervalSamples != 0)
+        {
+            uint32_t intervalMs = intervalSamples * 1000UL / config.sampleRateHz;
+            bool accepted = ibi.process(intervalMs);
+            if (accepted)
+            {
+                beats++;
+                detected++;
+            }
+
+            // Each peak ends an SpO2 window; keep it only if the beat was real
+            if (spo2 != nullptr)
+            {
+                if (accepted)
+                    spo2->closeWindow();
+                else
+                    spo2->abandonWindow();
+            }
+        }
+    }
+
+    return detected;
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../utils/max30105_fifo.h"
+
+// Fixed-point PPG heart-rate chain for a CPU without an FPU:
+//   DC removal (leaky integrator) -> biquad band-pass (Q2.14)
+//   -> adaptive-threshold peak detector -> inter-beat-interval smoothing.
+// All per-sample work is integer add/shift plus five 16x16 multiplies.
+
+class Spo2Estimator;
+
+// Tracks the DC level with an exponential average and returns the AC part
+class DcRemover
+{
+private:
+    int32_t dcQ8 = 0; // DC estimate with 8 fractional bits
+    uint8_t shift = 6;
+    bool primed = false;
+
+public:
+    static const int32_t AC_LIMIT = 16383; // Keeps the biquad accumulator in 32 bits
+
+    void setTimeConstant(uint8_t log2Samples) { shift = log2Samples; }
+    void reset() { primed = false; }
+
+    int32_t process(uint32_t sample)
+    {
+        int32_t xq = (int32_t)(sample << 8);
+        if (!primed)
+        {
+            dcQ8 = xq;
+            primed = true;
+        }
+        dcQ8 += (xq - dcQ8) >> shift;
+
+        int32_t ac = (int32_t)sample - (dcQ8 >> 8);
+        if (ac > AC_LIMIT)
+            ac = AC_LIMIT;
+        if (ac < -AC_LIMIT)
+            ac = -AC_LIMIT;
+        return ac;
+    }
+
+    uint32_t dc() const { return (uint32_t)(dcQ8 >> 8); }
+};
+
+// Direct form I biquad with Q2.14 coefficients and first-order error
+// feedback, which keeps low cut-off poles near the unit circle accurate.
+class BiquadQ14
+{
+private:
+    int16_t b0 = 0, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    int32_t error = 0;
+
+public:
+    // Band-pass with 0 dB peak gain between lowHz and highHz (RBJ cookbook).
+    // Uses floating point once at configuration time only.
+    void designBandPass(float sampleRateHz, float lowHz, float highHz);
+    void reset() { x1 = x2 = y1 = y2 = error = 0; }
+
+    int32_t process(int32_t x)
+    {
+        int32_t acc = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2 + error;
+        int32_t y = acc >> 14;
+        error = acc - (y << 14);
+
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        return y;
+    }
+};
+
+// Finds systolic peaks above a threshold that follows the signal envelope
+class PeakDetector
+{
+private:
+    int32_t envelope = 0;
+    int32_t prev = 0;
+    int32_t prevPrev = 0;
+    uint32_t sinceBeat = 0;
+    uint16_t refractory = 40;
+    uint8_t decayShift = 7;
+
+public:
+    static const int32_t THRESHOLD_Q15 = 13107; // 0.4 of the envelope
+
+    void configure(uint16_t refractorySamples, uint8_t envelopeDecayShift)
+    {
+        refractory = refractorySamples;
+        decayShift = envelopeDecayShift;
+    }
+
+    void reset()
+    {
+        envelope = prev = prevPrev = 0;
+        sinceBeat = 0;
+    }
+
+    // Returns the interval in samples since the previous peak when the
+    // previous sample was a peak, 0 otherwise
+    uint32_t process(int32_t y)
+    {
+        int32_t magnitude = y < 0 ? -y : y;
+        if (magnitude > envelope)
+            envelope = magnitude;
+        else
+            envelope -= envelope >> decayShift;
+
+        int32_t threshold = (envelope * THRESHOLD_Q15) >> 15;
+        uint32_t interval = 0;
+        sinceBeat++;
+
+        if (prev > prevPrev && prev >= y && prev > threshold && sinceBeat > refractory)
+        {
+            // The peak was one sample ago
+            interval = sinceBeat - 1;
+            sinceBeat = 1;
+        }
+
+        prevPrev = prev;
+        prev = y;
+        return interval;
+    }
+};
+
+// Rejects implausible intervals and averages the rest
+class IbiSmoother
+{
+private:
+    uint16_t averageMs = 0;
+    uint16_t minMs = 500;
+    uint16_t maxMs = 1500;
+    uint8_t rejects = 0;
+
+public:
+    void configure(uint16_t minIntervalMs, uint16_t maxIntervalMs)
+    {
+        minMs = minIntervalMs;
+        maxMs = maxIntervalMs;
+    }
+
+    void reset()
+    {
+        averageMs = 0;
+        rejects = 0;
+    }
+
+    // Returns true when the interval was accepted
+    bool process(uint32_t intervalMs);
+
+    uint16_t intervalMs() const { return averageMs; }
+
+    // Beats per minute with one decimal, 0 until locked
+    uint16_t bpmX10() const { return averageMs ? (uint16_t)(600000UL / averageMs) : 0; }
+};
+
+struct PpgPipelineConfig
+{
+    uint16_t sampleRateHz = 100;
+    uint8_t minBpm = 40;             // Cattle resting heart rate range
+    uint8_t maxBpm = 120;
+    uint32_t fingerThreshold = 20000; // IR counts with tissue on the sensor
+    bool invert = true;              // Blood volume pulses show up as IR dips
+};
+
+class PpgPipeline
+{
+private:
+    PpgPipelineConfig config;
+    DcRemover dcRemover;
+    BiquadQ14 bandPass;
+    PeakDetector peaks;
+    IbiSmoother ibi;
+    Spo2Estimator *spo2 = nullptr;
+
+    bool fingerPresent = false;
+    uint32_t beats = 0;
+
+public:
+    void begin(const PpgPipelineConfig &cfg = PpgPipelineConfig());
+    void reset();
+
+    // Optional SpO2 estimator fed with the same samples and beat windows
+    void attach(Spo2Estimator *estimator);
+
+    // Runs a whole FIFO block through the chain. Returns beats detected.
+    uint8_t processBlock(const PpgSample *samples, size_t count);
+
+    bool hasFinger() const { return fingerPresent; }
+    uint16_t bpmX10() const { return fingerPresent ? ibi.bpmX10() : 0; }
+    float bpm() const { return bpmX10() / 10.0f; }
+    uint32_t beatCount() const { return beats; }
+    uint32_t irDc() const { return dcRemover.dc(); }
+};
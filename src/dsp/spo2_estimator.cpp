@@ -0,0 +1,102 @@
+#include "spo2_estimator.h"
+
+void Spo2Estimator::reset()
+{
+    red.reset();
+    ir.reset();
+    windowSamples = 0;
+    clipped = false;
+    averageX10 = 0;
+    lastX10 = 0;
+    lastFlags = SPO2_NO_FINGER;
+}
+
+void Spo2Estimator::addSample(uint32_t redSample, uint32_t irSample)
+{
+    if (windowSamples >= MAX_WINDOW)
+    {
+        // No beat for too long: throw the window away and start over
+        red.restart();
+        ir.restart();
+        windowSamples = 0;
+        clipped = false;
+        badWindows++;
+        lastFlags = SPO2_BAD_WINDOW;
+    }
+
+    red.add(redSample);
+    ir.add(irSample);
+    if (redSample >= CLIP_LEVEL || irSample >= CLIP_LEVEL)
+        clipped = true;
+    windowSamples++;
+}
+
+void Spo2Estimator::abandonWindow()
+{
+    red.restart();
+    ir.restart();
+    windowSamples = 0;
+    clipped = false;
+    badWindows++;
+    lastFlags = SPO2_BAD_WINDOW;
+}
+
+void Spo2Estimator::markNoFinger()
+{
+    red.reset();
+    ir.reset();
+    windowSamples = 0;
+    clipped = false;
+    lastFlags = SPO2_NO_FINGER;
+}
+
+uint8_t Spo2Estimator::closeWindow()
+{
+    uint8_t flags = SPO2_OK;
+    if (windowSamples < minWindow)
+        flags |= SPO2_BAD_WINDOW;
+    if (clipped)
+        flags |= SPO2_CLIPPED;
+
+    uint32_t dcRed = windowSamples ? red.sum / windowSamples : 0;
+    uint32_t dcIr = windowSamples ? ir.sum / windowSamples : 0;
+    uint32_t acRed = red.acMax > red.acMin ? (uint32_t)(red.acMax - red.acMin) : 0;
+    uint32_t acIr = ir.acMax > ir.acMin ? (uint32_t)(ir.acMax - ir.acMin) : 0;
+
+    // Perfusion index below 0.1% is mostly noise
+    if (dcIr == 0 || acIr * 1000 < dcIr)
+        flags |= SPO2_LOW_PERFUSION;
+
+    if (flags == SPO2_OK && dcRed != 0)
+    {
+        // R = (ACred / DCred) / (ACir / DCir) in Q10; one 64-bit divide per beat
+        uint64_t numerator = (uint64_t)acRed * dcIr << 10;
+        uint64_t denominator = (uint64_t)acIr * dcRed;
+        uint32_t ratio = (uint32_t)(numerator / denominator);
+
+        // Linear calibration SpO2 = 110 - 25 R, valid for R in ~[0.4, 1.6]
+        int32_t x10 = 1100 - (int32_t)((250 * ratio) >> 10);
+        if (ratio < 410 || ratio > 1640 || x10 > 1000 || x10 < 700)
+        {
+            flags |= SPO2_OUT_OF_RANGE;
+        }
+        else
+        {
+            lastX10 = (uint16_t)x10;
+            ratioQ10 = (uint16_t)ratio;
+            averageX10 = averageX10 == 0 ? (uint16_t)x10 : (uint16_t)(averageX10 + ((x10 - (int32_t)averageX10) >> 2));
+        }
+    }
+
+    if (flags == SPO2_OK)
+        goodWindows++;
+    else
+        badWindows++;
+
+    red.restart();
+    ir.restart();
+    windowSamples = 0;
+    clipped = false;
+    lastFlags = flags;
+    return flags;
+}
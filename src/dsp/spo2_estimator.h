@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ppg_pipeline.h"
+
+// Quality flags of an SpO2 window (bitmask)
+enum Spo2Quality : uint8_t
+{
+    SPO2_OK = 0x00,
+    SPO2_NO_FINGER = 0x01,
+    SPO2_LOW_PERFUSION = 0x02, // AC/DC of IR too small to trust the ratio
+    SPO2_CLIPPED = 0x04,       // ADC saturated somewhere in the window
+    SPO2_BAD_WINDOW = 0x08,    // Window too short or too long for one beat
+    SPO2_OUT_OF_RANGE = 0x10   // Ratio outside the calibrated range
+};
+
+// Streaming ratio-of-ratios SpO2. The PPG pipeline closes a window on every
+// accepted beat; per window only sums and min/max are kept, so memory is a
+// few dozen bytes regardless of window length.
+class Spo2Estimator
+{
+private:
+    struct Channel
+    {
+        DcRemover dcRemover;
+        uint32_t sum;
+        int32_t acMin;
+        int32_t acMax;
+
+        void reset()
+        {
+            dcRemover.reset();
+            restart();
+        }
+
+        void restart()
+        {
+            sum = 0;
+            acMin = INT32_MAX;
+            acMax = INT32_MIN;
+        }
+
+        void add(uint32_t sample)
+        {
+            int32_t ac = dcRemover.process(sample);
+            sum += sample;
+            if (ac < acMin)
+                acMin = ac;
+            if (ac > acMax)
+                acMax = ac;
+        }
+    };
+
+    static const uint32_t CLIP_LEVEL = 0x3FF00;
+    static const uint16_t MAX_WINDOW = 255;
+
+    Channel red;
+    Channel ir;
+    uint16_t windowSamples = 0;
+    uint16_t minWindow = 20;
+    bool clipped = false;
+
+    uint16_t averageX10 = 0;
+    uint16_t lastX10 = 0;
+    uint16_t ratioQ10 = 0;
+    uint8_t lastFlags = SPO2_NO_FINGER;
+
+public:
+    uint32_t goodWindows = 0;
+    uint32_t badWindows = 0;
+
+    Spo2Estimator() { reset(); }
+
+    // Shortest plausible beat window in samples
+    void configure(uint16_t minWindowSamples) { minWindow = minWindowSamples; }
+    void reset();
+
+    void addSample(uint32_t redSample, uint32_t irSample);
+
+    // Ends the current beat window; returns its quality flags
+    uint8_t closeWindow();
+
+    // Drops the current window, e.g. when the beat that ended it was rejected
+    void abandonWindow();
+
+    // Called when the tissue leaves the sensor
+    void markNoFinger();
+
+    // Average over good windows in tenths of a percent, 0 until one is seen
+    uint16_t spo2X10() const { return averageX10; }
+    float spo2() const { return averageX10 / 10.0f; }
+
+    uint16_t lastWindowX10() const { return lastX10; }
+    uint16_t lastRatioQ10() const { return ratioQ10; }
+    uint8_t lastQuality() const { return lastFlags; }
+};
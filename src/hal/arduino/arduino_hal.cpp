@@ -0,0 +1,298 @@
+#include "arduino_hal.h"
+
+#include <coredecls.h> // settimeofday_cb
+#include <sys/time.h>
+#include <time.h>
+
+// Wire's internal buffer limits a single requestFrom()
+#ifdef BUFFER_LENGTH
+static const size_t I2C_CHUNK = BUFFER_LENGTH;
+#else
+static const size_t I2C_CHUNK = 32;
+#endif
+
+void ArduinoI2CBus::setClock(uint32_t hz)
+{
+    Wire.setClock(hz);
+}
+
+bool ArduinoI2CBus::writeRegister(uint8_t address, uint8_t reg, uint8_t value)
+{
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    Wire.write(value);
+    return Wire.endTransmission() == 0;
+}
+
+bool ArduinoI2CBus::readRegisters(uint8_t address, uint8_t reg, uint8_t *buffer, size_t length)
+{
+    Wire.beginTransmission(address);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0)
+        return false;
+
+    size_t done = 0;
+    while (done < length)
+    {
+        size_t chunk = length - done;
+        if (chunk > I2C_CHUNK)
+            chunk = I2C_CHUNK;
+
+        // Only the last chunk releases the bus
+        bool last = (done + chunk) == length;
+        if (Wire.requestFrom(address, chunk, last) != chunk)
+            return false;
+
+        for (size_t i = 0; i < chunk; i++)
+        {
+            buffer[done + i] = Wire.read();
+        }
+        done += chunk;
+    }
+    return true;
+}
+
+size_t ArduinoI2CBus::maxReadLength() const
+{
+    return I2C_CHUNK;
+}
+
+bool EepromStorage::begin()
+{
+    EEPROM.begin(bytes);
+    return true;
+}
+
+bool EepromStorage::read(size_t offset, void *data, size_t length)
+{
+    // Straight from the RAM copy EEPROM.begin() made
+    const uint8_t *area = EEPROM.getConstDataPtr();
+    if (area == nullptr || offset + length > bytes)
+        return false;
+
+    memcpy(data, area + offset, length);
+    return true;
+}
+
+bool EepromStorage::write(size_t offset, const void *data, size_t length)
+{
+    // getDataPtr() marks the area dirty for commit()
+    uint8_t *area = EEPROM.getDataPtr();
+    if (area == nullptr || offset + length > bytes)
+        return false;
+
+    memcpy(area + offset, data, length);
+    return true;
+}
+
+bool EepromStorage::commit()
+{
+    return EEPROM.commit();
+}
+
+void EepromStorage::end()
+{
+    EEPROM.end();
+}
+
+bool LittleFsStore::begin()
+{
+    if (mounted)
+        return true;
+    if (!LittleFS.begin())
+    {
+        // Blank or corrupted partition: start over rather than run without a log
+        Serial.println("[FS] Mount failed, formatting LittleFS");
+        mounted = LittleFS.format() && LittleFS.begin();
+    }
+    else
+    {
+        mounted = true;
+    }
+    return mounted;
+}
+
+bool LittleFsStore::append(const char *path, const void *data, size_t length)
+{
+    File file = LittleFS.open(path, "a");
+    if (!file)
+        return false;
+    size_t written = file.write((const uint8_t *)data, length);
+    file.close();
+    return written == length;
+}
+
+bool LittleFsStore::write(const char *path, const void *data, size_t length)
+{
+    File file = LittleFS.open(path, "w");
+    if (!file)
+        return false;
+    size_t written = file.write((const uint8_t *)data, length);
+    file.close();
+    return written == length;
+}
+
+int LittleFsStore::read(const char *path, size_t offset, void *data, size_t length)
+{
+    if (!LittleFS.exists(path))
+        return -1;
+    File file = LittleFS.open(path, "r");
+    if (!file)
+        return -1;
+    int got = file.seek(offset) ? (int)file.read((uint8_t *)data, length) : 0;
+    file.close();
+    return got;
+}
+
+long LittleFsStore::size(const char *path)
+{
+    if (!LittleFS.exists(path))
+        return -1;
+    File file = LittleFS.open(path, "r");
+    if (!file)
+        return -1;
+    long bytes = (long)file.size();
+    file.close();
+    return bytes;
+}
+
+bool LittleFsStore::remove(const char *path)
+{
+    return LittleFS.remove(path);
+}
+
+void ArduinoWifiLink::begin(const char *ssid, const char *password, uint8_t channel, const uint8_t *bssid)
+{
+    if (!gotIpHandler)
+    {
+        // Config is persisted by the firmware itself; don't rewrite flash on every wake
+        WiFi.persistent(false);
+        WiFi.mode(WIFI_STA);
+        gotIpHandler = WiFi.onStationModeGotIP([this](const WiFiEventStationModeGotIP &)
+                                               { linkStatus = WifiLinkStatus::CONNECTED; });
+        disconnectedHandler = WiFi.onStationModeDisconnected([this](const WiFiEventStationModeDisconnected &event)
+                                                             {
+            // Wrong password or missing AP end the attempt; others are retried by the SDK
+            if (event.reason == WIFI_DISCONNECT_REASON_AUTH_FAIL ||
+                event.reason == WIFI_DISCONNECT_REASON_NO_AP_FOUND)
+                linkStatus = WifiLinkStatus::FAILED;
+            else if (linkStatus == WifiLinkStatus::CONNECTED)
+                linkStatus = WifiLinkStatus::CONNECTING; });
+    }
+
+    linkStatus = WifiLinkStatus::CONNECTING;
+    WiFi.begin(ssid, password, channel, bssid);
+}
+
+void ArduinoWifiLink::setStaticIp(const WifiLease &lease)
+{
+    WiFi.config(IPAddress(lease.ip), IPAddress(lease.gateway), IPAddress(lease.subnet), IPAddress(lease.dns));
+}
+
+void ArduinoWifiLink::disconnect()
+{
+    WiFi.disconnect();
+    linkStatus = WifiLinkStatus::IDLE;
+}
+
+void ArduinoWifiLink::associationInfo(uint8_t bssid[6], uint8_t &channel, WifiLease &lease)
+{
+    memcpy(bssid, WiFi.BSSID(), 6);
+    channel = WiFi.channel();
+    lease.ip = (uint32_t)WiFi.localIP();
+    lease.gateway = (uint32_t)WiFi.gatewayIP();
+    lease.subnet = (uint32_t)WiFi.subnetMask();
+    lease.dns = (uint32_t)WiFi.dnsIP();
+}
+
+void ArduinoWallClock::startSync(const char *primaryServer, const char *secondaryServer)
+{
+    if (!callbackSet)
+    {
+        // Also fires for our own settimeofday(); only SNTP counts as a sync
+        settimeofday_cb([this](bool fromSntp)
+                        { if (fromSntp) sntpSynced = true; });
+        callbackSet = true;
+    }
+
+    sntpSynced = false;
+    configTime(0, 0, primaryServer, secondaryServer);
+}
+
+uint64_t ArduinoWallClock::nowMs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_sec < 1600000000) // Unset clock starts near 1970
+        return 0;
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+void ArduinoWallClock::set(uint32_t epoch)
+{
+    struct timeval tv = {(time_t)epoch, 0};
+    settimeofday(&tv, nullptr);
+}
+
+bool RtcStorage::read(size_t offset, void *data, size_t length)
+{
+    if (offset % 4 || length % 4 || offset + length > size())
+        return false;
+    return ESP.rtcUserMemoryRead(offset / 4, (uint32_t *)data, length);
+}
+
+bool RtcStorage::write(size_t offset, const void *data, size_t length)
+{
+    if (offset % 4 || length % 4 || offset + length > size())
+        return false;
+    return ESP.rtcUserMemoryWrite(offset / 4, (uint32_t *)data, length);
+}
+
+// Platform singletons
+Clock &systemClock()
+{
+    static ArduinoClock clock;
+    return clock;
+}
+
+I2CBus &systemI2C()
+{
+    static ArduinoI2CBus bus;
+    return bus;
+}
+
+Storage &configStorage()
+{
+    static EepromStorage storage(512);
+    return storage;
+}
+
+Storage &rtcStorage()
+{
+    static RtcStorage storage;
+    return storage;
+}
+
+FileStore &systemFiles()
+{
+    static LittleFsStore files;
+    return files;
+}
+
+WifiLink &systemWifi()
+{
+    static ArduinoWifiLink link;
+    return link;
+}
+
+WallClock &systemWallClock()
+{
+    static ArduinoWallClock wallClock;
+    return wallClock;
+}
+
+MemoryInfo &systemMemory()
+{
+    static ArduinoMemoryInfo memory;
+    return memory;
+}
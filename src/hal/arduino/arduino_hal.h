@@ -0,0 +1,134 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <ESP8266WiFi.h>
+#include <WiFiClientSecure.h>
+#include <EEPROM.h>
+#include <LittleFS.h>
+
+#include "../hal.h"
+
+class ArduinoClock : public Clock
+{
+public:
+    uint32_t millis() override { return ::millis(); }
+    uint32_t micros() override { return ::micros(); }
+    void delay(uint32_t ms) override { ::delay(ms); }
+    uint32_t cycles() override { return ESP.getCycleCount(); }
+    uint32_t cyclesPerMicro() override { return ESP.getCpuFreqMHz(); }
+    uint64_t deepSleepMaxUs() override { return ESP.deepSleepMax(); }
+};
+
+class ArduinoI2CBus : public I2CBus
+{
+public:
+    void setClock(uint32_t hz) override;
+    bool writeRegister(uint8_t address, uint8_t reg, uint8_t value) override;
+    bool readRegisters(uint8_t address, uint8_t reg, uint8_t *buffer, size_t length) override;
+    size_t maxReadLength() const override;
+};
+
+// TLS socket to the IoT Hub, used by MqttClient. The underlying
+// WiFiClientSecure is exposed for TLS setup and because HTTPClient wants a
+// real Arduino Client.
+class ArduinoNetworkClient : public NetworkClient
+{
+private:
+    WiFiClientSecure client;
+
+public:
+    WiFiClientSecure &secure() { return client; }
+
+    bool connect(const char *host, uint16_t port) override { return client.connect(host, port); }
+    bool connected() override { return client.connected(); }
+    size_t write(const uint8_t *data, size_t length) override { return client.write(data, length); }
+    int available() override { return client.available(); }
+    int read(uint8_t *buffer, size_t length) override { return client.read(buffer, length); }
+    void stop() override { client.stop(); }
+};
+
+class EepromStorage : public Storage
+{
+private:
+    size_t bytes;
+
+public:
+    explicit EepromStorage(size_t size) : bytes(size) {}
+
+    bool begin() override;
+    size_t size() const override { return bytes; }
+    bool read(size_t offset, void *data, size_t length) override;
+    bool write(size_t offset, const void *data, size_t length) override;
+    bool commit() override;
+    void end() override;
+};
+
+// ESP8266 RTC user memory (512 bytes), kept across deep sleep. Accesses are
+// in 4-byte blocks, so offsets and lengths must be multiples of 4.
+class RtcStorage : public Storage
+{
+public:
+    bool begin() override { return true; }
+    size_t size() const override { return 512; }
+    bool read(size_t offset, void *data, size_t length) override;
+    bool write(size_t offset, const void *data, size_t length) override;
+    bool commit() override { return true; }
+    void end() override {}
+};
+
+// LittleFS on the flash FS partition; formatted on first mount failure
+class LittleFsStore : public FileStore
+{
+private:
+    bool mounted = false;
+
+public:
+    bool begin() override;
+    bool append(const char *path, const void *data, size_t length) override;
+    bool write(const char *path, const void *data, size_t length) override;
+    int read(const char *path, size_t offset, void *data, size_t length) override;
+    long size(const char *path) override;
+    bool remove(const char *path) override;
+};
+
+// ESP8266WiFi behind WifiLink. Status is driven by the SDK's station
+// events rather than polling WiFi.status().
+class ArduinoWifiLink : public WifiLink
+{
+private:
+    WiFiEventHandler gotIpHandler;
+    WiFiEventHandler disconnectedHandler;
+    volatile WifiLinkStatus linkStatus = WifiLinkStatus::IDLE;
+
+public:
+    void begin(const char *ssid, const char *password, uint8_t channel = 0, const uint8_t *bssid = nullptr) override;
+    void setStaticIp(const WifiLease &lease) override;
+    WifiLinkStatus status() override { return linkStatus; }
+    void disconnect() override;
+    void associationInfo(uint8_t bssid[6], uint8_t &channel, WifiLease &lease) override;
+    int8_t rssi() override { return WiFi.RSSI(); }
+};
+
+class ArduinoMemoryInfo : public MemoryInfo
+{
+public:
+    MemorySnapshot snapshot() override
+    {
+        return {ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(), ESP.getHeapFragmentation(), ESP.getFreeContStack()};
+    }
+};
+
+// newlib time() set by the core's SNTP client
+class ArduinoWallClock : public WallClock
+{
+private:
+    volatile bool sntpSynced = false;
+    bool callbackSet = false;
+
+public:
+    void startSync(const char *primaryServer, const char *secondaryServer) override;
+    bool synced() override { return sntpSynced; }
+    uint64_t nowMs() override;
+    void set(uint32_t epoch) override;
+};
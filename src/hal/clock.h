@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// Monotonic time source. On the board this forwards to millis()/micros(),
+// on the native build it is a fake that can be advanced by hand.
+class Clock
+{
+public:
+    virtual ~Clock() {}
+
+    virtual uint32_t millis() = 0;
+    virtual uint32_t micros() = 0;
+    virtual void delay(uint32_t ms) = 0;
+
+    // Free-running CPU cycle counter for timing short stretches of code
+    // (CCOUNT on the board). Wraps every 2^32 cycles, under a minute.
+    virtual uint32_t cycles() = 0;
+    virtual uint32_t cyclesPerMicro() = 0;
+
+    // Longest deep sleep the RTC timer can time, us (about 3.5 h on the
+    // ESP8266, varying with the RTC calibration)
+    virtual uint64_t deepSleepMaxUs() = 0;
+};
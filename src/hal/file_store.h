@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Small flat file system (LittleFS on the board, a host directory on
+// native). Every call opens and closes the file, so callers should read
+// and write in chunks rather than byte by byte.
+class FileStore
+{
+public:
+    virtual ~FileStore() {}
+
+    virtual bool begin() = 0;
+    virtual bool append(const char *path, const void *data, size_t length) = 0;
+    // Replaces the whole file
+    virtual bool write(const char *path, const void *data, size_t length) = 0;
+    // Bytes read (short at end of file), or -1 if the file does not exist
+    virtual int read(const char *path, size_t offset, void *data, size_t length) = 0;
+    // File size, or -1 if it does not exist
+    virtual long size(const char *path) = 0;
+    virtual bool remove(const char *path) = 0;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "clock.h"
+#include "i2c_bus.h"
+#include "network_client.h"
+#include "storage.h"
+#include "file_store.h"
+#include "wifi_link.h"
+#include "wall_clock.h"
+#include "memory_info.h"
+#include "log.h"
+
+// Platform singletons. Implemented in hal/arduino/ for the board and in
+// hal/native/ for the host build; platformio.ini picks one per env.
+Clock &systemClock();
+I2CBus &systemI2C();
+Storage &configStorage();
+Storage &rtcStorage(); // Survives deep sleep, lost on power loss
+FileStore &systemFiles();
+WifiLink &systemWifi();
+WallClock &systemWallClock();
+MemoryInfo &systemMemory();
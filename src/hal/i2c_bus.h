@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Register-oriented I2C access, enough for the MAX30105 and MLX90614.
+class I2CBus
+{
+public:
+    virtual ~I2CBus() {}
+
+    virtual void setClock(uint32_t hz) = 0;
+    virtual bool writeRegister(uint8_t address, uint8_t reg, uint8_t value) = 0;
+
+    // Burst read starting at reg (repeated start, no stop in between)
+    virtual bool readRegisters(uint8_t address, uint8_t reg, uint8_t *buffer, size_t length) = 0;
+
+    // Longest read done as one transfer; longer ones are split wherever
+    // this falls, so callers reading records keep each read within it
+    virtual size_t maxReadLength() const = 0;
+
+    uint8_t readRegister(uint8_t address, uint8_t reg)
+    {
+        uint8_t value = 0;
+        readRegisters(address, reg, &value, 1);
+        return value;
+    }
+};
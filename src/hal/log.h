@@ -0,0 +1,10 @@
+#pragma once
+
+// printf-style logging that works on both the board and the native build
+#ifdef ARDUINO
+#include <Arduino.h>
+#define HAL_LOG(...) Serial.printf(__VA_ARGS__)
+#else
+#include <stdio.h>
+#define HAL_LOG(...) printf(__VA_ARGS__)
+#endif
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+struct MemorySnapshot
+{
+    uint32_t freeHeap;
+    uint32_t maxFreeBlock;  // Largest single allocation that would succeed
+    uint8_t fragmentation;  // Percent, 0 = one free block
+    uint32_t freeStack;     // Untouched bytes of the loop (cont) stack
+};
+
+// Heap and stack state. On the board this reads the umm_malloc heap and the
+// cont stack watermark; on the native build the values are set by hand.
+class MemoryInfo
+{
+public:
+    virtual ~MemoryInfo() {}
+
+    virtual MemorySnapshot snapshot() = 0;
+};
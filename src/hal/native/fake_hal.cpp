@@ -0,0 +1,371 @@
+#include "fake_hal.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+
+uint64_t FakeClock::micros64()
+{
+    if (!realTime)
+        return nowUs;
+
+    static const auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+uint32_t FakeClock::cycles()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t hostNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+
+    // In real-time mode micros64() is already the host clock
+    uint64_t simulatedUs = realTime ? 0 : nowUs;
+    return (uint32_t)(simulatedUs * FAKE_CPU_MHZ + hostNs * FAKE_CPU_MHZ / 1000ULL);
+}
+
+FakeI2CDevice *FakeI2CBus::find(uint8_t address)
+{
+    for (int i = 0; i < MAX_DEVICES; i++)
+    {
+        if (devices[i] != nullptr && devices[i]->address == address)
+            return devices[i];
+    }
+    return nullptr;
+}
+
+bool FakeI2CBus::attach(FakeI2CDevice &device)
+{
+    for (int i = 0; i < MAX_DEVICES; i++)
+    {
+        if (devices[i] == nullptr)
+        {
+            devices[i] = &device;
+            return true;
+        }
+    }
+    return false;
+}
+
+void FakeI2CBus::detachAll()
+{
+    memset(devices, 0, sizeof(devices));
+}
+
+bool FakeI2CBus::writeRegister(uint8_t address, uint8_t reg, uint8_t value)
+{
+    transactions++;
+    FakeI2CDevice *device = find(address);
+    return device != nullptr && device->writeRegister(reg, value);
+}
+
+bool FakeI2CBus::readRegisters(uint8_t address, uint8_t reg, uint8_t *buffer, size_t length)
+{
+    transactions++;
+    if (readLimit && length > readLimit)
+        return false;
+    if (length > longestRead)
+        longestRead = length;
+    FakeI2CDevice *device = find(address);
+    return device != nullptr && device->readRegisters(reg, buffer, length);
+}
+
+bool FakeNetworkClient::connect(const char *host, uint16_t port)
+{
+    (void)host;
+    (void)port;
+    isConnected = !refuseConnect;
+    return isConnected;
+}
+
+size_t FakeNetworkClient::write(const uint8_t *data, size_t length)
+{
+    if (!isConnected)
+        return 0;
+
+    size_t room = BUFFER_SIZE - txLength;
+    if (length > room)
+        length = room;
+    memcpy(txBuffer + txLength, data, length);
+    txLength += length;
+    return length;
+}
+
+int FakeNetworkClient::read(uint8_t *buffer, size_t length)
+{
+    size_t pending = rxLength - rxHead;
+    if (length > pending)
+        length = pending;
+    memcpy(buffer, rxBuffer + rxHead, length);
+    rxHead += length;
+    if (rxHead == rxLength)
+        rxHead = rxLength = 0;
+    return (int)length;
+}
+
+bool FakeNetworkClient::inject(const uint8_t *data, size_t length)
+{
+    if (rxLength + length > BUFFER_SIZE)
+        return false;
+    memcpy(rxBuffer + rxLength, data, length);
+    rxLength += length;
+    return true;
+}
+
+void FakeWifiLink::begin(const char *ssid, const char *password, uint8_t channel, const uint8_t *bssid)
+{
+    (void)ssid;
+    (void)password;
+    begins++;
+
+    // A directed join only works if the cached AP is still where it was
+    directed = channel != 0 && bssid != nullptr;
+    bool reachable = apPresent && (!directed || (channel == apChannel && memcmp(bssid, apBssid, 6) == 0));
+
+    // Like the SDK: a directed join to the wrong place just never completes,
+    // a scan that finds nothing reports failure once it has finished
+    linkStatus = WifiLinkStatus::CONNECTING;
+    willConnect = reachable;
+    uint32_t joinMs = directed ? directedJoinMs : scanJoinMs;
+    if (!reachable)
+        connectAtMs = directed ? UINT32_MAX : clock.millis() + scanJoinMs;
+    else
+        connectAtMs = clock.millis() + joinMs + (staticLease.empty() ? dhcpMs : 0);
+}
+
+WifiLinkStatus FakeWifiLink::status()
+{
+    if (linkStatus == WifiLinkStatus::CONNECTING && connectAtMs != UINT32_MAX &&
+        (int32_t)(clock.millis() - connectAtMs) >= 0)
+        linkStatus = willConnect ? WifiLinkStatus::CONNECTED : WifiLinkStatus::FAILED;
+    return linkStatus;
+}
+
+void FakeWifiLink::associationInfo(uint8_t bssid[6], uint8_t &channel, WifiLease &lease)
+{
+    memcpy(bssid, apBssid, 6);
+    channel = apChannel;
+    lease = staticLease.empty() ? WifiLease{0x0A01A8C0, 0x0101A8C0, 0x00FFFFFF, 0x0101A8C0} : staticLease;
+}
+
+void FakeWallClock::startSync(const char *primaryServer, const char *secondaryServer)
+{
+    (void)primaryServer;
+    (void)secondaryServer;
+    syncing = true;
+    sntpSynced = false;
+    syncAtMs = clock.millis() + syncDelayMs;
+}
+
+bool FakeWallClock::synced()
+{
+    if (syncing && ntpReachable && (int32_t)(clock.millis() - syncAtMs) >= 0)
+    {
+        syncing = false;
+        sntpSynced = true;
+        isSet = true;
+        offsetMs = (int64_t)trueEpochAtBoot * 1000;
+    }
+    return sntpSynced;
+}
+
+uint64_t FakeWallClock::nowMs()
+{
+    synced();
+    return isSet ? (uint64_t)(offsetMs + clock.millis()) : 0;
+}
+
+void FakeWallClock::set(uint32_t epoch)
+{
+    offsetMs = (int64_t)epoch * 1000 - clock.millis();
+    isSet = true;
+}
+
+void FakeWallClock::reboot()
+{
+    isSet = syncing = sntpSynced = false;
+    offsetMs = 0;
+}
+
+FakeStorage::FakeStorage(size_t size) : bytes((uint8_t *)malloc(size)), bytesSize(size)
+{
+    erase();
+}
+
+FakeStorage::~FakeStorage()
+{
+    free(bytes);
+}
+
+bool FakeStorage::read(size_t offset, void *data, size_t length)
+{
+    if (offset + length > bytesSize)
+        return false;
+    memcpy(data, bytes + offset, length);
+    return true;
+}
+
+bool FakeStorage::write(size_t offset, const void *data, size_t length)
+{
+    if (offset + length > bytesSize)
+        return false;
+    memcpy(bytes + offset, data, length);
+    return true;
+}
+
+void FakeStorage::erase()
+{
+    memset(bytes, 0xFF, bytesSize);
+}
+
+HostFileStore::HostFileStore(const char *directory)
+{
+    snprintf(root, sizeof(root), "%s", directory);
+}
+
+void HostFileStore::resolve(char *out, size_t size, const char *path) const
+{
+    snprintf(out, size, "%s/%s", root, path[0] == '/' ? path + 1 : path);
+}
+
+bool HostFileStore::begin()
+{
+    mkdir(root, 0755);
+    struct stat info;
+    return stat(root, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+bool HostFileStore::append(const char *path, const void *data, size_t length)
+{
+    char full[256];
+    resolve(full, sizeof(full), path);
+    FILE *file = fopen(full, "ab");
+    if (!file)
+        return false;
+    size_t written = fwrite(data, 1, length, file);
+    fclose(file);
+    appends++;
+    bytesWritten += written;
+    return written == length;
+}
+
+bool HostFileStore::write(const char *path, const void *data, size_t length)
+{
+    char full[256];
+    resolve(full, sizeof(full), path);
+    FILE *file = fopen(full, "wb");
+    if (!file)
+        return false;
+    size_t written = fwrite(data, 1, length, file);
+    fclose(file);
+    rewrites++;
+    bytesWritten += written;
+    return written == length;
+}
+
+int HostFileStore::read(const char *path, size_t offset, void *data, size_t length)
+{
+    char full[256];
+    resolve(full, sizeof(full), path);
+    FILE *file = fopen(full, "rb");
+    if (!file)
+        return -1;
+    int got = fseek(file, (long)offset, SEEK_SET) == 0 ? (int)fread(data, 1, length, file) : 0;
+    fclose(file);
+    return got;
+}
+
+long HostFileStore::size(const char *path)
+{
+    char full[256];
+    resolve(full, sizeof(full), path);
+    struct stat info;
+    return stat(full, &info) == 0 ? (long)info.st_size : -1;
+}
+
+bool HostFileStore::remove(const char *path)
+{
+    char full[256];
+    resolve(full, sizeof(full), path);
+    return unlink(full) == 0;
+}
+
+void HostFileStore::wipe()
+{
+    DIR *dir = opendir(root);
+    if (!dir)
+        return;
+    while (struct dirent *entry = readdir(dir))
+    {
+        if (entry->d_name[0] == '.')
+            continue;
+        char full[384];
+        snprintf(full, sizeof(full), "%s/%s", root, entry->d_name);
+        unlink(full);
+    }
+    closedir(dir);
+}
+
+// Platform singletons
+FakeClock &fakeClock()
+{
+    static FakeClock clock;
+    return clock;
+}
+
+FakeI2CBus &fakeI2C()
+{
+    static FakeI2CBus bus;
+    return bus;
+}
+
+FakeStorage &fakeConfigStorage()
+{
+    static FakeStorage storage(512);
+    return storage;
+}
+
+FakeStorage &fakeRtcStorage()
+{
+    static FakeStorage storage(512);
+    return storage;
+}
+
+// PETSA_FS_DIR picks the directory; it persists between runs like flash
+HostFileStore &fakeFiles()
+{
+    static HostFileStore files(getenv("PETSA_FS_DIR") ? getenv("PETSA_FS_DIR") : "/tmp/petsa_native_fs");
+    return files;
+}
+
+FakeWifiLink &fakeWifi()
+{
+    static FakeWifiLink link(fakeClock());
+    return link;
+}
+
+FakeWallClock &fakeWallClock()
+{
+    static FakeWallClock wallClock(fakeClock());
+    return wallClock;
+}
+
+FakeMemoryInfo &fakeMemory()
+{
+    static FakeMemoryInfo memory;
+    return memory;
+}
+
+Clock &systemClock() { return fakeClock(); }
+I2CBus &systemI2C() { return fakeI2C(); }
+Storage &configStorage() { return fakeConfigStorage(); }
+Storage &rtcStorage() { return fakeRtcStorage(); }
+FileStore &systemFiles() { return fakeFiles(); }
+WifiLink &systemWifi() { return fakeWifi(); }
+WallClock &systemWallClock() { return fakeWallClock(); }
+MemoryInfo &systemMemory() { return fakeMemory(); }
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../hal.h"
+
+// Nominal CPU clock behind FakeClock::cycles()
+#ifndef FAKE_CPU_MHZ
+#define FAKE_CPU_MHZ 80
+#endif
+
+// Default FakeClock::deepSleepMaxUs(), a typical ESP8266 value
+#ifndef FAKE_DEEP_SLEEP_MAX_US
+#define FAKE_DEEP_SLEEP_MAX_US 12000000000ULL
+#endif
+
+// Manually advanced clock. delay() just moves time forward so a whole wake
+// cycle runs instantly; setRealTime(true) switches to the host monotonic
+// clock for benchmarks.
+class FakeClock : public Clock
+{
+private:
+    uint64_t nowUs = 0;
+    bool realTime = false;
+
+public:
+    uint32_t millis() override { return (uint32_t)(micros64() / 1000ULL); }
+    uint32_t micros() override { return (uint32_t)micros64(); }
+    void delay(uint32_t ms) override { advance(ms); }
+    // Simulated time plus the host's own run time, at a nominal 80 MHz, so
+    // probes see both fake waits and real compute
+    uint32_t cycles() override;
+    uint32_t cyclesPerMicro() override { return FAKE_CPU_MHZ; }
+    uint64_t deepSleepMaxUs() override { return sleepLimitUs; }
+
+    uint64_t sleepLimitUs = FAKE_DEEP_SLEEP_MAX_US;
+
+    void advance(uint32_t ms) { nowUs += (uint64_t)ms * 1000ULL; }
+    void advanceMicros(uint32_t us) { nowUs += us; }
+    void setRealTime(bool enabled) { realTime = enabled; }
+    // Like a reset or deep sleep wake: millis() starts again from 0
+    void reboot() { nowUs = 0; }
+
+    uint64_t micros64();
+};
+
+// A device hanging off the fake bus. The default implementation is a plain
+// 256-byte register file; sensor fakes override the hooks.
+class FakeI2CDevice
+{
+protected:
+    uint8_t registers[256] = {};
+
+public:
+    const uint8_t address;
+
+    explicit FakeI2CDevice(uint8_t addr) : address(addr) {}
+    virtual ~FakeI2CDevice() {}
+
+    virtual bool writeRegister(uint8_t reg, uint8_t value)
+    {
+        registers[reg] = value;
+        return true;
+    }
+
+    virtual bool readRegisters(uint8_t reg, uint8_t *buffer, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            buffer[i] = registers[(uint8_t)(reg + i)];
+        }
+        return true;
+    }
+};
+
+class FakeI2CBus : public I2CBus
+{
+private:
+    static const int MAX_DEVICES = 4;
+    FakeI2CDevice *devices[MAX_DEVICES] = {};
+
+    FakeI2CDevice *find(uint8_t address);
+
+public:
+    uint32_t clockHz = 100000;
+    uint32_t transactions = 0;
+    size_t readLimit = 0; // Longer reads fail, like a Wire buffer; 0 = none
+    size_t longestRead = 0;
+
+    bool attach(FakeI2CDevice &device);
+    void detachAll();
+
+    void setClock(uint32_t hz) override { clockHz = hz; }
+    bool writeRegister(uint8_t address, uint8_t reg, uint8_t value) override;
+    bool readRegisters(uint8_t address, uint8_t reg, uint8_t *buffer, size_t length) override;
+    size_t maxReadLength() const override { return readLimit ? readLimit : SIZE_MAX; }
+};
+
+// Loopback stream: everything written is captured in txBuffer, and bytes
+// queued with inject() are returned by read().
+class FakeNetworkClient : public NetworkClient
+{
+public:
+    static const size_t BUFFER_SIZE = 4096;
+
+    uint8_t txBuffer[BUFFER_SIZE];
+    size_t txLength = 0;
+
+    uint8_t rxBuffer[BUFFER_SIZE];
+    size_t rxHead = 0;
+    size_t rxLength = 0;
+
+    bool isConnected = false;
+    bool refuseConnect = false;
+
+    bool connect(const char *host, uint16_t port) override;
+    bool connected() override { return isConnected; }
+    size_t write(const uint8_t *data, size_t length) override;
+    int available() override { return (int)(rxLength - rxHead); }
+    int read(uint8_t *buffer, size_t length) override;
+    void stop() override { isConnected = false; }
+
+    bool inject(const uint8_t *data, size_t length);
+    void clearTx() { txLength = 0; }
+};
+
+// Radio on fake time: begin() connects after a configurable delay, which
+// depends on whether the join was directed, or fails if the AP is "gone"
+class FakeWifiLink : public WifiLink
+{
+private:
+    Clock &clock;
+    WifiLinkStatus linkStatus = WifiLinkStatus::IDLE;
+    uint32_t connectAtMs = 0;
+    bool directed = false;
+    bool willConnect = false;
+    WifiLease staticLease = {0, 0, 0, 0};
+
+public:
+    uint32_t scanJoinMs = 2500;     // Full scan + association
+    uint32_t directedJoinMs = 250;  // Known channel/BSSID
+    uint32_t dhcpMs = 700;          // Skipped with a static IP
+    uint8_t apChannel = 6;
+    uint8_t apBssid[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+    bool apPresent = true;
+    uint32_t begins = 0;
+
+    explicit FakeWifiLink(Clock &clock) : clock(clock) {}
+
+    void begin(const char *ssid, const char *password, uint8_t channel = 0, const uint8_t *bssid = nullptr) override;
+    void setStaticIp(const WifiLease &lease) override { staticLease = lease; }
+    WifiLinkStatus status() override;
+    void disconnect() override { linkStatus = WifiLinkStatus::IDLE; }
+    void associationInfo(uint8_t bssid[6], uint8_t &channel, WifiLease &lease) override;
+    int8_t rssi() override { return -61; }
+};
+
+// Wall clock whose SNTP "reply" arrives syncDelayMs after startSync(), or
+// never when ntpReachable is false
+class FakeWallClock : public WallClock
+{
+private:
+    Clock &clock;
+    int64_t offsetMs = 0; // epoch ms - clock ms, once set
+    bool isSet = false;
+    bool syncing = false;
+    bool sntpSynced = false;
+    uint32_t syncAtMs = 0;
+
+public:
+    uint32_t trueEpochAtBoot = 1760000000; // What NTP would report at millis() == 0
+    uint32_t syncDelayMs = 400;
+    bool ntpReachable = true;
+
+    explicit FakeWallClock(Clock &clock) : clock(clock) {}
+
+    void startSync(const char *primaryServer, const char *secondaryServer) override;
+    bool synced() override;
+    uint64_t nowMs() override;
+    void set(uint32_t epoch) override;
+    // Back to an unset clock, as after a reset
+    void reboot();
+};
+
+// RAM-backed storage, erased to 0xFF like fresh flash
+class FakeStorage : public Storage
+{
+private:
+    uint8_t *bytes;
+    size_t bytesSize;
+
+public:
+    uint32_t commits = 0;
+
+    explicit FakeStorage(size_t size);
+    ~FakeStorage();
+
+    bool begin() override { return true; }
+    size_t size() const override { return bytesSize; }
+    bool read(size_t offset, void *data, size_t length) override;
+    bool write(size_t offset, const void *data, size_t length) override;
+    bool commit() override
+    {
+        commits++;
+        return true;
+    }
+    void end() override {}
+
+    void erase();
+};
+
+// Returns whatever the harness last set, by default a freshly booted board
+class FakeMemoryInfo : public MemoryInfo
+{
+public:
+    MemorySnapshot next = {45000, 40000, 5, 3500};
+
+    MemorySnapshot snapshot() override { return next; }
+};
+
+// Files in a host directory, standing in for LittleFS. Counts what was
+// written so the log benchmark can report flash traffic.
+class HostFileStore : public FileStore
+{
+private:
+    char root[128];
+
+    void resolve(char *out, size_t size, const char *path) const;
+
+public:
+    uint32_t appends = 0;
+    uint32_t rewrites = 0;
+    uint64_t bytesWritten = 0;
+
+    explicit HostFileStore(const char *directory);
+
+    bool begin() override;
+    bool append(const char *path, const void *data, size_t length) override;
+    bool write(const char *path, const void *data, size_t length) override;
+    int read(const char *path, size_t offset, void *data, size_t length) override;
+    long size(const char *path) override;
+    bool remove(const char *path) override;
+
+    // Deletes every file, like formatting the partition
+    void wipe();
+};
+
+// Typed access to the native singletons for harness code
+FakeClock &fakeClock();
+FakeI2CBus &fakeI2C();
+FakeStorage &fakeConfigStorage();
+FakeStorage &fakeRtcStorage();
+FakeWifiLink &fakeWifi();
+FakeWallClock &fakeWallClock();
+HostFileStore &fakeFiles();
+FakeMemoryInfo &fakeMemory();
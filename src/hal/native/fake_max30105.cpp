@@ -0,0 +1,171 @@
+#include "fake_max30105.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint16_t SAMPLE_RATES[8] = {50, 100, 200, 400, 800, 1000, 1600, 3200};
+
+FakeMax30105::FakeMax30105(Clock &clk) : FakeI2CDevice(0x57), clock(clk)
+{
+    registers[0xFF] = 0x15; // PART_ID
+}
+
+uint32_t FakeMax30105::periodUs() const
+{
+    uint32_t rate = SAMPLE_RATES[(registers[0x0A] >> 2) & 0x07];
+    uint32_t average = 1u << ((registers[0x08] >> 5) & 0x07);
+    return 1000000UL * average / rate;
+}
+
+void FakeMax30105::pushSample()
+{
+    // Systolic upstroke followed by a slower decay, roughly like a real PPG
+    double t = (double)produced * periodUs() / 1e6;
+    double phase = fmod(t * heartRateBpm / 60.0, 1.0);
+    double pulse = phase < 0.2 ? sin(phase / 0.2 * M_PI / 2) : exp(-(phase - 0.2) * 5.0);
+
+    uint32_t noise = noiseAmplitude > 0 ? (uint32_t)(rand() % (2 * noiseAmplitude)) : 0;
+    uint32_t irDc = fingerPresent ? 90000 : 3000;
+    uint32_t redDc = fingerPresent ? 70000 : 2000;
+    uint32_t ir = irDc - (fingerPresent ? (uint32_t)(900 * pulse) : 0) + noise;
+    uint32_t red = redDc - (fingerPresent ? (uint32_t)(500 * pulse) : 0) + noise;
+
+    if (count == DEPTH)
+    {
+        // Rollover: oldest sample is lost
+        readPtr = (readPtr + 1) % DEPTH;
+        count--;
+        if (overflow < 0x1F)
+            overflow++;
+    }
+
+    fifoRed[writePtr] = red & 0x3FFFF;
+    fifoIr[writePtr] = ir & 0x3FFFF;
+    writePtr = (writePtr + 1) % DEPTH;
+    count++;
+    produced++;
+}
+
+void FakeMax30105::produce()
+{
+    uint32_t now = clock.micros();
+    bool running = (registers[0x09] & 0x80) == 0 && (registers[0x09] & 0x07) != 0;
+    if (!running)
+    {
+        lastProduceUs = now;
+        return;
+    }
+
+    uint32_t period = periodUs();
+    while ((uint32_t)(now - lastProduceUs) >= period)
+    {
+        lastProduceUs += period;
+        pushSample();
+    }
+
+    // Almost-full interrupt flag
+    if (count >= DEPTH - (registers[0x08] & 0x0F))
+        registers[0x00] |= 0x80;
+}
+
+uint8_t FakeMax30105::popByte()
+{
+    if (count == 0)
+        return 0;
+
+    uint32_t value = byteIndex < 3 ? fifoRed[readPtr] : fifoIr[readPtr];
+    uint8_t shift = (uint8_t)(16 - 8 * (byteIndex % 3));
+    uint8_t byte = (uint8_t)(value >> shift);
+
+    if (++byteIndex == 6)
+    {
+        byteIndex = 0;
+        readPtr = (readPtr + 1) % DEPTH;
+        count--;
+        overflow = 0;
+    }
+    return byte;
+}
+
+bool FakeMax30105::inReset()
+{
+    if (resetting && clock.micros() - resetStartUs >= resetUs)
+        resetting = false;
+    return resetting;
+}
+
+bool FakeMax30105::writeRegister(uint8_t reg, uint8_t value)
+{
+    if (inReset())
+        return true; // Acked, but the part is not listening yet
+
+    switch (reg)
+    {
+    case 0x09:
+        if (value & 0x40)
+        {
+            // Soft reset
+            uint8_t partId = registers[0xFF];
+            memset(registers, 0, sizeof(registers));
+            registers[0xFF] = partId;
+            writePtr = readPtr = count = overflow = byteIndex = 0;
+            lastProduceUs = clock.micros();
+            resetStartUs = clock.micros();
+            resetting = resetUs > 0;
+            return true;
+        }
+        produce();
+        registers[reg] = value;
+        lastProduceUs = clock.micros();
+        return true;
+    case 0x04:
+    case 0x06:
+        // Pointer writes are only used to flush the FIFO
+        writePtr = readPtr = count = byteIndex = 0;
+        return true;
+    case 0x05:
+        overflow = value;
+        return true;
+    default:
+        registers[reg] = value;
+        return true;
+    }
+}
+
+bool FakeMax30105::readRegisters(uint8_t reg, uint8_t *buffer, size_t length)
+{
+    produce();
+
+    for (size_t i = 0; i < length; i++)
+    {
+        // FIFO_DATA does not auto-increment, everything else does
+        uint8_t r = reg == 0x07 ? reg : (uint8_t)(reg + i);
+        switch (r)
+        {
+        case 0x00:
+            buffer[i] = registers[0x00];
+            registers[0x00] = 0; // Read clears status
+            break;
+        case 0x04:
+            buffer[i] = writePtr;
+            break;
+        case 0x05:
+            buffer[i] = overflow;
+            break;
+        case 0x06:
+            buffer[i] = readPtr;
+            break;
+        case 0x09:
+            buffer[i] = inReset() ? (uint8_t)(registers[0x09] | 0x40) : registers[0x09];
+            break;
+        case 0x07:
+            buffer[i] = popByte();
+            break;
+        default:
+            buffer[i] = registers[r];
+            break;
+        }
+    }
+    return true;
+}
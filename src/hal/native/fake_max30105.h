@@ -0,0 +1,53 @@
+#pragma once
+
+#include "fake_hal.h"
+
+// Emulates the MAX30105 FIFO in SpO2 mode. Samples are produced from the
+// fake clock at the configured rate, so drain timing and overflow behave
+// like the real part. The waveform is a synthetic PPG pulse.
+class FakeMax30105 : public FakeI2CDevice
+{
+private:
+    static const uint8_t DEPTH = 32;
+
+    Clock &clock;
+    uint32_t fifoRed[DEPTH];
+    uint32_t fifoIr[DEPTH];
+    uint8_t writePtr = 0;
+    uint8_t readPtr = 0;
+    uint8_t count = 0;
+    uint8_t overflow = 0;
+    uint8_t byteIndex = 0;
+
+    uint32_t lastProduceUs = 0;
+    uint64_t produced = 0;
+    uint32_t resetStartUs = 0;
+    bool resetting = false;
+
+    uint32_t periodUs() const;
+    void produce();
+    void pushSample();
+    uint8_t popByte();
+    bool inReset();
+
+public:
+    float heartRateBpm = 72.0f;
+    bool fingerPresent = true;
+    uint32_t noiseAmplitude = 40;
+    // How long a soft reset keeps the RESET bit set; writes meanwhile are lost
+    uint32_t resetUs = 0;
+
+    explicit FakeMax30105(Clock &clk);
+
+    uint64_t samplesProduced() const { return produced; }
+
+    // Level of the (active low) INT pin, for harnesses emulating the ISR
+    bool interruptAsserted()
+    {
+        produce();
+        return (registers[0x00] & 0x80) != 0;
+    }
+
+    bool writeRegister(uint8_t reg, uint8_t value) override;
+    bool readRegisters(uint8_t reg, uint8_t *buffer, size_t length) override;
+};
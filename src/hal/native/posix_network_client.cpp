@@ -0,0 +1,101 @@
+#include "posix_network_client.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+bool PosixNetworkClient::connect(const char *host, uint16_t port)
+{
+    stop();
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *results = nullptr;
+    if (getaddrinfo(host, service, &hints, &results) != 0)
+        return false;
+
+    for (struct addrinfo *ai = results; ai != nullptr && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(results);
+
+    if (fd >= 0)
+    {
+        // Small MQTT packets: don't let Nagle hold them back
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd >= 0;
+}
+
+size_t PosixNetworkClient::write(const uint8_t *data, size_t length)
+{
+    size_t done = 0;
+    while (fd >= 0 && done < length)
+    {
+        ssize_t sent = send(fd, data + done, length - done, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            stop();
+            break;
+        }
+        done += (size_t)sent;
+    }
+    return done;
+}
+
+int PosixNetworkClient::available()
+{
+    if (fd < 0)
+        return 0;
+
+    int pending = 0;
+    if (ioctl(fd, FIONREAD, &pending) != 0)
+        return 0;
+    if (pending == 0)
+    {
+        // Readable with nothing pending means the peer closed
+        char probe;
+        ssize_t peeked = recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (peeked == 0)
+            stop();
+    }
+    return pending;
+}
+
+int PosixNetworkClient::read(uint8_t *buffer, size_t length)
+{
+    if (fd < 0)
+        return 0;
+    ssize_t received = recv(fd, buffer, length, 0);
+    if (received <= 0)
+    {
+        stop();
+        return 0;
+    }
+    return (int)received;
+}
+
+void PosixNetworkClient::stop()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../hal.h"
+
+// Plain TCP socket, so the MQTT client can be run against a real broker
+// (e.g. a local mosquitto on 1883) from the host build
+class PosixNetworkClient : public NetworkClient
+{
+private:
+    int fd = -1;
+
+public:
+    ~PosixNetworkClient() override { stop(); }
+
+    bool connect(const char *host, uint16_t port) override;
+    bool connected() override { return fd >= 0; }
+    size_t write(const uint8_t *data, size_t length) override;
+    int available() override;
+    int read(uint8_t *buffer, size_t length) override;
+    void stop() override;
+};
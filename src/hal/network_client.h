@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Byte stream to the broker (TLS on the board, plain/fake on native)
+class NetworkClient
+{
+public:
+    virtual ~NetworkClient() {}
+
+    virtual bool connect(const char *host, uint16_t port) = 0;
+    virtual bool connected() = 0;
+    virtual size_t write(const uint8_t *data, size_t length) = 0;
+    virtual int available() = 0;
+    virtual int read(uint8_t *buffer, size_t length) = 0;
+    virtual void stop() = 0;
+};
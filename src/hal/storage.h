@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Small persistent byte area (EEPROM emulation on the board)
+class Storage
+{
+public:
+    virtual ~Storage() {}
+
+    virtual bool begin() = 0;
+    virtual size_t size() const = 0;
+    virtual bool read(size_t offset, void *data, size_t length) = 0;
+    virtual bool write(size_t offset, const void *data, size_t length) = 0;
+    virtual bool commit() = 0;
+    virtual void end() = 0;
+};
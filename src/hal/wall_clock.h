@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+
+// Calendar time (UTC epoch seconds) and its SNTP client. Separate from
+// Clock, which is monotonic and restarts at every boot.
+class WallClock
+{
+public:
+    virtual ~WallClock() {}
+
+    // Starts SNTP in the background; returns immediately
+    virtual void startSync(const char *primaryServer, const char *secondaryServer) = 0;
+    // True once an SNTP reply has set the clock since startSync()
+    virtual bool synced() = 0;
+    // Epoch milliseconds; 0 while the clock has never been set
+    virtual uint64_t nowMs() = 0;
+    virtual void set(uint32_t epoch) = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+// IPv4 addresses in the lwIP/IPAddress byte order (first octet lowest)
+struct WifiLease
+{
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+
+    bool empty() const { return ip == 0; }
+};
+
+enum class WifiLinkStatus : uint8_t
+{
+    IDLE,
+    CONNECTING,
+    CONNECTED, // Associated and has an address
+    FAILED
+};
+
+// Station-mode Wi-Fi radio. begin() returns immediately; status() follows
+// the radio's events, so callers can do other work while it associates.
+class WifiLink
+{
+public:
+    virtual ~WifiLink() {}
+
+    // channel 0 / bssid nullptr scan for the SSID
+    virtual void begin(const char *ssid, const char *password, uint8_t channel = 0,
+                       const uint8_t *bssid = nullptr) = 0;
+    // Address to use instead of DHCP; an empty lease restores DHCP
+    virtual void setStaticIp(const WifiLease &lease) = 0;
+    virtual WifiLinkStatus status() = 0;
+    virtual void disconnect() = 0;
+
+    // Valid once CONNECTED
+    virtual void associationInfo(uint8_t bssid[6], uint8_t &channel, WifiLease &lease) = 0;
+    virtual int8_t rssi() = 0;
+};
@@ -1,79 +1,148 @@
 #include <Wire.h>
-#include <Ticker.h>
 #include <ESP8266WiFi.h>
 
 // Utils & Modules
 #include "utils/sensors.h"
 #include "state/device/device_state.h"
 #include "utils/others.h"
+#include "utils/scheduler.h"
+#include "utils/stage_profiler.h"
 #include "data/remote_datasource.h"
 #include "state/sensor/sensor_state.h"
 #include "state/job/job_state.h"
+#include "state/send/send_state.h"
+#include "state/duty/duty_cycle.h"
 
 // Globals
 Sensor sensor;
 RemoteDataSource remote;
 OtherUtils utils;
 
-// External references
-extern JobState jobState;
+// Task periods (ms) and budgets (us). The network task overruns during a
+// TLS handshake; that is expected and shows up in its counters.
+#ifndef TASK_SENSOR_PERIOD_MS
+#define TASK_SENSOR_PERIOD_MS 25
+#endif
+#ifndef TASK_JOB_PERIOD_MS
+#define TASK_JOB_PERIOD_MS 1200
+#endif
 
-// Ticker
-Ticker ticker;
-Ticker jobTicker;
+// Publish a device-health message (battery, link, memory watermarks) every
+// this many wakes, counting from cold boot
+#ifndef HEALTH_REPORT_EVERY_WAKES
+#define HEALTH_REPORT_EVERY_WAKES 12
+#endif
+
+// Publish the stage latency histograms before each deep sleep
+#ifndef STAGE_METRICS_MESSAGE
+#define STAGE_METRICS_MESSAGE 0
+#endif
+
+// Tasks
+static void sensorTask(void *)
+{
+    // Queues the sample for the job task
+    PROFILE_SCOPE(STAGE_SENSOR_READ);
+    float temperature = sensor.readTemperature();
+    float bpm = sensor.readHeartBeat();
+    sensorState.setState(temperature, bpm, sensor.readSpO2(), millis());
+}
+
+static void jobTask(void *)
+{
+    jobState.tick();
+}
+
+static void networkTask(void *)
+{
+    // MQTT keep-alive, PUBACKs, log drain and retries
+    remote.loop();
+}
+
+static void sendTask(void *)
+{
+    // Connect → publish → await PUBACK, one step per run
+    sendState.tick(remote);
+}
+
+static void deviceTask(void *)
+{
+    deviceState.updateFromSystem();
+}
+
+static void serialTask(void *)
+{
+    utils.onDeviceStateChange();
+}
 
 // Setup
 void setup()
 {
     utils.serialTimeInitialization();
+    // A partial line must not hold the serial task for the default 1 s
+    Serial.setTimeout(20);
+    // Saved Wi-Fi and device config, before remote.begin() joins
+    deviceState.begin();
 
     // Initial update after Wi-Fi connected
     deviceState.updateFromSystem();
 
-    // Init sensors & modules
-    sensor.begin();
+    // Start the Wi-Fi join first so sensor warm-up overlaps association
     remote.begin();
-    delay(1000); // Wait for Wi-Fi connection
-    remote.connect();
+    sensor.begin();
+
+    // Window length chosen by the duty-cycle policy before the last sleep
+    if (dutyCycle.restore())
+        Serial.printf("[DUTY] %lu ms windows, %u per batch\n", (unsigned long)dutyCycle.windowMs(),
+                      dutyCycle.windowsPerBatch());
+    jobState.configure(dutyCycle.windowMs(), dutyCycle.windowsPerBatch());
     jobState.begin();
     jobState.startJob();
 
-    // Job to Send Data to Azure
-    jobTicker.attach(1.2, []()
-                    { 
-                         // Only tick if job is active and not ready for sleep
-                        if (!jobState.isReadyForSleep()) {
-                            jobState.tick(remote); 
-                        }
-                    });
+    // Sensors settle while Wi-Fi associates; the job's first tick then
+    // already has samples to fold
+    scheduler.add("sensor", sensorTask, nullptr, TASK_SENSOR_PERIOD_MS, 3000, SENSOR_SETTLE_MS);
+    scheduler.add("network", networkTask, nullptr, 10, 5000);
+    scheduler.add("send", sendTask, nullptr, 20, 2000, 5);
+    scheduler.add("serial", serialTask, nullptr, 100, 2000, 15);
+    scheduler.add("job", jobTask, nullptr, TASK_JOB_PERIOD_MS, 5000, SENSOR_SETTLE_MS + TASK_JOB_PERIOD_MS);
+    scheduler.add("device", deviceTask, nullptr, 5000, 5000, 5000);
 }
 
 // Main Loop
 void loop()
 {
-    // Check if job is ready for deep sleep
-    if (jobState.isReadyForSleep()) {
-        // Stop all tickers before deep sleep
-        Serial.println("Stopping tickers...");
-        jobTicker.detach();
-        ticker.detach();
-        delay(100);
-        
-        // Prepare for deep sleep
-        jobState.prepareForDeepSleep(remote);
+    // Send task done and no further cycle posted by the job task: sleep
+    if (sendState.readyForSleep()) {
+        jobState.stop();
+        sendState.printTimings();
+        scheduler.printStats();
+
+        // Next sleep and window length from this cycle's vitals, battery and link
+        const CompletedCycle &cycle = sendState.lastCycle();
+        DutyInputs inputs;
+        inputs.batteryPercent = deviceState.getBatteryPercent();
+        inputs.rssi = WiFi.isConnected() ? (int8_t)WiFi.RSSI() : 0;
+        inputs.delivered = sendState.delivered > 0;
+        DutyDecision duty = dutyCycle.decide(cycle.batch, cycle.temperature, inputs, millis());
+        Serial.printf("[DUTY] Sleeping %lu s (%s), next wake %u x %lu ms windows\n", (unsigned long)duty.sleepS,
+                      duty.reason, duty.windowsPerBatch, (unsigned long)duty.windowMs);
+
+        if (wakeState.wakeCount() % HEALTH_REPORT_EVERY_WAKES == 0 && !remote.publishHealth())
+            Serial.println("[HEALTH] Health message not sent");
+#if STAGE_METRICS_MESSAGE
+        if (!remote.publishMetrics())
+            Serial.println("[PERF] Metrics message not sent");
+#endif
+
+        // Job complete, delegate sleep preparation to DeviceState
+        Serial.println("[JOB] Job complete, delegating sleep preparation to DeviceState...");
+        deviceState.prepareForDeepSleep(remote, duty.sleepS * 1000000ULL);
         // This line should never be reached as ESP.deepSleep() resets the device
     }
-    
-    // Handle MQTT connection and messages
-    remote.loop();
-    
-    // Detects Command from Serial
-    utils.onDeviceStateChange();
-
-    // Update sensor state
-    sensorState.setState(
-        sensor.readTemperature(),
-        sensor.readHeartBeat());
 
-    delay(10); // delay biar ga bentrokan
+    // Nothing released: yield until the next deadline instead of spinning,
+    // so the SDK can modem-sleep between tasks
+    if (!scheduler.runOnce())
+        delay(scheduler.idleMs());
 }
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "native_app.h"
+#include "../hal/native/fake_hal.h"
+#include "../hal/native/fake_max30105.h"
+#include "../utils/max30105_fifo.h"
+
+struct AcquisitionResult
+{
+    uint64_t produced;
+    uint64_t consumed;
+    uint32_t transactions;
+    uint32_t loops;
+};
+
+static void printResult(const char *name, const AcquisitionResult &r)
+{
+    printf("%-8s produced=%llu consumed=%llu (%.1f%%) i2c=%u (%.2f per consumed sample) loops=%u\n",
+           name, (unsigned long long)r.produced, (unsigned long long)r.consumed,
+           r.produced ? 100.0 * r.consumed / r.produced : 0.0,
+           r.transactions, r.consumed ? (double)r.transactions / r.consumed : 0.0, r.loops);
+}
+
+// Time the rest of loop() takes (MLX read, MQTT loop, serial), in ms
+static const uint32_t LOOP_WORK_MS = 15;
+
+// Old path: one pointer check plus a one-sample read per loop() pass, with
+// delay(10) in loop() and delay(100) whenever the finger is missing.
+static AcquisitionResult runPolling(FakeMax30105 &sensor, uint32_t durationMs)
+{
+    FakeClock &clock = fakeClock();
+    FakeI2CBus &bus = fakeI2C();
+    Max30105Fifo fifo(bus);
+    fifo.begin();
+
+    AcquisitionResult result = {};
+    uint64_t producedBefore = sensor.samplesProduced();
+    uint32_t transactionsBefore = bus.transactions;
+    uint32_t start = clock.millis();
+
+    PpgSample block[Max30105Fifo::FIFO_DEPTH];
+    while (clock.millis() - start < durationMs)
+    {
+        // getIR(): read pointers, then flush the FIFO keeping only the newest
+        if (fifo.drain(block, Max30105Fifo::FIFO_DEPTH) > 0)
+            result.consumed++;
+        if (!sensor.fingerPresent)
+            clock.advance(100);
+
+        clock.advance(10 + LOOP_WORK_MS);
+        result.loops++;
+    }
+
+    result.produced = sensor.samplesProduced() - producedBefore;
+    result.transactions = bus.transactions - transactionsBefore;
+    return result;
+}
+
+// New path: the almost-full interrupt triggers one burst drain
+static AcquisitionResult runFifo(FakeMax30105 &sensor, uint32_t durationMs)
+{
+    FakeClock &clock = fakeClock();
+    FakeI2CBus &bus = fakeI2C();
+    Max30105Fifo fifo(bus);
+    fifo.begin();
+
+    AcquisitionResult result = {};
+    uint64_t producedBefore = sensor.samplesProduced();
+    uint32_t transactionsBefore = bus.transactions;
+    uint32_t start = clock.millis();
+
+    PpgSample block[Max30105Fifo::FIFO_DEPTH];
+    while (clock.millis() - start < durationMs)
+    {
+        // Emulated ISR on the INT pin
+        if (sensor.interruptAsserted())
+            fifo.onInterrupt();
+
+        if (fifo.interruptPending())
+            result.consumed += fifo.drain(block, Max30105Fifo::FIFO_DEPTH);
+
+        clock.advance(10 + LOOP_WORK_MS);
+        result.loops++;
+    }
+
+    result.produced = sensor.samplesProduced() - producedBefore;
+    result.transactions = bus.transactions - transactionsBefore;
+    if (fifo.overflowCount() > 0)
+        printf("warning: %u samples lost to FIFO overflow\n", fifo.overflowCount());
+    return result;
+}
+
+// An almost-full (24 samples, 144 bytes) or overflowed (32, 192 bytes)
+// FIFO is more than Wire's 128-byte buffer: it has to come out in reads of
+// whole samples, with every sample intact
+static bool checkLongBurst(FakeMax30105 &sensor, uint32_t samples)
+{
+    FakeClock &clock = fakeClock();
+    FakeI2CBus &bus = fakeI2C();
+    Max30105Fifo fifo(bus);
+    fifo.begin();
+
+    uint32_t noise = sensor.noiseAmplitude;
+    sensor.noiseAmplitude = 0;
+    bus.readLimit = 128;
+    bus.longestRead = 0;
+    clock.advance(samples * fifo.samplePeriodUs() / 1000);
+
+    PpgSample block[Max30105Fifo::FIFO_DEPTH];
+    size_t expected = samples < Max30105Fifo::FIFO_DEPTH ? samples : Max30105Fifo::FIFO_DEPTH;
+    size_t count = fifo.drain(block, Max30105Fifo::FIFO_DEPTH);
+    bool ok = count == expected && bus.longestRead <= bus.readLimit &&
+              bus.longestRead % Max30105Fifo::BYTES_PER_SAMPLE == 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        // The fake's finger-on levels; a shifted read mixes red and IR bytes
+        ok = ok && block[i].red > 69000 && block[i].red <= 70000 && block[i].ir > 89000 && block[i].ir <= 90000;
+    }
+
+    printf("burst of %u samples over a %u-byte bus: %u read, longest read %u bytes: %s\n", (unsigned)samples,
+           (unsigned)bus.readLimit, (unsigned)count, (unsigned)bus.longestRead, ok ? "ok" : "FAIL");
+    bus.readLimit = 0;
+    sensor.noiseAmplitude = noise;
+    return ok;
+}
+
+// begin() waits out the soft reset before configuring, and gives up on a
+// part that never leaves it
+static bool checkResetWait(FakeMax30105 &sensor)
+{
+    FakeClock &clock = fakeClock();
+    FakeI2CBus &bus = fakeI2C();
+    Max30105Fifo fifo(bus, clock);
+
+    sensor.resetUs = 3000;
+    bool ok = fifo.begin() && bus.readRegister(Max30105Fifo::I2C_ADDRESS, 0x09) == 0x03 &&
+              bus.readRegister(Max30105Fifo::I2C_ADDRESS, 0x0A) != 0;
+
+    sensor.resetUs = UINT32_MAX;
+    uint32_t start = clock.millis();
+    ok = ok && !fifo.begin() && clock.millis() - start >= MAX30105_RESET_TIMEOUT_MS;
+
+    sensor.resetUs = 0;
+    ok = ok && fifo.begin();
+    printf("soft reset: configured after it clears, %u ms timeout: %s\n", MAX30105_RESET_TIMEOUT_MS,
+           ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Compares I2C traffic and sample coverage of per-loop polling vs FIFO bursts
+int runAcquisition(int argc, char **argv)
+{
+    uint32_t durationMs = argc > 1 ? (uint32_t)atoi(argv[1]) * 1000 : 60000;
+
+    FakeI2CBus &bus = fakeI2C();
+    FakeMax30105 sensor(fakeClock());
+    bus.detachAll();
+    bus.attach(sensor);
+
+    // 33 periods: one sample past full, so the overflow counter reports it
+    bool ok = checkResetWait(sensor);
+    ok = checkLongBurst(sensor, 24) && ok;
+    ok = checkLongBurst(sensor, Max30105Fifo::FIFO_DEPTH + 1) && ok;
+
+    printf("acquisition over %u s of simulated time\n", durationMs / 1000);
+    printResult("polling", runPolling(sensor, durationMs));
+    printResult("fifo", runFifo(sensor, durationMs));
+
+    bus.detachAll();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#include "alloc_probe.h"
+
+#include <string.h>
+
+static AllocCounts counts = {0, 0, 0};
+
+#if defined(__GLIBC__)
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *pointer, size_t size);
+    void __libc_free(void *pointer);
+
+    void *malloc(size_t size)
+    {
+        counts.allocations++;
+        counts.bytesRequested += size;
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        counts.allocations++;
+        counts.bytesRequested += count * size;
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *pointer, size_t size)
+    {
+        counts.allocations++;
+        counts.bytesRequested += size;
+        return __libc_realloc(pointer, size);
+    }
+
+    void free(void *pointer)
+    {
+        if (pointer)
+            counts.frees++;
+        __libc_free(pointer);
+    }
+}
+
+bool AllocProbe::available() { return true; }
+
+#else
+
+bool AllocProbe::available() { return false; }
+
+#endif
+
+AllocCounts AllocProbe::snapshot() { return counts; }
+
+static const size_t STACK_PAINT_BYTES = 16 * 1024;
+static const uint8_t STACK_PAINT = 0xA5;
+
+// Where paintStack() left its pattern. Kept as an integer: the frame is
+// gone by the time paintedDepth() reads it, which is the point.
+static uintptr_t paintedAddress = 0;
+
+__attribute__((noinline)) static void paintStack()
+{
+    volatile uint8_t region[STACK_PAINT_BYTES];
+    for (size_t i = 0; i < STACK_PAINT_BYTES; i++)
+        region[i] = STACK_PAINT;
+    paintedAddress = (uintptr_t)region;
+}
+
+// Bytes from the bottom of the painted region up to the deepest one the
+// measured function overwrote
+static size_t paintedDepth()
+{
+    const volatile uint8_t *region = (const volatile uint8_t *)paintedAddress;
+    size_t untouched = 0;
+    while (untouched < STACK_PAINT_BYTES && region[untouched] == STACK_PAINT)
+        untouched++;
+    return STACK_PAINT_BYTES - untouched;
+}
+
+size_t measureStackUse(void (*function)(void *), void *context)
+{
+    paintStack();
+    function(context);
+    return paintedDepth();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Heap accounting for the host build. On glibc the malloc family is wrapped
+// (operator new goes through malloc), so every allocation in the process is
+// counted. Elsewhere the counters stay at zero and available() is false.
+
+struct AllocCounts
+{
+    uint32_t allocations;
+    uint32_t frees;
+    size_t bytesRequested;
+};
+
+class AllocProbe
+{
+public:
+    static bool available();
+    static AllocCounts snapshot();
+};
+
+// Allocations made between construction and the call to delta()
+class AllocScope
+{
+private:
+    AllocCounts start;
+
+public:
+    AllocScope() : start(AllocProbe::snapshot()) {}
+
+    AllocCounts delta() const
+    {
+        AllocCounts now = AllocProbe::snapshot();
+        return {now.allocations - start.allocations, now.frees - start.frees,
+                now.bytesRequested - start.bytesRequested};
+    }
+};
+
+// Rough stack depth of a call: paint a region below the caller's frame,
+// run the function, and see how much of the paint was overwritten.
+size_t measureStackUse(void (*function)(void *), void *context);
@@ -0,0 +1,150 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "native_app.h"
+#include "bench_timer.h"
+#include "../hal/native/fake_hal.h"
+#include "../hal/native/fake_max30105.h"
+#include "../utils/max30105_fifo.h"
+#include "../dsp/ppg_pipeline.h"
+
+// The previous readHeartBeat() path in float: the "irValue - 0.99 * prevIR"
+// filter, then a float band-pass and peak search standing in for SparkFun's
+// checkForBeat (which is not available off the board).
+class FloatPpgReference
+{
+private:
+    float prevIR = 0;
+    float b0 = 0, b2 = 0, a1 = 0, a2 = 0;
+    float x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    float envelope = 0, prev = 0, prevPrev = 0;
+    uint32_t sinceBeat = 0;
+    float sampleRateHz;
+
+public:
+    float beatsPerMinute = 0;
+    uint32_t beats = 0;
+
+    explicit FloatPpgReference(float rateHz) : sampleRateHz(rateHz)
+    {
+        float centerHz = sqrtf(40.0f / 60.0f * 120.0f / 60.0f);
+        float q = centerHz / (120.0f / 60.0f - 40.0f / 60.0f);
+        float w0 = 2.0f * (float)M_PI * centerHz / rateHz;
+        float alpha = sinf(w0) / (2.0f * q);
+        float a0 = 1.0f + alpha;
+        b0 = alpha / a0;
+        b2 = -b0;
+        a1 = -2.0f * cosf(w0) / a0;
+        a2 = (1.0f - alpha) / a0;
+    }
+
+    void process(uint32_t irValue)
+    {
+        float filteredIR = irValue - 0.99f * prevIR;
+        prevIR = (float)irValue;
+
+        float y = b0 * filteredIR + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1;
+        x1 = filteredIR;
+        y2 = y1;
+        y1 = y;
+        y = -y;
+
+        float magnitude = fabsf(y);
+        envelope = magnitude > envelope ? magnitude : envelope * 0.992f;
+        sinceBeat++;
+        if (prev > prevPrev && prev >= y && prev > 0.4f * envelope && sinceBeat > 40)
+        {
+            float bpm = 60.0f / ((sinceBeat - 1) / sampleRateHz);
+            if (bpm > 30 && bpm < 150)
+            {
+                beatsPerMinute = bpm;
+                beats++;
+            }
+            sinceBeat = 1;
+        }
+        prevPrev = prev;
+        prev = y;
+    }
+};
+
+// Records a synthetic trace through the fake sensor and FIFO driver
+static size_t recordTrace(PpgSample *trace, size_t capacity, float heartRateBpm)
+{
+    FakeClock &clock = fakeClock();
+    FakeI2CBus &bus = fakeI2C();
+    FakeMax30105 sensor(clock);
+    sensor.heartRateBpm = heartRateBpm;
+    sensor.noiseAmplitude = 60;
+    bus.detachAll();
+    bus.attach(sensor);
+
+    Max30105Fifo fifo(bus);
+    fifo.begin();
+
+    size_t length = 0;
+    while (length < capacity)
+    {
+        clock.advance(100);
+        length += fifo.drain(trace + length, capacity - length);
+    }
+
+    bus.detachAll();
+    return length;
+}
+
+// Cycles per sample of the fixed-point chain against the float path
+int runDspBenchmark(int argc, char **argv)
+{
+    float heartRate = argc > 1 ? (float)atof(argv[1]) : 72.0f;
+    const size_t SAMPLES = 60 * 100; // One minute at 100 Hz
+    const int REPEATS = 50;
+
+    static PpgSample trace[SAMPLES];
+    size_t length = recordTrace(trace, SAMPLES, heartRate);
+
+    volatile uint32_t sink = 0;
+    BenchTimer timer;
+
+    PpgPipeline pipeline;
+    uint64_t fixedNs = 0, fixedCycles = 0;
+    for (int r = 0; r < REPEATS; r++)
+    {
+        pipeline.begin();
+        timer.start();
+        for (size_t i = 0; i < length; i += Max30105Fifo::FIFO_DEPTH)
+        {
+            size_t block = length - i < Max30105Fifo::FIFO_DEPTH ? length - i : Max30105Fifo::FIFO_DEPTH;
+            sink += pipeline.processBlock(trace + i, block);
+        }
+        fixedCycles += timer.elapsedCycles();
+        fixedNs += timer.elapsedNs();
+    }
+
+    uint64_t floatNs = 0, floatCycles = 0;
+    float floatBpm = 0;
+    for (int r = 0; r < REPEATS; r++)
+    {
+        FloatPpgReference reference(100.0f);
+        timer.start();
+        for (size_t i = 0; i < length; i++)
+        {
+            reference.process(trace[i].ir);
+        }
+        floatCycles += timer.elapsedCycles();
+        floatNs += timer.elapsedNs();
+        floatBpm = reference.beatsPerMinute;
+        sink += reference.beats;
+    }
+
+    double total = (double)length * REPEATS;
+    printf("dsp benchmark: %zu samples x %d, true heart rate %.1f bpm\n", length, REPEATS, heartRate);
+    printf("fixed-point  %7.2f ns/sample %7.1f cycles/sample  bpm=%.1f beats=%u\n",
+           fixedNs / total, fixedCycles / total, pipeline.bpm(), pipeline.beatCount());
+    printf("float        %7.2f ns/sample %7.1f cycles/sample  bpm=%.1f\n",
+           floatNs / total, floatCycles / total, floatBpm);
+    printf("note: host has an FPU; on the ESP8266 every float op above is a soft-float call\n");
+    (void)sink;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "native_app.h"
+#include "bench_timer.h"
+#include "../hal/native/fake_hal.h"
+#include "../hal/native/fake_max30105.h"
+#include "../utils/max30105_fifo.h"
+#include "../dsp/ppg_pipeline.h"
+#include "../dsp/spo2_estimator.h"
+
+static const size_t MAX_TRACE = 60000; // 10 minutes at 100 Hz
+static PpgSample trace[MAX_TRACE];
+
+// Loads a recorded trace, one "red,ir" pair of raw counts per line
+static size_t loadTrace(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == nullptr)
+    {
+        printf("cannot open %s\n", path);
+        return 0;
+    }
+
+    size_t length = 0;
+    unsigned long red, ir;
+    char line[64];
+    while (length < MAX_TRACE && fgets(line, sizeof(line), file) != nullptr)
+    {
+        if (sscanf(line, "%lu,%lu", &red, &ir) == 2)
+        {
+            trace[length].red = (uint32_t)red;
+            trace[length].ir = (uint32_t)ir;
+            length++;
+        }
+    }
+    fclose(file);
+    return length;
+}
+
+static size_t syntheticTrace(size_t length)
+{
+    FakeI2CBus &bus = fakeI2C();
+    FakeMax30105 sensor(fakeClock());
+    sensor.noiseAmplitude = 60;
+    bus.detachAll();
+    bus.attach(sensor);
+
+    Max30105Fifo fifo(bus);
+    fifo.begin();
+
+    size_t filled = 0;
+    while (filled < length)
+    {
+        fakeClock().advance(100);
+        filled += fifo.drain(trace + filled, length - filled);
+    }
+
+    bus.detachAll();
+    return filled;
+}
+
+// SpO2 on a recorded (or synthetic) trace: cost per sample, window quality
+int runSpo2Benchmark(int argc, char **argv)
+{
+    size_t length = argc > 1 ? loadTrace(argv[1]) : syntheticTrace(6000);
+    if (length == 0)
+        return 1;
+
+    const int REPEATS = 20;
+    PpgPipeline pipeline;
+    Spo2Estimator spo2;
+    BenchTimer timer;
+    uint64_t ns = 0, cycles = 0;
+
+    for (int r = 0; r < REPEATS; r++)
+    {
+        pipeline.begin();
+        pipeline.attach(&spo2);
+        timer.start();
+        for (size_t i = 0; i < length; i += Max30105Fifo::FIFO_DEPTH)
+        {
+            size_t block = length - i < Max30105Fifo::FIFO_DEPTH ? length - i : Max30105Fifo::FIFO_DEPTH;
+            pipeline.processBlock(trace + i, block);
+        }
+        cycles += timer.elapsedCycles();
+        ns += timer.elapsedNs();
+    }
+
+    double total = (double)length * REPEATS;
+    printf("spo2 benchmark: %zu samples (%s) x %d\n", length, argc > 1 ? argv[1] : "synthetic", REPEATS);
+    printf("pipeline + spo2  %.2f ns/sample %.1f cycles/sample\n", ns / total, cycles / total);
+    printf("state size: PpgPipeline %zu bytes, Spo2Estimator %zu bytes\n", sizeof(PpgPipeline), sizeof(Spo2Estimator));
+    printf("result: spo2=%.1f%% (last window %.1f%%, R=%.3f) bpm=%.1f\n",
+           spo2.spo2(), spo2.lastWindowX10() / 10.0, spo2.lastRatioQ10() / 1024.0, pipeline.bpm());
+    printf("windows: %u good, %u flagged (last flags 0x%02x)\n",
+           spo2.goodWindows / REPEATS, spo2.badWindows / REPEATS, spo2.lastQuality());
+    return 0;
+}
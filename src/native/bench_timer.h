@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Host timing for benchmarks: wall-clock nanoseconds plus the CPU cycle
+// counter where the architecture exposes one.
+class BenchTimer
+{
+private:
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t startCycles = 0;
+
+    static uint64_t cycles()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+public:
+    void start()
+    {
+        startTime = std::chrono::steady_clock::now();
+        startCycles = cycles();
+    }
+
+    uint64_t elapsedNs() const
+    {
+        auto elapsed = std::chrono::steady_clock::now() - startTime;
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+    uint64_t elapsedCycles() const { return cycles() - startCycles; }
+};
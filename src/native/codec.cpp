@@ -0,0 +1,90 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "native_app.h"
+#include "../data/codec/telemetry_codec.h"
+#include "../data/codec/telemetry_decoder.h"
+
+static const char *DEVICE_ID = "1";
+static const uint32_t BASE_EPOCH = 1760000000;
+
+static bool near(float a, float b, float tolerance)
+{
+    return fabsf(a - b) <= tolerance;
+}
+
+static bool checkSummary(const char *name, const float decoded[3], const VitalSummary &sent, float tolerance)
+{
+    bool ok = near(decoded[0], sent.mean, tolerance) && near(decoded[1], sent.min, tolerance) &&
+              near(decoded[2], sent.max, tolerance);
+    if (!ok)
+        printf("  %s mismatch: sent [%.3f %.3f %.3f] got [%.3f %.3f %.3f]\n", name, sent.mean, sent.min, sent.max,
+               decoded[0], decoded[1], decoded[2]);
+    return ok;
+}
+
+// Encodes a full synthetic batch and a single reading, decodes both and
+// checks every field survives within the fixed-point resolution.
+int runCodecRoundTrip(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    srand(3);
+    TelemetryBatch batch;
+    batch.clear();
+    batch.baseMs = 5000;
+    batch.windowMs = TELEMETRY_WINDOW_MS;
+
+    for (uint8_t i = 0; i < TELEMETRY_BATCH_SIZE; i++)
+    {
+        RunningStats bpm(true), temp, spo2(true);
+        for (int s = 0; s < 8; s++)
+        {
+            bpm.add(68.0f + rand() % 120 / 10.0f);
+            temp.add(36.4f + rand() % 50 / 100.0f);
+            spo2.add(95.0f + rand() % 40 / 10.0f);
+        }
+        batch.add(batch.baseMs + i * batch.windowMs, bpm, temp, spo2);
+    }
+
+    uint8_t buffer[512];
+    size_t cborSize = TelemetryCodec::encodeBatch(buffer, sizeof(buffer), DEVICE_ID, BASE_EPOCH, batch);
+    static char json[TELEMETRY_PAYLOAD_CAPACITY];
+    size_t jsonSize = TelemetryCodec::encodeBatchJson(json, sizeof(json), DEVICE_ID, BASE_EPOCH, batch);
+    printf("batch of %u windows: CBOR %zu bytes, JSON %zu bytes (%.0f%%)\n", batch.count, cborSize, jsonSize,
+           100.0 * cborSize / jsonSize);
+
+    static DecodedTelemetry decoded;
+    bool ok = cborSize > 0 && decodeTelemetry(buffer, cborSize, decoded);
+    ok = ok && decoded.version == TELEMETRY_SCHEMA_VERSION && decoded.timestamp == BASE_EPOCH &&
+         decoded.windowMs == batch.windowMs && decoded.windowCount == batch.count;
+
+    for (uint8_t i = 0; ok && i < batch.count; i++)
+    {
+        const TelemetryWindow &sent = batch.windows[i];
+        const DecodedWindow &got = decoded.windows[i];
+        ok = got.offsetSeconds == sent.offsetMs / 1000 && got.samples == sent.samples &&
+             got.quality == sent.quality;
+        ok = checkSummary("pulseRate", got.pulseRate, sent.bpm, 0.05f) && ok;
+        ok = checkSummary("temperature", got.temperature, sent.temperature, 0.005f) && ok;
+        ok = checkSummary("spO2", got.spO2, sent.spO2, 0.05f) && ok;
+    }
+
+    size_t readingSize = TelemetryCodec::encodeReading(buffer, sizeof(buffer), DEVICE_ID, BASE_EPOCH, 72.4f, 36.81f,
+                                                       97.3f);
+    bool readingOk = readingSize > 0 && decodeTelemetry(buffer, readingSize, decoded) && !decoded.isBatch() &&
+                     near(decoded.pulseRate, 72.4f, 0.05f) && near(decoded.temperature, 36.81f, 0.005f) &&
+                     near(decoded.spO2, 97.3f, 0.05f);
+    size_t readingJsonSize = TelemetryCodec::encodeReadingJson(json, sizeof(json), DEVICE_ID, BASE_EPOCH, 72.4f,
+                                                               36.81f, 97.3f);
+    printf("single reading: CBOR %zu bytes, JSON %zu bytes\n  %s\n", readingSize, readingJsonSize, json);
+
+    // Truncated input must be rejected, never read past the end
+    bool truncatedRejected = !decodeTelemetry(buffer, readingSize - 1, decoded);
+
+    printf("round trip: batch %s, reading %s, truncated %s\n", ok ? "ok" : "FAILED", readingOk ? "ok" : "FAILED",
+           truncatedRejected ? "rejected" : "ACCEPTED");
+    return ok && readingOk && truncatedRejected ? 0 : 1;
+}
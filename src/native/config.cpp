@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "native_app.h"
+#include "bench_timer.h"
+#include "../hal/native/fake_hal.h"
+#include "../state/config/config_store.h"
+#include "../utils/crc32.h"
+
+static DeviceConfig sampleConfig(const char *ssid)
+{
+    DeviceConfig config;
+    memset(&config, 0, sizeof(config));
+    strcpy(config.wifiSSID, ssid);
+    strcpy(config.wifiPassword, "hunter22");
+    config.staticIp = {0x6401A8C0, 0x0101A8C0, 0x00FFFFFF, 0x0101A8C0};
+    strcpy(config.deviceName, "PETSA-02 kandang 3");
+    strcpy(config.location, "Blok B");
+    strcpy(config.installationDate, "2026-10-01");
+    return config;
+}
+
+static bool same(const DeviceConfig &a, const DeviceConfig &b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Slots alternate, the newest wins, and a torn newest falls back
+static bool checkSlots(FakeStorage &eeprom)
+{
+    eeprom.erase();
+    DeviceConfig loaded;
+    ConfigStore store(eeprom);
+    bool ok = store.load(loaded) == ConfigSource::DEFAULTS && loaded.wifiSSID[0] == '\0';
+
+    DeviceConfig first = sampleConfig("rumah"), second = sampleConfig("kantor");
+    ok = ok && store.save(first) && store.activeSlot() == 0;
+    ok = ok && store.save(second) && store.activeSlot() == 1 && store.sequence() == 2;
+
+    ConfigStore reboot(eeprom);
+    ok = ok && reboot.load(loaded) == ConfigSource::RECORD && same(loaded, second) && reboot.activeSlot() == 1;
+
+    // Power lost halfway through writing slot 1's config
+    uint8_t garbage[64];
+    memset(garbage, 0xFF, sizeof(garbage));
+    eeprom.write(CONFIG_SLOT_SIZE + sizeof(ConfigHeader) + 40, garbage, sizeof(garbage));
+    ConfigStore torn(eeprom);
+    ok = ok && torn.load(loaded) == ConfigSource::RECORD && same(loaded, first) && torn.activeSlot() == 0;
+
+    // The next save overwrites the torn slot, not the good one
+    DeviceConfig third = sampleConfig("sawah");
+    ok = ok && torn.save(third) && torn.activeSlot() == 1 && torn.sequence() == 2;
+    ConfigStore after(eeprom);
+    ok = ok && after.load(loaded) == ConfigSource::RECORD && same(loaded, third);
+
+    printf("slots: alternate, newest wins, torn write falls back: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// A shorter record from an older layout loads with the newer fields zeroed;
+// one from newer firmware is left alone
+static bool checkVersions(FakeStorage &eeprom)
+{
+    eeprom.erase();
+    DeviceConfig config = sampleConfig("lama");
+
+    ConfigHeader header;
+    header.magic = ConfigHeader::MAGIC;
+    header.version = ConfigHeader::VERSION;
+    header.length = offsetof(DeviceConfig, installationDate);
+    header.sequence = 7;
+    header.crc = crc32(&config, header.length, crc32(&header, offsetof(ConfigHeader, crc)));
+    eeprom.write(0, &header, sizeof(header));
+    eeprom.write(sizeof(header), &config, header.length);
+
+    DeviceConfig loaded;
+    ConfigStore store(eeprom);
+    bool ok = store.load(loaded) == ConfigSource::RECORD && strcmp(loaded.location, "Blok B") == 0 &&
+              loaded.installationDate[0] == '\0' && store.sequence() == 7;
+
+    header.version = ConfigHeader::VERSION + 1;
+    header.length = sizeof(DeviceConfig);
+    header.crc = crc32(&config, header.length, crc32(&header, offsetof(ConfigHeader, crc)));
+    eeprom.write(0, &header, sizeof(header));
+    eeprom.write(sizeof(header), &config, header.length);
+    ConfigStore newer(eeprom);
+    ok = ok && newer.load(loaded) == ConfigSource::DEFAULTS;
+
+    printf("versions: shorter layout migrated, newer firmware's record skipped: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// The old length-prefixed JSON is detected and handed back for conversion
+static bool checkLegacy(FakeStorage &eeprom)
+{
+    eeprom.erase();
+    const char json[] = "{\"wifi_ssid\":\"rumah\",\"wifi_password\":\"hunter22\",\"device_name\":\"PETSA-02\"}";
+    uint8_t prefix[2] = {(uint8_t)(sizeof(json) - 1), 0};
+    eeprom.write(0, prefix, sizeof(prefix));
+    eeprom.write(2, json, sizeof(json) - 1);
+
+    DeviceConfig loaded;
+    char text[512];
+    ConfigStore store(eeprom);
+    bool ok = store.load(loaded) == ConfigSource::LEGACY_JSON;
+    ok = ok && store.legacyJson(text, sizeof(text)) == sizeof(json) - 1 && strcmp(text, json) == 0;
+
+    // Converted and saved: binary from then on
+    DeviceConfig converted = sampleConfig("rumah");
+    ok = ok && store.save(converted);
+    ConfigStore reboot(eeprom);
+    ok = ok && reboot.load(loaded) == ConfigSource::RECORD && same(loaded, converted);
+
+    printf("legacy JSON: detected, converted once: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int runConfigStore(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    FakeStorage eeprom(512);
+
+    bool ok = checkSlots(eeprom);
+    ok = checkVersions(eeprom) && ok;
+    ok = checkLegacy(eeprom) && ok;
+
+    // Boot-time cost of a load with both slots valid
+    eeprom.erase();
+    ConfigStore store(eeprom);
+    DeviceConfig config = sampleConfig("rumah");
+    store.save(config);
+    store.save(config);
+
+    const int iterations = 100000;
+    BenchTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+        store.load(config);
+    printf("\nload of %u-byte config from two slots: %.0f ns on host\n", (unsigned)sizeof(DeviceConfig),
+           (double)timer.elapsedNs() / iterations);
+    return ok ? 0 : 1;
+}
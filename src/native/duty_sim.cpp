@@ -0,0 +1,242 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "native_app.h"
+#include "../hal/native/fake_hal.h"
+#include "../state/duty/duty_cycle.h"
+#include "../utils/battery.h"
+
+// Current draw of each phase, mA. Rough ESP8266 + MAX30105 + MLX90614
+// figures; only the ratios matter for comparing policies.
+static const float BOOT_MA = 70.0f;
+static const float MEASURE_MA = 75.0f; // Sensors on, radio in modem sleep
+static const float SEND_MA = 140.0f;   // Connect, TLS, publish
+static const float SLEEP_MA = 0.025f;
+static const uint32_t BOOT_MS = 1000;
+static const uint32_t SEND_MS = 2500;
+static const uint32_t SEND_FAIL_MS = 20000; // SendState gives up on the network
+static const float BATTERY_MAH = 1000.0f;
+
+static const uint32_t SIM_HOURS = 48;
+static const float FEVER_START_H = 20, FEVER_PEAK_H = 26, FEVER_END_H = 34;
+static const float AGITATED_START_H = 8, AGITATED_END_H = 10;
+static const float OUTAGE_START_H = 14, OUTAGE_END_H = 16;
+
+static float noise(float amplitude)
+{
+    return amplitude * ((float)(rand() % 2001) / 1000.0f - 1.0f);
+}
+
+static float bodyTemperature(float hours)
+{
+    float base = 38.5f + 0.1f * sinf(hours * 0.26f);
+    if (hours < FEVER_START_H || hours > FEVER_END_H)
+        return base;
+    if (hours < FEVER_PEAK_H)
+        return base + 2.0f * (hours - FEVER_START_H) / (FEVER_PEAK_H - FEVER_START_H);
+    if (hours < FEVER_END_H - 4)
+        return base + 2.0f;
+    return base + 2.0f * (FEVER_END_H - hours) / 4.0f;
+}
+
+struct PolicyResult
+{
+    uint32_t wakes;
+    uint32_t readings; // Windows that reached the hub
+    float mAh;
+    float feverLatencyMin; // From crossing DUTY_FEVER_C to the hub seeing it
+    float endBatteryPercent;
+    uint32_t shortestWindowMs;
+    uint32_t longestWindowMs;
+    uint32_t feverWindowMs; // Window length of the wake that first saw the fever
+};
+
+// When the animal actually crosses DUTY_FEVER_C, s
+static double feverOnset()
+{
+    for (uint32_t s = 0; s < SIM_HOURS * 3600; s += 10)
+    {
+        if (bodyTemperature(s / 3600.0f) >= DUTY_FEVER_C)
+            return s;
+    }
+    return -1;
+}
+
+// fixedSleepS = 0 runs the adaptive policy
+static PolicyResult simulate(uint32_t fixedSleepS, float startBatteryPercent)
+{
+    double feverAt = feverOnset();
+    srand(3);
+    FakeStorage rtc(512);
+    DutyCycle policy(rtc, DUTY_CYCLE_RTC_OFFSET);
+    policy.restore();
+
+    PolicyResult result = {0, 0, 0, -1, 0, UINT32_MAX, 0, 0};
+    float usedMah = 0;
+    uint32_t backlog = 0;
+    double t = 0; // s
+
+    while (t < SIM_HOURS * 3600.0)
+    {
+        result.wakes++;
+        uint32_t windowMs = fixedSleepS ? TELEMETRY_WINDOW_MS : policy.windowMs();
+        uint8_t windows = fixedSleepS ? TELEMETRY_BATCH_SIZE : policy.windowsPerBatch();
+        if (windowMs < result.shortestWindowMs)
+            result.shortestWindowMs = windowMs;
+        if (windowMs > result.longestWindowMs)
+            result.longestWindowMs = windowMs;
+
+        // Measure
+        TelemetryBatch batch;
+        batch.windowMs = windowMs;
+        float temperatureSum = 0;
+        float hottest = 0;
+        for (uint8_t w = 0; w < windows; w++)
+        {
+            float hours = (float)((t + (BOOT_MS + w * windowMs) / 1000.0) / 3600.0);
+            bool agitated = hours >= AGITATED_START_H && hours < AGITATED_END_H;
+            RunningStats bpm(true), temp, spo2(true);
+            float bpmMean = 68.0f + noise(agitated ? 12.0f : 2.0f);
+            float temperature = bodyTemperature(hours) + noise(0.05f);
+            for (int s = 0; s < 40; s++)
+            {
+                bpm.add(bpmMean + noise(3.0f));
+                temp.add(temperature + noise(0.05f));
+                spo2.add(97.0f + noise(1.0f));
+            }
+            batch.add(w * windowMs, bpm, temp, spo2);
+            temperatureSum += temp.mean();
+            if (temp.mean() > hottest)
+                hottest = temp.mean();
+        }
+
+        // Send; during the outage the batch waits in the log
+        float hours = (float)(t / 3600.0);
+        bool linkUp = hours < OUTAGE_START_H || hours >= OUTAGE_END_H;
+        if (!result.feverWindowMs && feverAt >= 0 && t >= feverAt)
+            result.feverWindowMs = windowMs;
+        uint32_t sendMs = linkUp ? SEND_MS : SEND_FAIL_MS;
+        backlog += windows;
+        if (linkUp)
+        {
+            result.readings += backlog;
+            backlog = 0;
+            if (result.feverLatencyMin < 0 && feverAt >= 0 && hottest >= DUTY_FEVER_C)
+                result.feverLatencyMin = (float)((t + (BOOT_MS + windows * windowMs + sendMs) / 1000.0 - feverAt) / 60);
+        }
+
+        uint32_t awakeMs = BOOT_MS + windows * windowMs + sendMs;
+        usedMah += (BOOT_MA * BOOT_MS + MEASURE_MA * windows * windowMs + SEND_MA * sendMs) / 3600000.0f;
+
+        float battery = startBatteryPercent - usedMah / BATTERY_MAH * 100.0f;
+        uint32_t sleepS = fixedSleepS;
+        if (!fixedSleepS)
+        {
+            DutyInputs inputs = {(int8_t)(battery > 0 ? battery : 0), (int8_t)(linkUp ? -67 : 0), linkUp};
+            sleepS = policy.decide(batch, temperatureSum / windows, inputs, awakeMs).sleepS;
+        }
+        usedMah += SLEEP_MA * sleepS / 3600.0f;
+        t += awakeMs / 1000.0 + sleepS;
+    }
+
+    result.mAh = usedMah;
+    result.endBatteryPercent = startBatteryPercent - usedMah / BATTERY_MAH * 100.0f;
+    return result;
+}
+
+// setSleepInterval bounds past what the RTC timer can sleep are trimmed,
+// and so is the policy's own longest sleep
+static bool checkSleepLimit()
+{
+    FakeClock clock;
+    clock.sleepLimitUs = 1800ULL * 1000000ULL;
+    FakeStorage rtc(512);
+    DutyCycle policy(rtc, DUTY_CYCLE_RTC_OFFSET, clock);
+    policy.restore();
+
+    bool ok = policy.maxSleepS() == 1800 && !policy.setBounds(0, 65535) && policy.boundMax() == 1800;
+    ok = ok && !policy.setBounds(40000, 50000) && policy.boundMin() == 1800 && policy.boundMax() == 1800;
+    ok = ok && policy.setBounds(60, 600) && policy.boundMin() == 60 && policy.boundMax() == 600;
+    policy.setBounds(0, 0);
+
+    // Critical battery asks for DUTY_MAX_SLEEP_S and gets the RTC limit
+    TelemetryBatch batch;
+    batch.clear();
+    DutyInputs inputs = {5, -60, true};
+    ok = ok && policy.decide(batch, 38.5f, inputs, 60000).sleepS == 1800;
+
+    clock.sleepLimitUs = FAKE_DEEP_SLEEP_MAX_US;
+    ok = ok && policy.maxSleepS() == DUTY_MAX_SLEEP_S;
+
+    printf("sleep limit: bounds and policy trimmed to a 1800 s RTC limit: %s\n\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Battery percentages as DeviceState derives them from A0: a healthy cell
+// leaves the policy alone, a nearly flat one is critical
+static bool checkBatteryReading()
+{
+    struct Case
+    {
+        int adc;
+        const char *cell;
+        bool batteryReason;
+    };
+    // Cell voltage / 3.2 on the pin, 1023 at 3.3 V
+    const Case cases[] = {{403, "4.16 V full", false}, {372, "3.84 V", false}, {300, "3.10 V", true}};
+
+    bool ok = true;
+    for (const Case &c : cases)
+    {
+        FakeStorage rtc(512);
+        DutyCycle policy(rtc, DUTY_CYCLE_RTC_OFFSET);
+        policy.restore();
+        TelemetryBatch batch;
+        batch.clear();
+        uint16_t millivolts = batteryMillivolts(c.adc);
+        DutyInputs inputs = {batteryPercent(millivolts), -60, true};
+        const char *reason = policy.decide(batch, 38.5f, inputs, 60000).reason;
+        bool batteryReason = strncmp(reason, "battery", 7) == 0;
+        printf("battery: ADC %d (%s) -> %u mV, %d%%, %s\n", c.adc, c.cell, (unsigned)millivolts, inputs.batteryPercent,
+               reason);
+        ok = ok && batteryReason == c.batteryReason;
+    }
+    printf("battery readings drive the policy only when low: %s\n\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void print(const char *name, const PolicyResult &r)
+{
+    printf("%-16s %6lu %9lu %9.1f %10.1f %9.1f %9.1f%%\n", name, (unsigned long)r.wakes, (unsigned long)r.readings,
+           r.mAh, r.readings ? r.mAh * 1000.0f / r.readings : 0.0f, r.feverLatencyMin, r.endBatteryPercent);
+}
+
+// Energy per reported reading and fever latency of fixed sleeps vs the
+// adaptive policy over two simulated days (agitation, link outage, fever)
+int runDutySimulation(int argc, char **argv)
+{
+    float battery = argc > 1 ? (float)atof(argv[1]) : 90.0f;
+    bool checked = checkSleepLimit();
+    checked = checkBatteryReading() && checked;
+
+    printf("%lu h, %.0f%% of %.0f mAh at start; agitated %.0f-%.0f h, no link %.0f-%.0f h, fever %.0f-%.0f h\n",
+           (unsigned long)SIM_HOURS, battery, BATTERY_MAH, AGITATED_START_H, AGITATED_END_H, OUTAGE_START_H,
+           OUTAGE_END_H, FEVER_START_H, FEVER_END_H);
+    printf("%-16s %6s %9s %9s %10s %9s %10s\n", "policy", "wakes", "readings", "mAh", "uAh/read", "fever min",
+           "battery");
+    print("fixed 10 s", simulate(10, battery));
+    print("fixed 300 s", simulate(300, battery));
+    print("fixed 1800 s", simulate(1800, battery));
+    PolicyResult adaptive = simulate(0, battery);
+    print("adaptive", adaptive);
+    printf("adaptive windows: %.1f-%.1f s, %.1f s once feverish\n", adaptive.shortestWindowMs / 1000.0,
+           adaptive.longestWindowMs / 1000.0, adaptive.feverWindowMs / 1000.0);
+
+    // The adaptive policy has to see the fever within a base period, and
+    // measure it in short windows while stable stretches use long ones
+    bool ok = checked && adaptive.feverLatencyMin >= 0 && adaptive.feverLatencyMin <= DUTY_BASE_SLEEP_S / 60.0f + 2;
+    ok = ok && adaptive.feverWindowMs == DUTY_SHORT_WINDOW_MS && adaptive.longestWindowMs == DUTY_LONG_WINDOW_MS;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+// Host entry point for the native env. Runs firmware logic against the fake
+// HAL so it can be profiled and exercised without a board.
+#include <stdio.h>
+#include <string.h>
+
+#include "native_app.h"
+
+struct NativeMode
+{
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *help;
+};
+
+static const NativeMode modes[] = {
+    {"cycle", runWakeCycle, "simulate one wake through JobState and the send state machine"},
+    {"acquire", runAcquisition, "[seconds] compare MAX30105 polling and FIFO burst reads"},
+    {"ring", runSampleRing, "sample ring overflow accounting, counter wrap, drain and clear"},
+    {"dsp", runDspBenchmark, "[bpm] cycles per sample of the fixed-point PPG chain vs float"},
+    {"spo2", runSpo2Benchmark, "[trace.csv] SpO2 estimate and cost on a red,ir trace"},
+    {"codec", runCodecRoundTrip, "CBOR telemetry size vs JSON and decode round trip"},
+    {"publish", runPublishAllocations, "[count] heap allocations and stack per telemetry publish"},
+    {"sas", runSasVectors, "SAS token generator against generate_token.py vectors"},
+    {"wake", runWakeState, "cold vs warm wake timings through the RTC state block"},
+    {"wifi", runWifiJoin, "directed vs scan Wi-Fi join phases on the fake radio"},
+    {"time", runTimeSync, "background SNTP with back-filled and monotonic timestamps"},
+    {"duty", runDutySimulation, "[battery %] energy per reading of fixed vs adaptive sleep"},
+    {"sched", runScheduler, "deadline scheduler ordering, overruns and task load"},
+    {"retry", runRetryQueue, "[operations] retry queue priority, eviction and backoff stress"},
+    {"perf", runStageProfile, "[reads] stage latency histograms from fake joins and sensor reads"},
+    {"memory", runMemory, "[calls] heap watermarks across wakes and allocations per code path"},
+    {"config", runConfigStore, "double-buffered config slots, torn writes and legacy JSON migration"},
+    {"trace", runTrace, "binary trace ring, dump format and cost against printf"},
+    {"log", runTelemetryLog, "[batches] store-and-forward log: recovery, append and drain rates"},
+    {"mqtt", runMqttQos, "[host [port [count]]] QoS 1 PUBACK tracking and in-flight window"},
+};
+
+static void printUsage(const char *program)
+{
+    printf("usage: %s <mode> [args]\n", program);
+    for (const NativeMode &mode : modes)
+    {
+        printf("  %-10s %s\n", mode.name, mode.help);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : "cycle";
+    for (const NativeMode &mode : modes)
+    {
+        if (strcmp(mode.name, name) == 0)
+            return mode.run(argc - 1, argv + 1);
+    }
+
+    printUsage(argv[0]);
+    return 2;
+}
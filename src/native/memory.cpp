@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "native_app.h"
+#include "alloc_probe.h"
+#include "../hal/native/fake_hal.h"
+#include "../state/memory/memory_monitor.h"
+#include "../data/auth/sas_token.h"
+#include "../data/codec/telemetry_codec.h"
+#include "../data/mqtt/mqtt_client.h"
+#include "../data/mqtt/inflight_window.h"
+#include "../data/mqtt/retry_queue.h"
+#include "../data/telemetry_log.h"
+#include "../utils/trace.h"
+
+// Watermarks fold over checkpoints and survive a "deep sleep" in RTC
+static bool checkWatermarks()
+{
+    FakeMemoryInfo memory;
+    FakeStorage rtc(512);
+
+    // Wake 1: the TLS connect is the tight spot
+    MemoryMonitor first(memory, rtc, MEMORY_MONITOR_RTC_OFFSET);
+    bool ok = !first.restore();
+    memory.next = {21000, 9000, 38, 1800};
+    first.checkpoint(MEM_TLS_CONNECT);
+    memory.next = {30000, 24000, 12, 2600};
+    first.checkpoint(MEM_PUBLISH);
+    first.save();
+
+    // Wake 2: a better TLS connect, a worse publish
+    MemoryMonitor second(memory, rtc, MEMORY_MONITOR_RTC_OFFSET);
+    ok = ok && second.restore() && second.wakes() == 1;
+    memory.next = {26000, 15000, 20, 2000};
+    second.checkpoint(MEM_TLS_CONNECT);
+    memory.next = {28000, 20000, 25, 2400};
+    second.checkpoint(MEM_PUBLISH);
+
+    const MemoryWatermark &tls = second.worst(MEM_TLS_CONNECT);
+    const MemoryWatermark &publish = second.worst(MEM_PUBLISH);
+    ok = ok && tls.freeHeap == 21000 && tls.maxFreeBlock == 9000 && tls.fragmentation == 38 && tls.freeStack == 1800;
+    ok = ok && publish.freeHeap == 28000 && publish.fragmentation == 25 && second.thisWake(MEM_TLS_CONNECT).freeHeap == 26000;
+    ok = ok && !second.worst(MEM_TOKEN).seen;
+
+    char json[128];
+    size_t length = second.formatJson(json, sizeof(json), true);
+    ok = ok && length > 0 && strcmp(json, "{\"tls\":[21000,9000,38,1800],\"publish\":[28000,20000,25,2400]}") == 0;
+    second.save();
+
+    // A torn RTC block reads as a cold boot
+    uint8_t garbage = 0x5A;
+    rtc.write(MEMORY_MONITOR_RTC_OFFSET + 12, &garbage, 1);
+    MemoryMonitor third(memory, rtc, MEMORY_MONITOR_RTC_OFFSET);
+    ok = ok && !third.restore() && third.wakes() == 0;
+
+    printf("watermarks across wakes: %s (%s)\n", ok ? "ok" : "FAIL", json);
+    return ok;
+}
+
+// One code path under AllocScope and measureStackUse
+struct PathResult
+{
+    const char *name;
+    int calls;
+    AllocCounts allocations;
+    size_t stack;
+};
+
+struct Paths
+{
+    FakeNetworkClient network;
+    MqttClient mqtt{network, fakeClock()};
+    InflightWindow inflight{mqtt, fakeClock()};
+    RetryQueue retry{fakeClock()};
+    TelemetryLog log{fakeFiles()};
+    TelemetryBatch batch;
+    uint8_t payload[TELEMETRY_PAYLOAD_CAPACITY];
+    uint32_t epoch = 1760000000;
+};
+
+static void tlsConnect(void *context)
+{
+    Paths *p = (Paths *)context;
+    p->mqtt.disconnect();
+    const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+    p->network.inject(connack, sizeof(connack));
+    p->mqtt.connect("1", "hub/1/?api-version=2021-04-12", "SharedAccessSignature sr=x&sig=y&se=1");
+    p->network.clearTx();
+}
+
+static void token(void *context)
+{
+    Paths *p = (Paths *)context;
+    char out[SasToken::MAX_LENGTH];
+    SasToken::generate(out, sizeof(out), "hub.azure-devices.net/devices/1", "c2VjcmV0a2V5MTIzNDU2Nzg5MGFi",
+                       p->epoch++ + 3600);
+}
+
+static void publish(void *context)
+{
+    Paths *p = (Paths *)context;
+    size_t length = TelemetryCodec::encodeBatchSelected(p->payload, sizeof(p->payload), "1", p->epoch++, p->batch);
+    p->inflight.publish("devices/1/messages/events/", p->payload, length, 1);
+
+    // PUBACK for what was just written: packet id after topic
+    const uint8_t *tx = p->network.txBuffer;
+    size_t used = 1;
+    while (tx[used] & 0x80)
+        used++;
+    used++;
+    size_t topicLength = ((size_t)tx[used] << 8) | tx[used + 1];
+    const uint8_t puback[] = {0x40, 0x02, tx[used + 2 + topicLength], tx[used + 3 + topicLength]};
+    p->network.inject(puback, sizeof(puback));
+    p->mqtt.loop();
+    p->network.clearTx();
+}
+
+static void logAppend(void *context)
+{
+    Paths *p = (Paths *)context;
+    p->log.appendBatch(p->batch, p->epoch++, 0);
+}
+
+static void retryPush(void *context)
+{
+    Paths *p = (Paths *)context;
+    p->retry.push("devices/1/messages/events/", p->payload, 64, RetryQueue::TELEMETRY);
+    RetryQueue::Entry *entry = p->retry.nextReady();
+    if (entry)
+        p->retry.remove(entry);
+}
+
+static void traceRecord(void *context)
+{
+    (void)context;
+    TRACE(MQTT_PUBLISH, 1u, 64u);
+}
+
+static void checkpoint(void *context)
+{
+    (void)context;
+    memoryMonitor.checkpoint(MEM_PUBLISH);
+}
+
+static PathResult measure(const char *name, void (*path)(void *), Paths &paths, int calls)
+{
+    path(&paths); // One-time lazy setup is not charged to the path
+    AllocScope scope;
+    for (int i = 0; i < calls; i++)
+        path(&paths);
+    AllocCounts counts = scope.delta();
+    return {name, calls, counts, measureStackUse(path, &paths)};
+}
+
+// Heap watermarks and heap traffic per code path on the host; the three
+// checkpointed paths come first
+int runMemory(int argc, char **argv)
+{
+    int calls = argc > 1 ? atoi(argv[1]) : 500;
+    bool ok = checkWatermarks();
+
+    static Paths paths;
+    fakeFiles().wipe();
+    paths.log.begin();
+    paths.inflight.begin();
+    paths.retry.begin(1);
+    paths.mqtt.setServer("localhost", 8883);
+    paths.batch.clear();
+    paths.batch.windowMs = TELEMETRY_WINDOW_MS;
+    RunningStats bpm(true), temp, spo2(true);
+    bpm.add(72.0f);
+    temp.add(36.8f);
+    spo2.add(97.0f);
+    for (uint8_t i = 0; i < TELEMETRY_BATCH_SIZE; i++)
+        paths.batch.add(i * paths.batch.windowMs, bpm, temp, spo2);
+
+    const PathResult results[] = {
+        measure("tls connect", tlsConnect, paths, calls), measure("token", token, paths, calls),
+        measure("publish", publish, paths, calls),        measure("log append", logAppend, paths, calls),
+        measure("retry push", retryPush, paths, calls),   measure("trace", traceRecord, paths, calls),
+        measure("checkpoint", checkpoint, paths, calls),
+    };
+
+    if (!AllocProbe::available())
+        printf("allocation counting unavailable on this libc\n");
+    printf("\n%-12s %8s %12s %12s %10s\n", "path", "calls", "allocs/call", "bytes/call", "stack");
+    for (const PathResult &r : results)
+    {
+        printf("%-12s %8d %12.2f %12.1f %9zuB\n", r.name, r.calls, (double)r.allocations.allocations / r.calls,
+               (double)r.allocations.bytesRequested / r.calls, r.stack);
+    }
+    printf("(token: mbedtls HMAC context; log append goes through stdio here, LittleFS allocates differently)\n");
+
+    // Connect and publish must not touch the heap. The token's two come
+    // from mbedtls_md_hmac setting up its context, once per token lifetime.
+    ok = ok && results[0].allocations.allocations == 0 && results[2].allocations.allocations == 0;
+    fakeFiles().wipe();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "native_app.h"
+#include "../hal/native/fake_hal.h"
+#include "../hal/native/posix_network_client.h"
+#include "../data/mqtt/mqtt_client.h"
+#include "../data/mqtt/inflight_window.h"
+
+static const char *TOPIC = "devices/1/messages/events/";
+
+// Remembers which tags were released, in order
+class DeliveryLog : public DeliveryListener
+{
+public:
+    uint32_t tags[64];
+    int count = 0;
+    uint32_t worstLatencyMs = 0;
+
+    void onDelivered(uint32_t tag, uint32_t latencyMs) override
+    {
+        if (count < 64)
+            tags[count] = tag;
+        count++;
+        if (latencyMs > worstLatencyMs)
+            worstLatencyMs = latencyMs;
+    }
+
+    bool has(uint32_t tag) const
+    {
+        for (int i = 0; i < count && i < 64; i++)
+            if (tags[i] == tag)
+                return true;
+        return false;
+    }
+};
+
+// Broker end of a FakeNetworkClient: picks PUBLISH packets out of what the
+// client wrote and answers each QoS 1 one with a PUBACK after rttMs
+class ScriptedBroker
+{
+private:
+    FakeNetworkClient &network;
+    Clock &clock;
+    size_t parsed = 0;
+    uint16_t dueIds[64];
+    uint32_t dueMs[64];
+    int due = 0;
+
+public:
+    uint32_t rttMs = 0;
+    bool autoAck = true;
+    int publishes = 0;
+    int dupPublishes = 0;
+    uint16_t lastIds[64];
+    int lastCount = 0;
+
+    ScriptedBroker(FakeNetworkClient &network, Clock &clock) : network(network), clock(clock) {}
+
+    void connack()
+    {
+        const uint8_t packet[] = {0x20, 0x02, 0x00, 0x00};
+        network.inject(packet, sizeof(packet));
+    }
+
+    void puback(uint16_t id)
+    {
+        const uint8_t packet[] = {0x40, 0x02, (uint8_t)(id >> 8), (uint8_t)id};
+        network.inject(packet, sizeof(packet));
+    }
+
+    void service()
+    {
+        while (parsed < network.txLength)
+        {
+            const uint8_t *p = network.txBuffer + parsed;
+            size_t available = network.txLength - parsed;
+            size_t length = 0, used = 1;
+            uint32_t multiplier = 1;
+            while (used < available)
+            {
+                uint8_t digit = p[used++];
+                length += (digit & 0x7F) * multiplier;
+                multiplier *= 128;
+                if (!(digit & 0x80))
+                    break;
+            }
+            if (used + length > available)
+                break; // Partial packet, wait for the rest
+
+            if ((p[0] & 0xF0) == 0x30 && ((p[0] >> 1) & 0x03) == 1)
+            {
+                size_t topicLength = ((size_t)p[used] << 8) | p[used + 1];
+                uint16_t id = (uint16_t)((p[used + 2 + topicLength] << 8) | p[used + 3 + topicLength]);
+                publishes++;
+                if (p[0] & 0x08)
+                    dupPublishes++;
+                if (lastCount < 64)
+                    lastIds[lastCount++] = id;
+                if (autoAck && due < 64)
+                {
+                    dueIds[due] = id;
+                    dueMs[due++] = clock.millis() + rttMs;
+                }
+            }
+            parsed += used + length;
+        }
+        if (parsed == network.txLength)
+        {
+            network.clearTx();
+            parsed = 0;
+        }
+
+        int kept = 0;
+        for (int i = 0; i < due; i++)
+        {
+            if ((int32_t)(clock.millis() - dueMs[i]) >= 0)
+                puback(dueIds[i]);
+            else
+            {
+                dueIds[kept] = dueIds[i];
+                dueMs[kept++] = dueMs[i];
+            }
+        }
+        due = kept;
+    }
+};
+
+static_assert(MQTT_INFLIGHT_WINDOW >= 3, "The ack tracking check acks the third message");
+
+// Publish order of the messages left unacked once 0 and 2 are acked
+static uint32_t unackedIndex(uint32_t n)
+{
+    return n == 0 ? 1 : n + 2;
+}
+
+// PUBACK matching, window limit, timeout resend and reconnect resend
+static bool checkAckTracking()
+{
+    FakeClock &clock = fakeClock();
+    FakeNetworkClient network;
+    ScriptedBroker broker(network, clock);
+    broker.autoAck = false;
+
+    MqttClient mqtt(network, clock);
+    InflightWindow window(mqtt, clock);
+    DeliveryLog log;
+    window.begin(&log);
+    mqtt.setServer("broker", 1883);
+
+    broker.connack();
+    bool ok = mqtt.connect("1", "user", "pass") && network.txBuffer[0] == 0x10;
+    network.clearTx();
+
+    uint8_t payload[32];
+    for (uint32_t i = 0; i < MQTT_INFLIGHT_WINDOW; i++)
+    {
+        memset(payload, (int)i, sizeof(payload));
+        ok = ok && window.publish(TOPIC, payload, sizeof(payload), 100 + i);
+    }
+    bool fullRejected = !window.publish(TOPIC, payload, sizeof(payload), 999);
+    broker.service();
+    ok = ok && fullRejected && broker.publishes == MQTT_INFLIGHT_WINDOW;
+
+    // Out of order acks release exactly their own messages; 1 and 3.. stay
+    broker.puback(broker.lastIds[2]);
+    broker.puback(broker.lastIds[0]);
+    mqtt.loop();
+    const uint32_t unacked = MQTT_INFLIGHT_WINDOW - 2;
+    ok = ok && log.count == 2 && log.tags[0] == 102 && log.tags[1] == 100 && window.pending() == unacked;
+    printf("out-of-order PUBACKs: %s\n", ok ? "ok" : "MISMATCH");
+
+    // No ack in time: resent with DUP and the same packet id
+    clock.advance(MQTT_ACK_TIMEOUT_MS);
+    window.poll();
+    broker.service();
+    bool timedOut = broker.dupPublishes == (int)unacked;
+    for (uint32_t n = 0; n < unacked; n++)
+        timedOut = timedOut && broker.lastIds[MQTT_INFLIGHT_WINDOW + n] == broker.lastIds[unackedIndex(n)];
+    printf("timeout resend: %s\n", timedOut ? "ok" : "MISMATCH");
+
+    // Link drops: nothing is released, and everything goes again after the reconnect
+    network.stop();
+    bool heldWhileDown = !mqtt.connected() && window.pending() == unacked && log.count == 2;
+    broker.connack();
+    mqtt.connect("1", "user", "pass");
+    window.resendAll();
+    broker.service();
+    bool resent = heldWhileDown && broker.dupPublishes == (int)(2 * unacked);
+    for (uint32_t n = 0; n < unacked; n++)
+        broker.puback(broker.lastIds[unackedIndex(n)]);
+    broker.puback(broker.lastIds[1]); // Second ack for the DUP
+    mqtt.loop();
+    resent = resent && window.empty() && log.count == (int)MQTT_INFLIGHT_WINDOW && window.unknownAcks == 1;
+    for (uint32_t n = 0; n < unacked; n++)
+        resent = resent && log.has(100 + unackedIndex(n));
+    printf("reconnect resend: %s\n", resent ? "ok" : "MISMATCH");
+
+    return ok && timedOut && resent;
+}
+
+// Simulated time to get count messages acked with rttMs between PUBLISH and
+// PUBACK, windowed or one at a time
+static uint32_t simulateBacklog(int count, uint32_t rttMs, bool stopAndWait)
+{
+    FakeClock &clock = fakeClock();
+    FakeNetworkClient network;
+    ScriptedBroker broker(network, clock);
+    broker.rttMs = rttMs;
+
+    MqttClient mqtt(network, clock);
+    InflightWindow window(mqtt, clock);
+    window.begin();
+    mqtt.setServer("broker", 1883);
+    broker.connack();
+    mqtt.connect("1");
+    network.clearTx();
+
+    uint8_t payload[256] = {};
+    uint32_t started = clock.millis();
+    int queued = 0;
+    while ((int)window.delivered < count)
+    {
+        bool room = stopAndWait ? window.empty() : !window.full();
+        if (queued < count && room && window.publish(TOPIC, payload, sizeof(payload), (uint32_t)queued))
+            queued++;
+
+        broker.service();
+        mqtt.loop();
+        window.poll();
+        clock.advance(1);
+    }
+    return clock.millis() - started;
+}
+
+// Against a real broker: count QoS 1 publishes through the window
+static int runBroker(const char *host, uint16_t port, int count)
+{
+    FakeClock &clock = fakeClock();
+    clock.setRealTime(true);
+
+    PosixNetworkClient network;
+    MqttClient mqtt(network, clock);
+    InflightWindow window(mqtt, clock);
+    DeliveryLog log;
+    window.begin(&log);
+    mqtt.setServer(host, port);
+    mqtt.setKeepAlive(30);
+
+    if (!mqtt.connect("petsa-qos-test"))
+    {
+        printf("connect to %s:%u failed, state %d\n", host, (unsigned)port, mqtt.state());
+        return 1;
+    }
+
+    uint8_t payload[256];
+    memset(payload, 'x', sizeof(payload));
+    int results = 0;
+    for (int mode = 0; mode < 2; mode++)
+    {
+        bool stopAndWait = mode == 1;
+        uint32_t before = window.delivered;
+        uint32_t started = clock.millis();
+        int queued = 0;
+        while ((int)(window.delivered - before) < count && clock.millis() - started < 30000)
+        {
+            bool room = stopAndWait ? window.empty() : !window.full();
+            if (queued < count && room && window.publish("petsa/qos-test", payload, sizeof(payload), queued))
+                queued++;
+            if (!mqtt.loop())
+                break;
+            window.poll();
+        }
+        uint32_t elapsed = clock.millis() - started;
+        int acked = (int)(window.delivered - before);
+        printf("%-14s %d/%d acked in %lu ms (worst latency %lu ms)\n", stopAndWait ? "stop-and-wait" : "windowed",
+               acked, count, (unsigned long)elapsed, (unsigned long)log.worstLatencyMs);
+        if (acked == count)
+            results++;
+    }
+
+    mqtt.disconnect();
+    return results == 2 ? 0 : 1;
+}
+
+// QoS 1 publish layer: PUBACK tracking on a scripted broker, windowed vs
+// stop-and-wait draining of a backlog, or a real broker given host [port].
+int runMqttQos(int argc, char **argv)
+{
+    if (argc > 1)
+        return runBroker(argv[1], argc > 2 ? (uint16_t)atoi(argv[2]) : 1883, argc > 3 ? atoi(argv[3]) : 100);
+
+    bool ok = checkAckTracking();
+
+    const int backlog = 30;
+    const uint32_t rttMs = 150;
+    uint32_t serial = simulateBacklog(backlog, rttMs, true);
+    uint32_t windowed = simulateBacklog(backlog, rttMs, false);
+    printf("backlog of %d at %lu ms RTT: stop-and-wait %lu ms, window of %d %lu ms\n", backlog,
+           (unsigned long)rttMs, (unsigned long)serial, MQTT_INFLIGHT_WINDOW, (unsigned long)windowed);
+
+    return ok && windowed < serial ? 0 : 1;
+}
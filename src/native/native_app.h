@@ -0,0 +1,23 @@
+#pragma once
+
+// Host harness entry points, one per command line mode
+int runWakeCycle(int argc, char **argv);
+int runAcquisition(int argc, char **argv);
+int runSampleRing(int argc, char **argv);
+int runDspBenchmark(int argc, char **argv);
+int runSpo2Benchmark(int argc, char **argv);
+int runCodecRoundTrip(int argc, char **argv);
+int runPublishAllocations(int argc, char **argv);
+int runSasVectors(int argc, char **argv);
+int runWakeState(int argc, char **argv);
+int runWifiJoin(int argc, char **argv);
+int runTimeSync(int argc, char **argv);
+int runMqttQos(int argc, char **argv);
+int runTelemetryLog(int argc, char **argv);
+int runRetryQueue(int argc, char **argv);
+int runScheduler(int argc, char **argv);
+int runDutySimulation(int argc, char **argv);
+int runTrace(int argc, char **argv);
+int runStageProfile(int argc, char **argv);
+int runMemory(int argc, char **argv);
+int runConfigStore(int argc, char **argv);
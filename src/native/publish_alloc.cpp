@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "native_app.h"
+#include "alloc_probe.h"
+#include "../hal/native/fake_hal.h"
+#include "../data/codec/telemetry_codec.h"
+#include "../data/mqtt/mqtt_client.h"
+#include "../data/mqtt/inflight_window.h"
+
+// Mirrors RemoteDataSource::publishTelemetry(): topic built once, payload
+// encoded into a member buffer, then published at QoS 1 through the
+// in-flight window. The loopback "broker" acks each message, so the slot
+// release on PUBACK is part of what is measured.
+class HostPublisher
+{
+private:
+    FakeNetworkClient &network;
+    MqttClient mqtt;
+    InflightWindow inflight;
+    char topic[96] = "";
+    uint8_t payload[TELEMETRY_PAYLOAD_CAPACITY];
+
+    // Packet id of the PUBLISH the client just wrote
+    uint16_t writtenPacketId() const
+    {
+        const uint8_t *p = network.txBuffer;
+        size_t used = 1;
+        while (p[used] & 0x80)
+            used++;
+        used++;
+        size_t topicLength = ((size_t)p[used] << 8) | p[used + 1];
+        return (uint16_t)((p[used + 2 + topicLength] << 8) | p[used + 3 + topicLength]);
+    }
+
+public:
+    explicit HostPublisher(FakeNetworkClient &client)
+        : network(client), mqtt(client, fakeClock()), inflight(mqtt, fakeClock())
+    {
+    }
+
+    bool begin(const char *deviceId)
+    {
+        snprintf(topic, sizeof(topic), "devices/%s/messages/events/%s", deviceId,
+                 TELEMETRY_CODEC == TELEMETRY_CODEC_CBOR ? TELEMETRY_CBOR_TOPIC_PROPERTIES : "");
+
+        inflight.begin();
+        mqtt.setServer("localhost", 8883);
+        const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+        network.inject(connack, sizeof(connack));
+        bool connected = mqtt.connect(deviceId);
+        network.clearTx();
+        return connected;
+    }
+
+    bool publish(size_t length)
+    {
+        network.clearTx();
+        if (length == 0 || !inflight.publish(topic, payload, length))
+            return false;
+
+        uint16_t id = writtenPacketId();
+        const uint8_t puback[] = {0x40, 0x02, (uint8_t)(id >> 8), (uint8_t)id};
+        network.inject(puback, sizeof(puback));
+        mqtt.loop();
+        return inflight.empty();
+    }
+
+    bool publishReading(uint32_t epoch, float pulseRate, float temperature, float spO2)
+    {
+        return publish(TelemetryCodec::encodeReadingSelected(payload, sizeof(payload), "1", epoch, pulseRate,
+                                                             temperature, spO2));
+    }
+
+    bool publishBatch(uint32_t epoch, const TelemetryBatch &batch)
+    {
+        return publish(TelemetryCodec::encodeBatchSelected(payload, sizeof(payload), "1", epoch, batch));
+    }
+};
+
+// The pre-writer shape of the send path: topic and timestamp concatenated
+// into strings on every publish (std::string standing in for Arduino String)
+static size_t legacyPublish(NetworkClient &network, const std::string &deviceId, float pulseRate)
+{
+    std::string topic = "devices/" + deviceId + "/messages/events/";
+    std::string timestamp = std::string("2025-10-09T08:53:20Z") + "";
+    std::string payload = "{\"deviceId\":\"" + deviceId + "\",\"pulseRate\":" + std::to_string(pulseRate) +
+                          ",\"timestamp\":\"" + timestamp + "\"}";
+    network.write((const uint8_t *)topic.data(), topic.size());
+    return network.write((const uint8_t *)payload.data(), payload.size());
+}
+
+struct PublishContext
+{
+    HostPublisher *publisher;
+    TelemetryBatch *batch;
+};
+
+static void publishOnce(void *context)
+{
+    PublishContext *c = (PublishContext *)context;
+    c->publisher->publishBatch(1760000000, *c->batch);
+}
+
+// Counts heap allocations made by the telemetry send path per publish.
+int runPublishAllocations(int argc, char **argv)
+{
+    const int publishes = argc > 1 ? atoi(argv[1]) : 1000;
+
+    FakeNetworkClient network;
+
+    TelemetryBatch batch;
+    batch.clear();
+    batch.baseMs = 0;
+    batch.windowMs = TELEMETRY_WINDOW_MS;
+    RunningStats bpm(true), temp, spo2(true);
+    bpm.add(72.0f);
+    temp.add(36.8f);
+    spo2.add(97.0f);
+    for (uint8_t i = 0; i < TELEMETRY_BATCH_SIZE; i++)
+        batch.add(i * batch.windowMs, bpm, temp, spo2);
+
+    HostPublisher publisher(network);
+    if (!publisher.begin("1"))
+    {
+        printf("MQTT connect on the loopback client failed\n");
+        return 1;
+    }
+
+    // Warm up so one-time lazy initialisation is not charged to the loop
+    publisher.publishReading(1760000000, 72.0f, 36.8f, 97.0f);
+    network.clearTx();
+
+    int failures = 0;
+    AllocScope scope;
+    for (int i = 0; i < publishes; i++)
+    {
+        bool ok = (i & 1) ? publisher.publishBatch(1760000000 + i, batch)
+                          : publisher.publishReading(1760000000 + i, 70.0f + i % 10, 36.8f, 97.0f);
+        if (!ok)
+            failures++;
+        network.clearTx();
+    }
+    AllocCounts counts = scope.delta();
+
+    AllocScope legacyScope;
+    for (int i = 0; i < publishes; i++)
+    {
+        legacyPublish(network, "1", 70.0f + i % 10);
+        network.clearTx();
+    }
+    AllocCounts legacy = legacyScope.delta();
+
+    PublishContext context = {&publisher, &batch};
+    size_t stack = measureStackUse(publishOnce, &context);
+    network.clearTx();
+
+    if (!AllocProbe::available())
+        printf("allocation counting unavailable on this libc\n");
+
+    printf("%d publishes (%s), %d failed\n", publishes,
+           TELEMETRY_CODEC == TELEMETRY_CODEC_CBOR ? "CBOR" : "JSON", failures);
+    printf("payload writer: %u allocations, %zu bytes (%.2f per publish)\n", counts.allocations,
+           counts.bytesRequested, (double)counts.allocations / publishes);
+    printf("string concat:  %u allocations, %zu bytes (%.2f per publish)\n", legacy.allocations,
+           legacy.bytesRequested, (double)legacy.allocations / publishes);
+    printf("stack per batch publish: ~%zu bytes\n", stack);
+
+    return counts.allocations == 0 && failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "native_app.h"
+#include "alloc_probe.h"
+#include "../hal/native/fake_hal.h"
+#include "../data/mqtt/retry_queue.h"
+
+static const char *TELEMETRY_TOPIC = "devices/1/messages/events/";
+static const char *RESPONSE_TOPIC = "$iothub/methods/res/200/?$rid=1";
+
+static bool push(RetryQueue &queue, RetryQueue::Priority priority, uint32_t tag, uint32_t ttlMs = 0)
+{
+    // Payload carries the tag so a mixed-up slot shows up on the way out
+    uint8_t payload[32];
+    memset(payload, (uint8_t)tag, sizeof(payload));
+    memcpy(payload, &tag, sizeof(tag));
+    size_t length = 8 + tag % 24;
+    return queue.push(priority == RetryQueue::RESPONSE ? RESPONSE_TOPIC : TELEMETRY_TOPIC, payload, length, priority,
+                      tag, ttlMs);
+}
+
+static bool intact(const RetryQueue::Entry &entry)
+{
+    uint32_t tag;
+    memcpy(&tag, entry.payload, sizeof(tag));
+    const char *topic = entry.priority == RetryQueue::RESPONSE ? RESPONSE_TOPIC : TELEMETRY_TOPIC;
+    return tag == entry.tag && entry.length == 8 + tag % 24 && strcmp(entry.topic, topic) == 0;
+}
+
+// Pops everything that is ready, recording tags in order
+static int drainTags(RetryQueue &queue, uint32_t *tags, int max)
+{
+    int count = 0;
+    while (RetryQueue::Entry *entry = queue.nextReady())
+    {
+        if (count < max)
+            tags[count] = entry->tag;
+        count++;
+        queue.remove(entry);
+    }
+    return count;
+}
+
+static bool checkOrdering(FakeClock &clock)
+{
+    RetryQueue queue(clock);
+    queue.begin(1);
+    push(queue, RetryQueue::TELEMETRY, 1);
+    push(queue, RetryQueue::TELEMETRY, 2);
+    push(queue, RetryQueue::RESPONSE, 10);
+    push(queue, RetryQueue::TELEMETRY, 3);
+    push(queue, RetryQueue::RESPONSE, 11);
+
+    uint32_t tags[8];
+    int count = drainTags(queue, tags, 8);
+    const uint32_t expected[] = {10, 11, 1, 2, 3};
+    bool ok = count == 5 && memcmp(tags, expected, sizeof(expected)) == 0;
+    printf("responses first, then FIFO: %s\n", ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static bool checkEviction(FakeClock &clock)
+{
+    RetryQueue queue(clock);
+    queue.begin(1);
+    for (uint32_t tag = 1; tag <= RETRY_QUEUE_SLOTS; tag++)
+        push(queue, RetryQueue::TELEMETRY, tag);
+
+    // Telemetry over a full queue pushes out the oldest telemetry
+    bool ok = push(queue, RetryQueue::TELEMETRY, 100) && queue.evicted == 1;
+    // A response does too
+    ok = ok && push(queue, RetryQueue::RESPONSE, 200) && queue.evicted == 2;
+
+    uint32_t tags[8];
+    int count = drainTags(queue, tags, 8);
+    ok = ok && count == RETRY_QUEUE_SLOTS && tags[0] == 200 && tags[1] == 3 && tags[count - 1] == 100;
+
+    // Full of responses: telemetry is refused, never a response evicted
+    for (uint32_t tag = 1; tag <= RETRY_QUEUE_SLOTS; tag++)
+        push(queue, RetryQueue::RESPONSE, 300 + tag);
+    ok = ok && !push(queue, RetryQueue::TELEMETRY, 400) && queue.rejected == 1;
+    ok = ok && push(queue, RetryQueue::RESPONSE, 500) && queue.nextReady()->tag == 302;
+
+    // Too large for an entry: refused even where a response could evict
+    static uint8_t batch[RETRY_QUEUE_PAYLOAD + 1];
+    ok = ok && !queue.push(RESPONSE_TOPIC, batch, sizeof(batch), RetryQueue::RESPONSE) && queue.rejected == 2;
+
+    printf("eviction keeps the newest, responses before telemetry: %s\n", ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+static bool checkBackoff(FakeClock &clock)
+{
+    RetryQueue queue(clock);
+    queue.begin(7);
+    push(queue, RetryQueue::TELEMETRY, 1);
+
+    bool ok = true;
+    printf("backoff (ms):");
+    for (uint8_t attempt = 1; attempt < RETRY_MAX_ATTEMPTS; attempt++)
+    {
+        RetryQueue::Entry *entry = queue.nextReady();
+        if (!entry)
+        {
+            ok = false;
+            break;
+        }
+        uint32_t failedAt = clock.millis();
+        queue.retryLater(entry);
+
+        uint32_t wait = entry->readyMs - failedAt;
+        uint32_t full = RetryQueue::backoffMs(attempt);
+        ok = ok && wait >= full / 2 && wait <= full && queue.nextReady() == nullptr;
+        printf(" %u", (unsigned)wait);
+        clock.advance(wait);
+    }
+    RetryQueue::Entry *last = queue.nextReady();
+    if (last)
+        queue.retryLater(last);
+    ok = ok && last && queue.empty() && queue.expired == 1;
+
+    // Response TTL: gone once the hub has stopped waiting
+    push(queue, RetryQueue::RESPONSE, 2, 1000);
+    clock.advance(1000);
+    ok = ok && queue.nextReady() == nullptr && queue.expired == 2;
+
+    printf("\njittered exponential backoff, max attempts and TTL: %s\n", ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+// Random pushes, failures and sends against a brute-force check of every
+// nextReady() answer, counting every message to exactly one outcome
+static bool stress(FakeClock &clock, int operations)
+{
+    RetryQueue queue(clock);
+    queue.begin(12345);
+    srand(42);
+
+    uint32_t pushed = 0, sent = 0, refused = 0;
+    bool ok = true;
+
+    AllocScope scope;
+    for (int op = 0; op < operations && ok; op++)
+    {
+        int action = rand() % 10;
+        if (action < 4)
+        {
+            RetryQueue::Priority priority = rand() % 4 == 0 ? RetryQueue::RESPONSE : RetryQueue::TELEMETRY;
+            uint32_t ttl = priority == RetryQueue::RESPONSE ? 30000 : 0;
+            pushed++;
+            if (!push(queue, priority, pushed, ttl))
+                refused++;
+        }
+        else if (action < 8)
+        {
+            RetryQueue::Entry *entry = queue.nextReady();
+            uint32_t now = clock.millis();
+
+            // Nothing ready may outrank the answer
+            for (size_t i = 0; i < RetryQueue::capacity(); i++)
+            {
+                const RetryQueue::Entry *other = queue.at(i);
+                if (!other || (int32_t)(now - other->readyMs) < 0)
+                    continue;
+                if (!entry || other->priority > entry->priority ||
+                    (other->priority == entry->priority && (int32_t)(other->sequence - entry->sequence) < 0))
+                    ok = false;
+            }
+            if (!entry)
+                continue;
+            ok = ok && intact(*entry);
+
+            if (rand() % 3 == 0)
+                queue.retryLater(entry);
+            else
+            {
+                queue.remove(entry);
+                sent++;
+            }
+        }
+        else
+        {
+            clock.advance(rand() % 5000);
+        }
+        ok = ok && queue.size() <= RetryQueue::capacity();
+    }
+    AllocCounts allocations = scope.delta();
+
+    uint32_t accounted = sent + refused + queue.evicted + queue.expired + (uint32_t)queue.size();
+    bool conserved = accounted == pushed && refused == queue.rejected;
+    printf("stress: %d operations, %u pushed, %u sent, %u evicted, %u expired, %u refused, %u left\n", operations,
+           (unsigned)pushed, (unsigned)sent, (unsigned)queue.evicted, (unsigned)queue.expired, (unsigned)refused,
+           (unsigned)queue.size());
+    printf("stress ordering and payloads: %s, every message accounted for: %s\n", ok ? "ok" : "MISMATCH",
+           conserved ? "ok" : "MISMATCH");
+    if (AllocProbe::available())
+        printf("heap allocations during stress: %u\n", (unsigned)allocations.allocations);
+
+    return ok && conserved && (!AllocProbe::available() || allocations.allocations == 0);
+}
+
+// Retry queue ordering, eviction and backoff on the fake clock
+int runRetryQueue(int argc, char **argv)
+{
+    int operations = argc > 1 ? atoi(argv[1]) : 200000;
+    FakeClock clock;
+
+    bool ok = checkOrdering(clock);
+    ok = checkEviction(clock) && ok;
+    ok = checkBackoff(clock) && ok;
+    ok = stress(clock, operations) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#include "native_app.h"
+#include "../utils/sample_ring.h"
+
+typedef SampleRing<uint32_t, 8> Ring;
+
+// Pops everything and checks it runs first, first + 1, ...
+static bool popsInOrder(Ring &ring, uint32_t first, size_t count)
+{
+    uint32_t value;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!ring.pop(value) || value != first + i)
+            return false;
+    }
+    return !ring.pop(value) && ring.empty();
+}
+
+// Pushing past capacity keeps the oldest samples and counts the rest
+static bool checkOverflow(Ring &ring)
+{
+    ring.reset();
+    size_t accepted = 0;
+    for (uint32_t i = 0; i < Ring::capacity() + 5; i++)
+        accepted += ring.push(i);
+
+    bool ok = accepted == Ring::capacity() && ring.size() == Ring::capacity() && ring.dropped() == 5;
+    ok = ok && popsInOrder(ring, 0, Ring::capacity());
+
+    // Room again once drained; the drop count stays
+    ok = ok && ring.push(100) && ring.dropped() == 5 && popsInOrder(ring, 100, 1);
+
+    printf("overflow: %u accepted of %u, %u dropped, oldest kept: %s\n", (unsigned)accepted,
+           (unsigned)(Ring::capacity() + 5), (unsigned)ring.dropped(), ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Head and tail cross UINT32_MAX while the ring is partly full and full
+static bool checkCounterWrap(Ring &ring)
+{
+    bool ok = true;
+    for (uint32_t before = 0; before <= Ring::capacity(); before++)
+    {
+        ring.reset(UINT32_MAX - before);
+        for (uint32_t i = 0; i < Ring::capacity(); i++)
+            ok = ok && ring.push(i);
+        ok = ok && !ring.push(99) && ring.dropped() == 1 && ring.size() == Ring::capacity();
+        ok = ok && popsInOrder(ring, 0, Ring::capacity());
+    }
+
+    // Steady traffic through the wrap, a few samples in flight at a time
+    ring.reset(UINT32_MAX - 20);
+    uint32_t next = 0, expect = 0, value;
+    for (int round = 0; round < 40; round++)
+    {
+        for (int i = 0; i < 3; i++)
+            ok = ok && ring.push(next++);
+        for (int i = 0; i < 3; i++)
+            ok = ok && ring.pop(value) && value == expect++;
+    }
+    ok = ok && ring.empty() && ring.dropped() == 0;
+
+    printf("counter wrap: FIFO order across UINT32_MAX, full and partly full: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// drain() stops at maxCount and at empty; clear() discards only what is queued
+static bool checkDrainAndClear(Ring &ring)
+{
+    ring.reset(UINT32_MAX - 3);
+    for (uint32_t i = 0; i < 6; i++)
+        ring.push(i);
+
+    uint32_t out[Ring::capacity()];
+    bool ok = ring.drain(out, 4) == 4 && out[0] == 0 && out[3] == 3 && ring.size() == 2;
+    ok = ok && ring.drain(out, Ring::capacity()) == 2 && out[0] == 4 && out[1] == 5;
+    ok = ok && ring.drain(out, Ring::capacity()) == 0 && ring.empty();
+
+    for (uint32_t i = 10; i < 15; i++)
+        ring.push(i);
+    ring.clear();
+    ok = ok && ring.empty() && ring.dropped() == 0 && ring.push(20) && popsInOrder(ring, 20, 1);
+
+    printf("drain and clear: %s\n", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int runSampleRing(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    static Ring ring;
+
+    bool ok = checkOverflow(ring);
+    ok = checkCounterWrap(ring) && ok;
+    ok = checkDrainAndClear(ring) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "native_app.h"
+#include "bench_timer.h"
+#include "../hal/native/fake_hal.h"
+#include "../hal/native/fake_max30105.h"
+#include "../utils/max30105_fifo.h"
+#include "../utils/stage_profiler.h"
+#include "../dsp/ppg_pipeline.h"
+#include "../data/wifi_connection.h"
+
+// Bucket edges, percentiles and a stretch longer than the cycle counter
+static bool checkHistogram(FakeClock &clock)
+{
+    bool ok = StageProfiler::bucketFor(0) == 0 && StageProfiler::bucketFor(1) == 0 &&
+              StageProfiler::bucketFor(2) == 1 && StageProfiler::bucketFor(3) == 1 &&
+              StageProfiler::bucketFor(1024) == 10 && StageProfiler::bucketFor(UINT32_MAX) == PROFILE_BUCKETS - 1;
+
+    // 90 fast publishes and 10 slow ones
+    StageProfiler profiler(clock);
+    for (int i = 0; i < 90; i++)
+        profiler.record(STAGE_PUBLISH, 300);
+    for (int i = 0; i < 10; i++)
+        profiler.record(STAGE_PUBLISH, 40000);
+    uint32_t p50 = profiler.percentileUs(STAGE_PUBLISH, 0.5f);
+    uint32_t p99 = profiler.percentileUs(STAGE_PUBLISH, 0.99f);
+    ok = ok && p50 >= 300 && p50 < 512 && p99 == 40000;
+
+    // 60 s of fake time is past the 32-bit cycle counter at 80 MHz
+    profiler.start(STAGE_WAKE_TO_SLEEP);
+    clock.advance(60000);
+    uint32_t us = profiler.stop(STAGE_WAKE_TO_SLEEP);
+    ok = ok && us >= 60000000UL && us < 60001000UL && profiler.stop(STAGE_WAKE_TO_SLEEP) == 0;
+
+    printf("histogram: p50 %lu us, p99 %lu us, 60 s stage read as %lu us: %s\n", (unsigned long)p50,
+           (unsigned long)p99, (unsigned long)us, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// Cold and cached Wi-Fi joins on the fake radio, timed by WifiConnection's
+// own probe
+static void simulateJoins(FakeClock &clock, int wakes)
+{
+    fakeRtcStorage().erase();
+    for (int wake = 0; wake < wakes; wake++)
+    {
+        clock.reboot();
+        WakeState cache(fakeRtcStorage(), clock);
+        cache.restore();
+
+        WifiConnection wifi(fakeWifi(), clock, cache);
+        wifi.start({"ssid", "password", {0, 0, 0, 0}});
+        while (wifi.tick() != WifiConnection::State::CONNECTED && wifi.state() != WifiConnection::State::FAILED)
+            clock.advance(10);
+        cache.save(1760000000, 10000);
+    }
+}
+
+// FIFO reads as the sensor task does them: drain the FIFO, run the block
+// through the PPG chain. Fake time for the bus, real time for the DSP.
+static void simulateSensor(FakeClock &clock, int reads)
+{
+    FakeI2CBus &bus = fakeI2C();
+    FakeMax30105 sensor(clock);
+    sensor.heartRateBpm = 72;
+    bus.detachAll();
+    bus.attach(sensor);
+
+    Max30105Fifo fifo(bus);
+    fifo.begin();
+    PpgPipeline pipeline;
+    pipeline.begin();
+    PpgSample block[Max30105Fifo::FIFO_DEPTH];
+
+    for (int i = 0; i < reads; i++)
+    {
+        // Drained at half a FIFO fill, as in polling mode
+        clock.advance(Max30105Fifo::FIFO_DEPTH * 1000UL / fifo.outputRateHz() / 2);
+        PROFILE_SCOPE(STAGE_SENSOR_READ);
+        size_t count = fifo.drain(block, Max30105Fifo::FIFO_DEPTH);
+        PROFILE_SCOPE(STAGE_DSP_BLOCK);
+        pipeline.processBlock(block, count);
+    }
+    bus.detachAll();
+}
+
+// Host cost of one scoped probe
+static double probeCostNs()
+{
+    const int iterations = 200000;
+    StageProfiler profiler(fakeClock());
+    BenchTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+        StageProfiler::Probe probe(profiler, STAGE_PUBLISH);
+    return (double)timer.elapsedNs() / iterations;
+}
+
+int runStageProfile(int argc, char **argv)
+{
+    int reads = argc > 1 ? atoi(argv[1]) : 2000;
+    FakeClock &clock = fakeClock();
+
+    bool ok = checkHistogram(clock);
+
+    stageProfiler.reset();
+    simulateJoins(clock, 5);
+    simulateSensor(clock, reads);
+
+    printf("\n5 wakes of Wi-Fi join, %d sensor reads (perf command output):\n", reads);
+    stageProfiler.print();
+
+    char metrics[512];
+    size_t length = stageProfiler.formatMetrics(metrics, sizeof(metrics), "native");
+    ok = ok && length > 0 && metrics[length - 1] == '}';
+    printf("\nmetrics message (%u bytes): %s\n", (unsigned)length, metrics);
+    printf("probe cost on host: %.1f ns\n", probeCostNs());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+
+#include "native_app.h"
+#include "../hal/native/fake_hal.h"
+#include "../state/time/time_service.h"
+#include "../data/codec/telemetry_codec.h"
+#include "../data/codec/telemetry_decoder.h"
+
+// Stamps a reading every 100 ms from boot while SNTP runs in the
+// background, then converts the first stamp at "send" time
+struct TimeRun
+{
+    uint32_t firstStampMs;
+    uint32_t loopPasses;     // Work done while time was unknown
+    uint32_t encodedSeconds; // What the payload carries for the first stamp
+    bool monotonic;
+    TimeService::Source source;
+};
+
+static TimeRun simulate(FakeClock &clock, FakeWallClock &wall, bool ntpReachable, bool warm)
+{
+    clock.reboot();
+    wall.reboot();
+    wall.ntpReachable = ntpReachable;
+
+    WakeState cache(fakeRtcStorage(), clock);
+    if (warm)
+        cache.save(wall.trueEpochAtBoot - 10, 10000); // Slept 10 s, just synced before
+    else
+        fakeRtcStorage().erase();
+    cache.restore();
+    if (warm)
+        cache.recordTimeSync(wall.trueEpochAtBoot - 10);
+
+    TimeService time(wall, clock, cache);
+    time.restore();
+    if (cache.needsTimeSync())
+        time.startSync();
+
+    TimeRun run = {clock.millis(), 0, 0, false, TimeService::Source::NONE};
+    // Acquisition never waits for the clock
+    while (clock.millis() < 8000)
+    {
+        time.tick();
+        if (!time.known())
+            run.loopPasses++;
+        clock.advance(100);
+    }
+
+    uint8_t flags = 0;
+    uint32_t seconds = time.epochAt(run.firstStampMs);
+    if (seconds == 0)
+    {
+        seconds = run.firstStampMs / 1000;
+        flags = TELEMETRY_FLAG_MONOTONIC_TIME;
+    }
+
+    uint8_t buffer[64];
+    size_t length = TelemetryCodec::encodeReading(buffer, sizeof(buffer), "1", seconds, 72.0f, 36.8f, 97.0f, flags);
+    static DecodedTelemetry decoded;
+    decodeTelemetry(buffer, length, decoded);
+
+    run.encodedSeconds = decoded.timestamp;
+    run.monotonic = decoded.monotonicTime();
+    run.source = time.source();
+    return run;
+}
+
+static const char *sourceName(TimeService::Source source)
+{
+    switch (source)
+    {
+    case TimeService::Source::NTP:
+        return "ntp";
+    case TimeService::Source::RTC_ESTIMATE:
+        return "rtc";
+    default:
+        return "none";
+    }
+}
+
+// Boots with and without NTP and with an RTC estimate; stamps taken before
+// the sync must come out with the right epoch, or flagged monotonic
+int runTimeSync(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    FakeClock &clock = fakeClock();
+    FakeWallClock &wall = fakeWallClock();
+
+    TimeRun cold = simulate(clock, wall, true, false);
+    TimeRun offline = simulate(clock, wall, false, false);
+    TimeRun warm = simulate(clock, wall, false, true);
+
+    const TimeRun *runs[] = {&cold, &offline, &warm};
+    const char *labels[] = {"cold boot, NTP reachable", "cold boot, NTP unreachable", "warm wake, RTC estimate"};
+    for (int i = 0; i < 3; i++)
+    {
+        printf("%-28s source=%-4s first stamp -> %lu%s, %lu loop passes before time was known\n", labels[i],
+               sourceName(runs[i]->source), (unsigned long)runs[i]->encodedSeconds,
+               runs[i]->monotonic ? " (monotonic)" : "", (unsigned long)runs[i]->loopPasses);
+    }
+
+    bool ok = cold.source == TimeService::Source::NTP && cold.encodedSeconds == wall.trueEpochAtBoot &&
+              !cold.monotonic && cold.loopPasses > 0 && offline.monotonic && offline.encodedSeconds == 0 &&
+              warm.source == TimeService::Source::RTC_ESTIMATE && warm.encodedSeconds == wall.trueEpochAtBoot &&
+              warm.loopPasses == 0;
+    return ok ? 0 : 1;
+}
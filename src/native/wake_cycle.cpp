@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "native_app.h"
+#include "../hal/native/fake_hal.h"
+#include "../state/sensor/sensor_state.h"
+#include "../state/job/job_state.h"
+#include "../state/send/send_state.h"
+
+// Stands in for RemoteDataSource and remembers what would have been sent.
+// Network, handshake and PUBACK take fake time like they would on the
+// board; connectMs is spent inside connect(), which blocks there too.
+class RecordingSink : public TelemetrySink
+{
+private:
+    FakeClock &clock;
+    uint32_t ackDueMs = 0;
+    bool awaitingAck = false;
+    bool link = false;
+
+public:
+    uint32_t networkMs = 800;
+    uint32_t connectMs = 1500;
+    uint32_t ackMs = 300;
+    bool reachable = true;
+
+    int connects = 0;
+    int sends = 0;
+    float lastBpm = 0;
+    float lastTemp = 0;
+    float lastSpO2 = 0;
+    TelemetryBatch lastBatch;
+
+    explicit RecordingSink(FakeClock &clock) : clock(clock) {}
+
+    bool networkReady() override { return reachable && clock.millis() >= networkMs; }
+    bool connected() override { return link; }
+
+    bool connect(int maxRetries) override
+    {
+        (void)maxRetries;
+        connects++;
+        clock.advance(connectMs);
+        link = reachable;
+        return link;
+    }
+
+    bool sendData(float pulseRate, float temperature, float spO2) override
+    {
+        sends++;
+        lastBpm = pulseRate;
+        lastTemp = temperature;
+        lastSpO2 = spO2;
+        awaitingAck = true;
+        ackDueMs = clock.millis() + ackMs;
+        return true;
+    }
+
+    bool sendBatch(const TelemetryBatch &batch) override
+    {
+        sends++;
+        lastBatch = batch;
+        awaitingAck = true;
+        ackDueMs = clock.millis() + ackMs;
+        return true;
+    }
+
+    bool allDelivered() override
+    {
+        if (awaitingAck && link && (int32_t)(clock.millis() - ackDueMs) >= 0)
+            awaitingAck = false;
+        return !awaitingAck;
+    }
+};
+
+struct CycleRun
+{
+    uint32_t totalMs;
+    uint32_t postedMs;   // When the batch was complete
+    uint32_t longestPassMs; // Longest loop() pass, i.e. how long sampling stalled
+    uint32_t ticksDuringSend;
+};
+
+// One wake the way main.cpp runs it on the board: sensors are sampled every
+// loop() pass (~25 ms), the job ticks every 1.2 s from its Ticker, and the
+// send machine takes one step per pass, all on fake time.
+static CycleRun runCycle(FakeClock &clock, JobState &job, SendState &send, RecordingSink &sink)
+{
+    CycleRun run = {0, 0, 0, 0};
+    job.begin();
+    job.startJob();
+
+    uint32_t start = clock.millis();
+    uint32_t nextTick = start + 1200;
+    while (!send.readyForSleep())
+    {
+        uint32_t passStart = clock.millis();
+        send.tick(sink);
+
+        float bpm = 60.0f + (float)(rand() % 200) / 10.0f;
+        float temp = 38.0f + (float)(rand() % 20) / 10.0f;
+        float spo2 = 94.0f + (float)(rand() % 50) / 10.0f;
+        sensorState.setState(temp, bpm, spo2, clock.millis());
+
+        clock.advance(25);
+        uint32_t pass = clock.millis() - passStart;
+        if (pass > run.longestPassMs)
+            run.longestPassMs = pass;
+
+        // Ticker callbacks that fell due during the pass run after it
+        while ((int32_t)(clock.millis() - nextTick) >= 0)
+        {
+            nextTick += 1200;
+            job.tick();
+            if (send.busy())
+                run.ticksDuringSend++;
+            if (job.hasCompleted())
+                run.postedMs = clock.millis() - start;
+        }
+    }
+    job.stop();
+    run.totalMs = clock.millis() - start;
+    return run;
+}
+
+int runWakeCycle(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    FakeClock &clock = fakeClock();
+    RecordingSink sink(clock);
+    srand(1);
+
+    CycleRun run = runCycle(clock, jobState, sendState, sink);
+
+    printf("wake cycle: %lu ms simulated, %d connects, %d sends\n", (unsigned long)run.totalMs, sink.connects,
+           sink.sends);
+    printf("send: batch posted at %lu ms, done %lu ms later; longest loop() pass %lu ms, %lu job ticks during it\n",
+           (unsigned long)run.postedMs, (unsigned long)(run.totalMs - run.postedMs), (unsigned long)run.longestPassMs,
+           (unsigned long)run.ticksDuringSend);
+    sendState.printTimings();
+#if TELEMETRY_BATCHING
+    for (uint8_t i = 0; i < sink.lastBatch.count; i++)
+    {
+        const TelemetryWindow &w = sink.lastBatch.windows[i];
+        printf("window +%5.1fs n=%u q=%u%% bpm=%.1f [%.1f..%.1f] temp=%.2f spo2=%.1f\n", w.offsetMs / 1000.0,
+               w.samples, w.quality, w.bpm.mean, w.bpm.min, w.bpm.max, w.temperature.mean, w.spO2.mean);
+    }
+#else
+    printf("last send: bpm=%.2f temp=%.2f spo2=%.2f\n", sink.lastBpm, sink.lastTemp, sink.lastSpO2);
+#endif
+    printf("sample ring: %u dropped\n", (unsigned)sensorState.droppedSamples());
+    bool ok = sink.sends == 1 && sendState.delivered == 1 && sendState.timeouts == 0 &&
+              run.longestPassMs <= sink.connectMs + 25;
+
+    // Unreachable broker: every state gives up on its own timeout and the
+    // batch is still handed over (to the log) before sleeping
+    FakeClock offlineClock;
+    JobState offlineJob(sensorState, offlineClock);
+    SendState offlineSend(offlineJob, offlineClock);
+    RecordingSink offline(offlineClock);
+    offline.reachable = false;
+    CycleRun lost = runCycle(offlineClock, offlineJob, offlineSend, offline);
+    printf("unreachable: done %lu ms after the batch, %d connects, %d sends, %lu timeouts\n",
+           (unsigned long)(lost.totalMs - lost.postedMs), offline.connects, offline.sends,
+           (unsigned long)offlineSend.timeouts);
+    ok = ok && offline.sends == 1 && offlineSend.timeouts == 1 && offlineSend.delivered == 0 &&
+         lost.totalMs - lost.postedMs <= SEND_NETWORK_TIMEOUT_MS + 100;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include <stdio.h>
+
+#include "native_app.h"
+#include "../hal/native/fake_hal.h"
+#include "../data/wifi_connection.h"
+
+struct JoinResult
+{
+    bool connected;
+    uint32_t totalMs;
+    uint32_t directedMs;
+    uint32_t scanMs;
+};
+
+// One wake: restore the RTC block, join while "sensor warm-up" ticks
+// alongside, save the block for the next wake
+static JoinResult simulateJoin(FakeClock &clock, FakeWifiLink &link, const WifiLease &staticIp, uint32_t &warmupTicks)
+{
+    clock.reboot();
+    WakeState cache(fakeRtcStorage(), clock);
+    cache.restore();
+
+    WifiConnection wifi(link, clock, cache);
+    wifi.start({"ssid", "password", staticIp});
+
+    warmupTicks = 0;
+    while (wifi.tick() != WifiConnection::State::CONNECTED && wifi.state() != WifiConnection::State::FAILED &&
+           clock.millis() < 20000)
+    {
+        clock.advance(10); // One loop() pass of other work
+        warmupTicks++;
+    }
+
+    cache.save(1760000000, 10000);
+    return {wifi.connected(), clock.millis(), wifi.directedDuration(), wifi.scanDuration()};
+}
+
+static void printJoin(const char *label, const JoinResult &r, uint32_t warmupTicks)
+{
+    printf("%-28s %-9s total %5lu ms (directed %4lu, scan %4lu), %lu loop passes meanwhile\n", label,
+           r.connected ? "connected" : "FAILED", (unsigned long)r.totalMs, (unsigned long)r.directedMs,
+           (unsigned long)r.scanMs, (unsigned long)warmupTicks);
+}
+
+// Cold join, cached directed join, static IP, and an AP that moved channel
+int runWifiJoin(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    FakeClock &clock = fakeClock();
+    FakeWifiLink &link = fakeWifi();
+    fakeRtcStorage().erase();
+
+    const WifiLease dhcp = {0, 0, 0, 0};
+    const WifiLease fixed = {0x1401A8C0, 0x0101A8C0, 0x00FFFFFF, 0x0101A8C0};
+    uint32_t ticks = 0;
+
+    JoinResult cold = simulateJoin(clock, link, dhcp, ticks);
+    printJoin("cold (scan + DHCP)", cold, ticks);
+
+    JoinResult warm = simulateJoin(clock, link, dhcp, ticks);
+    printJoin("warm (cached BSSID + lease)", warm, ticks);
+
+    JoinResult configured = simulateJoin(clock, link, fixed, ticks);
+    printJoin("warm (configured static IP)", configured, ticks);
+
+    link.apChannel = 11; // AP moved: directed join must fall back
+    JoinResult moved = simulateJoin(clock, link, dhcp, ticks);
+    printJoin("AP moved channel", moved, ticks);
+
+    JoinResult after = simulateJoin(clock, link, dhcp, ticks);
+    printJoin("next wake after move", after, ticks);
+
+    link.apPresent = false;
+    JoinResult gone = simulateJoin(clock, link, dhcp, ticks);
+    printJoin("AP gone", gone, ticks);
+
+    bool ok = cold.connected && cold.scanMs > 0 && warm.connected && warm.scanMs == 0 && warm.totalMs < cold.totalMs &&
+              moved.connected && moved.directedMs > 0 && moved.scanMs > 0 && after.scanMs == 0 && !gone.connected;
+    return ok ? 0 : 1;
+}
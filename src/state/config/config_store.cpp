@@ -0,0 +1,102 @@
+#include "config_store.h"
+#include "../../utils/crc32.h"
+
+#include <string.h>
+
+static_assert(sizeof(ConfigHeader) + sizeof(DeviceConfig) <= CONFIG_SLOT_SIZE, "DeviceConfig outgrew its slot");
+static_assert(2 * CONFIG_SLOT_SIZE <= 512, "Two slots must fit the EEPROM area");
+
+ConfigStore configStore(configStorage());
+
+// Old layout: 16-bit length, then that many bytes of JSON
+static const size_t LEGACY_MAX_LENGTH = 510;
+
+ConfigStore::ConfigStore(Storage &storage) : storage(storage)
+{
+}
+
+uint32_t ConfigStore::checksum(const ConfigHeader &header, const void *config)
+{
+    return crc32(config, header.length, crc32(&header, offsetof(ConfigHeader, crc)));
+}
+
+bool ConfigStore::readSlot(uint8_t slot, ConfigHeader &header, DeviceConfig &config)
+{
+    // Records from newer firmware are skipped rather than truncated
+    if (!storage.read(slotOffset(slot), &header, sizeof(header)) || header.magic != ConfigHeader::MAGIC ||
+        header.version > ConfigHeader::VERSION || header.length > sizeof(DeviceConfig))
+        return false;
+
+    // Older, shorter layouts leave the fields added since zeroed
+    memset(&config, 0, sizeof(config));
+    return storage.read(slotOffset(slot) + sizeof(header), &config, header.length) &&
+           header.crc == checksum(header, &config);
+}
+
+ConfigSource ConfigStore::load(DeviceConfig &config)
+{
+    storage.begin();
+    ConfigHeader header;
+    DeviceConfig candidate;
+    bool found = false;
+
+    for (uint8_t slot = 0; slot < 2; slot++)
+    {
+        if (!readSlot(slot, header, candidate))
+            continue;
+        if (found && (int32_t)(header.sequence - newestSequence) <= 0)
+            continue;
+        memcpy(&config, &candidate, sizeof(config));
+        newestSequence = header.sequence;
+        newestSlot = slot;
+        found = true;
+    }
+
+    uint8_t legacy[3] = {0, 0, 0};
+    storage.read(0, legacy, sizeof(legacy));
+    storage.end();
+
+    if (found)
+        return ConfigSource::RECORD;
+
+    memset(&config, 0, sizeof(config));
+    size_t length = legacy[0] | (legacy[1] << 8);
+    return length > 0 && length < LEGACY_MAX_LENGTH && legacy[2] == '{' ? ConfigSource::LEGACY_JSON
+                                                                         : ConfigSource::DEFAULTS;
+}
+
+size_t ConfigStore::legacyJson(char *out, size_t capacity)
+{
+    storage.begin();
+    uint8_t prefix[2] = {0, 0};
+    storage.read(0, prefix, sizeof(prefix));
+    size_t length = prefix[0] | (prefix[1] << 8);
+    if (length == 0 || length >= LEGACY_MAX_LENGTH || length >= capacity || !storage.read(2, out, length))
+        length = 0;
+    out[length] = '\0';
+    storage.end();
+    return length;
+}
+
+bool ConfigStore::save(const DeviceConfig &config)
+{
+    uint8_t slot = newestSlot ^ 1;
+    ConfigHeader header;
+    header.magic = ConfigHeader::MAGIC;
+    header.version = ConfigHeader::VERSION;
+    header.length = sizeof(DeviceConfig);
+    header.sequence = newestSequence + 1;
+    header.crc = checksum(header, &config);
+
+    storage.begin();
+    bool ok = storage.write(slotOffset(slot), &header, sizeof(header)) &&
+              storage.write(slotOffset(slot) + sizeof(header), &config, sizeof(config)) && storage.commit();
+    storage.end();
+
+    if (ok)
+    {
+        newestSlot = slot;
+        newestSequence = header.sequence;
+    }
+    return ok;
+}
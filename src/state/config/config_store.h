@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+
+// Bytes per slot in the 512-byte EEPROM area; two slots fill it
+#ifndef CONFIG_SLOT_SIZE
+#define CONFIG_SLOT_SIZE 256
+#endif
+
+// Settings changed over serial and kept in EEPROM. Empty strings mean
+// "not set": the env.h value is used instead. New fields go at the end;
+// records written before them load with the new fields zeroed.
+struct DeviceConfig
+{
+    char wifiSSID[33]; // 802.11 limit is 32
+    char wifiPassword[65];
+    WifiLease staticIp; // Empty: DHCP
+    char deviceName[32];
+    char location[48];
+    char installationDate[24];
+};
+
+// Front of each slot; the config follows it
+struct ConfigHeader
+{
+    static const uint32_t MAGIC = 0x31474643; // "CFG1"
+    static const uint16_t VERSION = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;   // Config bytes that follow, sizeof(DeviceConfig) when written
+    uint32_t sequence; // Higher is newer
+    uint32_t crc;      // Over the header up to here and the config bytes
+};
+
+// Where the config came from on load
+enum class ConfigSource : uint8_t
+{
+    DEFAULTS,   // Nothing valid stored
+    RECORD,     // Newest valid slot
+    LEGACY_JSON // Old length-prefixed JSON; convert and save()
+};
+
+// Binary config record in two alternating EEPROM slots. save() writes the
+// slot not holding the newest record, so a torn write leaves the previous
+// config readable. Loading is a block read and a CRC per slot.
+class ConfigStore
+{
+private:
+    Storage &storage;
+    uint32_t newestSequence = 0;
+    uint8_t newestSlot = 1; // First save goes to slot 0
+
+    static size_t slotOffset(uint8_t slot) { return slot * CONFIG_SLOT_SIZE; }
+    static uint32_t checksum(const ConfigHeader &header, const void *config);
+    // Header and config of one slot; false if torn, foreign or too new
+    bool readSlot(uint8_t slot, ConfigHeader &header, DeviceConfig &config);
+
+public:
+    explicit ConfigStore(Storage &storage);
+
+    // Newest valid record into config, or zeroes
+    ConfigSource load(DeviceConfig &config);
+    // The old format's JSON text, NUL-terminated; 0 if there is none
+    size_t legacyJson(char *out, size_t capacity);
+    bool save(const DeviceConfig &config);
+
+    uint8_t activeSlot() const { return newestSlot; }
+    uint32_t sequence() const { return newestSequence; }
+};
+
+extern ConfigStore configStore;
@@ -1,7 +1,12 @@
 #include "device_state.h"
 #include "../../utils/others.h"
+#include "../../utils/battery.h"
 #include "../../data/remote_datasource.h"
-#include <EEPROM.h>
+#include "../../hal/hal.h"
+#include "../wake/wake_state.h"
+#include "../time/time_service.h"
+#include "../../utils/stage_profiler.h"
+#include "../memory/memory_monitor.h"
 #include <ArduinoJson.h>
 
 // Define the global deviceState instance
@@ -10,26 +15,53 @@ DeviceState deviceState;
 // Constructor implementation
 DeviceState::DeviceState()
 {
-    // Initialize runtime variables with defaults
+    // Initialize runtime variables with defaults; begin() loads the saved ones
     initializeDefaults();
+}
 
-    // Try to load saved configuration from EEPROM
+void DeviceState::begin()
+{
     loadConfigFromEEPROM();
 }
 
-bool DeviceState::hasChanged(String oldVal, String newVal)
+bool DeviceState::setField(char *field, size_t capacity, const char *value)
 {
-    return oldVal != newVal;
+    if (value == nullptr || strlen(value) >= capacity)
+        return false;
+    strcpy(field, value);
+    return true;
 }
 
-bool DeviceState::applyChange(String &field, const String &newVal)
+const char *DeviceState::statusName(LinkStatus status)
 {
-    if (hasChanged(field, newVal))
+    switch (status)
     {
-        field = newVal;
-        return true;
+    case LinkStatus::ONLINE:
+        return "Online";
+    case LinkStatus::ENTERING_SLEEP:
+        return "Entering Sleep";
+    case LinkStatus::DEEP_SLEEP:
+        return "Deep Sleep";
+    default:
+        return "Offline";
+    }
+}
+
+const char *DeviceState::powerSourceName(PowerSource source)
+{
+    switch (source)
+    {
+    case PowerSource::USB:
+        return "USB (PC Connection)";
+    case PowerSource::BATTERY:
+        return "Battery";
+    case PowerSource::BATTERY_LOW:
+        return "Battery (Low)";
+    case PowerSource::CHARGING:
+        return "External/Charging";
+    default:
+        return "Unknown";
     }
-    return false;
 }
 
 void DeviceState::handleSerialCommand(const String &command)
@@ -46,21 +78,17 @@ void DeviceState::handleSerialCommand(const String &command)
         JsonDocument doc;
         JsonObject deviceInfo = doc["device_info"].to<JsonObject>();
 
-        // Use runtime values if available, otherwise fall back to defaults
-        String currentDeviceName = deviceNameRuntime.isEmpty() ? deviceName : deviceNameRuntime;
-        String currentLocation = locationRuntime.isEmpty() ? location : locationRuntime;
-        String currentInstallationDate = installationDateRuntime.isEmpty() ? installationDate : installationDateRuntime;
-
-        deviceInfo["device_name"] = currentDeviceName;
+        // Runtime values if set, otherwise the env.h defaults
+        deviceInfo["device_name"] = getDeviceName();
         deviceInfo["device_repo"] = deviceRepo;
         deviceInfo["device_type"] = deviceType;
         deviceInfo["device_id"] = deviceId;
         deviceInfo["firmware_version"] = firmwareVersion;
         deviceInfo["board_type"] = boardType;
         deviceInfo["mac_address"] = WiFi.macAddress();
-        deviceInfo["installation_date"] = currentInstallationDate;
-        deviceInfo["location"] = currentLocation;
-        deviceInfo["wifi_ssid"] = wifiSSID;
+        deviceInfo["installation_date"] = getInstallationDate();
+        deviceInfo["location"] = getLocation();
+        deviceInfo["wifi_ssid"] = config.wifiSSID[0] ? config.wifiSSID : "placeholder";
         deviceInfo["wifi_password"] = "[HIDDEN]";
 
         // Add connectivity and power status
@@ -105,25 +133,24 @@ void DeviceState::handleSerialCommand(const String &command)
 void DeviceState::updateFromSystem()
 {
     // Initialize deviceId if not set
-    if (deviceId.isEmpty())
+    if (deviceId[0] == '\0')
     {
-        deviceId = OtherUtils::getDeviceId();
+        snprintf(deviceId, sizeof(deviceId), "%s", OtherUtils::getDeviceId().c_str());
     }
 
     bool changed = false;
 
     if (WiFi.isConnected())
     {
-        changed |= applyChange(currentStatus, "Online");
-        changed |= applyChange(ipAddress, WiFi.localIP().toString());
-        changed |= applyChange(macAddress, WiFi.macAddress());
-        changed |= applyChange(signalStrength, String(WiFi.RSSI()) + " dBm");
+        changed |= applyChange(linkStatus, LinkStatus::ONLINE);
+        changed |= applyChange(ipAddress, (uint32_t)WiFi.localIP());
+        changed |= applyChange(rssiDbm, (int8_t)WiFi.RSSI());
     }
     else
     {
-        changed |= applyChange(currentStatus, "Offline");
-        changed |= applyChange(ipAddress, "Not available");
-        changed |= applyChange(signalStrength, "Not available");
+        changed |= applyChange(linkStatus, LinkStatus::OFFLINE);
+        changed |= applyChange(ipAddress, NO_ADDRESS);
+        changed |= applyChange(rssiDbm, NO_RSSI);
     }
 
     // Update power status with real hardware readings
@@ -137,72 +164,119 @@ void DeviceState::updateFromSystem()
 
 void DeviceState::updatePowerStatus()
 {
-    // Read ADC value (0-1024 on ESP8266)
-    int adcValue = analogRead(A0);
-
-    // Convert ADC to voltage (ESP8266 ADC reference is typically 1.0V, but with voltage divider it can read up to 3.3V)
-    // For battery monitoring, typical voltage divider gives us: Vout = Vin * (R2/(R1+R2))
-    // Assuming a 3.3V max input with voltage divider
-    float voltage = (adcValue / 1024.0) * 3.3;
-
-    // Update voltage reading
-    voltageReading = String(voltage, 2) + "V";
+    // Cell voltage back through the divider in front of A0
+    voltageMv = batteryMillivolts(analogRead(A0));
 
     // Determine power source based on voltage level
     // When connected to PC via USB, ESP8266 is powered externally
     // Low voltage (< 1.0V) typically indicates USB power with no battery connected
-    // Higher voltage (> 2.5V) indicates battery power
-    if (voltage < 1.0)
+    if (voltageMv < 1000)
     {
-        powerSource = "USB (PC Connection)";
-        chargingStatus = "External Power";
-        batteryLevel = "N/A (USB Powered)";
+        powerSource = PowerSource::USB;
+        batteryPercent = -1;
     }
-    else if (voltage >= 3.0 && voltage <= 4.2)
+    else if (voltageMv < BATTERY_EMPTY_MV)
     {
-        powerSource = "Battery";
-        chargingStatus = "Not Charging";
-        // Calculate battery percentage (rough estimation for Li-ion)
-        float batteryPercent = ((voltage - 3.0) / (4.2 - 3.0)) * 100;
-        batteryLevel = String((int)batteryPercent) + "%";
+        powerSource = PowerSource::BATTERY_LOW;
+        batteryPercent = 0;
     }
-    else if (voltage > 4.2)
+    else if (voltageMv <= BATTERY_CHARGING_MV)
     {
-        powerSource = "External/Charging";
-        chargingStatus = "Charging";
-        batteryLevel = "100%+ (Charging)";
-    }
-    else if (voltage >= 1.0 && voltage < 3.0)
-    {
-        powerSource = "Battery (Low)";
-        chargingStatus = "Not Charging";
-        batteryLevel = "Low/Critical";
+        powerSource = PowerSource::BATTERY;
+        batteryPercent = ::batteryPercent(voltageMv);
     }
     else
     {
-        powerSource = "Unknown";
-        chargingStatus = "Unknown";
-        batteryLevel = "Unknown";
+        powerSource = PowerSource::CHARGING;
+        batteryPercent = -1;
     }
 }
 
 void DeviceState::addStateToJson(JsonDocument &doc)
 {
+    // Text is built here only; char arrays are copied into the document
+    char text[24];
+
     JsonObject connectivityStatus = doc["connectivity_status"].to<JsonObject>();
-    connectivityStatus["current_status"] = currentStatus;
-    connectivityStatus["last_seen"] = lastSeen;
-    connectivityStatus["connection_type"] = connectionType;
-    connectivityStatus["ip_address"] = ipAddress;
-    connectivityStatus["signal_strength"] = signalStrength;
+    connectivityStatus["current_status"] = statusName(linkStatus);
+    connectivityStatus["last_seen"] = "Not available";
+    connectivityStatus["connection_type"] = "Wi-Fi";
+    if (ipAddress == NO_ADDRESS)
+        connectivityStatus["ip_address"] = "Not available";
+    else
+    {
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", (unsigned)(ipAddress & 0xFF), (unsigned)((ipAddress >> 8) & 0xFF),
+                 (unsigned)((ipAddress >> 16) & 0xFF), (unsigned)(ipAddress >> 24));
+        connectivityStatus["ip_address"] = text;
+    }
+    if (rssiDbm == NO_RSSI)
+        connectivityStatus["signal_strength"] = "Not available";
+    else
+    {
+        snprintf(text, sizeof(text), "%d dBm", rssiDbm);
+        connectivityStatus["signal_strength"] = text;
+    }
 
     // Update power status with real-time readings before adding to JSON
     updatePowerStatus();
 
     JsonObject powerStatus = doc["power_status"].to<JsonObject>();
-    powerStatus["power_source"] = powerSource;
-    powerStatus["battery_level"] = batteryLevel;
-    powerStatus["charging_status"] = chargingStatus;
-    powerStatus["voltage_reading"] = voltageReading;
+    powerStatus["power_source"] = powerSourceName(powerSource);
+    switch (powerSource)
+    {
+    case PowerSource::USB:
+        powerStatus["battery_level"] = "N/A (USB Powered)";
+        powerStatus["charging_status"] = "External Power";
+        break;
+    case PowerSource::BATTERY:
+        snprintf(text, sizeof(text), "%d%%", batteryPercent);
+        powerStatus["battery_level"] = text;
+        powerStatus["charging_status"] = "Not Charging";
+        break;
+    case PowerSource::BATTERY_LOW:
+        powerStatus["battery_level"] = "Low/Critical";
+        powerStatus["charging_status"] = "Not Charging";
+        break;
+    case PowerSource::CHARGING:
+        powerStatus["battery_level"] = "100%+ (Charging)";
+        powerStatus["charging_status"] = "Charging";
+        break;
+    default:
+        powerStatus["battery_level"] = "Unknown";
+        powerStatus["charging_status"] = "Unknown";
+        break;
+    }
+    unsigned centivolts = (voltageMv + 5) / 10;
+    snprintf(text, sizeof(text), "%u.%02uV", centivolts / 100, centivolts % 100);
+    powerStatus["voltage_reading"] = text;
+
+    // Now, plus [free heap, largest block, fragmentation %, free stack] per
+    // checkpoint for this wake and the worst across wakes
+    MemorySnapshot now = systemMemory().snapshot();
+    JsonObject memoryStatus = doc["memory_status"].to<JsonObject>();
+    memoryStatus["free_heap"] = now.freeHeap;
+    memoryStatus["max_free_block"] = now.maxFreeBlock;
+    memoryStatus["heap_fragmentation"] = now.fragmentation;
+    memoryStatus["free_stack"] = now.freeStack;
+    memoryStatus["wakes"] = memoryMonitor.wakes();
+    JsonObject thisWake = memoryStatus["this_wake"].to<JsonObject>();
+    JsonObject worst = memoryStatus["worst"].to<JsonObject>();
+    for (uint8_t i = 0; i < MEM_CHECKPOINT_COUNT; i++)
+    {
+        MemoryCheckpoint checkpoint = (MemoryCheckpoint)i;
+        const MemoryWatermark *marks[] = {&memoryMonitor.thisWake(checkpoint), &memoryMonitor.worst(checkpoint)};
+        JsonObject targets[] = {thisWake, worst};
+        for (uint8_t t = 0; t < 2; t++)
+        {
+            if (!marks[t]->seen)
+                continue;
+            JsonArray values = targets[t][MemoryMonitor::name(checkpoint)].to<JsonArray>();
+            values.add(marks[t]->freeHeap);
+            values.add(marks[t]->maxFreeBlock);
+            values.add(marks[t]->fragmentation);
+            values.add(marks[t]->freeStack);
+        }
+    }
 }
 
 void DeviceState::printState()
@@ -220,27 +294,95 @@ void DeviceState::setListener(StateCallback callback)
 
 void DeviceState::handleWifiConfig(const String &command)
 {
-    // Parse SET_WIFI:ssid:password
+    // Parse SET_WIFI:ssid:password[:ip,gateway,subnet[,dns] | :dhcp]
     int firstColon = command.indexOf(':', 8); // Skip "SET_WIFI"
     int secondColon = command.indexOf(':', firstColon + 1);
 
     if (firstColon == -1 || secondColon == -1)
     {
-        Serial.println("[CONFIG] ERROR: Invalid WiFi command format. Use: SET_WIFI:ssid:password");
+        Serial.println("[CONFIG] ERROR: Invalid WiFi command format. Use: SET_WIFI:ssid:password[:ip,gateway,subnet[,dns]]");
         return;
     }
 
     String ssid = command.substring(firstColon + 1, secondColon);
     String password = command.substring(secondColon + 1);
 
+    // Optional trailing address field; anything else stays part of the password
+    int lastColon = password.lastIndexOf(':');
+    WifiLease lease = {0, 0, 0, 0};
+    if (lastColon != -1)
+    {
+        String spec = password.substring(lastColon + 1);
+        if (spec.equalsIgnoreCase("dhcp") || parseStaticIp(spec, lease))
+            password = password.substring(0, lastColon);
+        else
+            lease = config.staticIp; // Not an address: keep the current setting
+    }
+    else
+    {
+        lease = config.staticIp;
+    }
+
+    if (ssid.length() >= sizeof(config.wifiSSID) || password.length() >= sizeof(config.wifiPassword))
+    {
+        Serial.printf("[CONFIG] ERROR: SSID is limited to %u characters, password to %u\n",
+                      (unsigned)sizeof(config.wifiSSID) - 1, (unsigned)sizeof(config.wifiPassword) - 1);
+        return;
+    }
+
     // Store in runtime variables
-    wifiSSID = ssid;
-    wifiPassword = password;
+    setField(config.wifiSSID, sizeof(config.wifiSSID), ssid.c_str());
+    setField(config.wifiPassword, sizeof(config.wifiPassword), password.c_str());
+    config.staticIp = lease;
 
     Serial.println("[CONFIG] SUCCESS: WiFi config updated - SSID: '" + ssid + "'");
+    if (config.staticIp.empty())
+        Serial.println("[CONFIG] Address: DHCP");
+    else
+        Serial.println("[CONFIG] Static IP: " + IPAddress(config.staticIp.ip).toString() + " gw " +
+                       IPAddress(config.staticIp.gateway).toString());
     Serial.println("[CONFIG] Note: Use SAVE_CONFIG to persist changes");
 }
 
+// "ip,gateway,subnet[,dns]"; dns defaults to the gateway
+bool DeviceState::parseStaticIp(const String &spec, WifiLease &lease)
+{
+    IPAddress parts[4];
+    int count = 0;
+    int start = 0;
+    while (count < 4)
+    {
+        int comma = spec.indexOf(',', start);
+        String field = comma == -1 ? spec.substring(start) : spec.substring(start, comma);
+        field.trim();
+        if (!parts[count].fromString(field))
+            return false;
+        count++;
+        if (comma == -1)
+            break;
+        start = comma + 1;
+    }
+
+    if (count < 3)
+        return false;
+
+    lease.ip = (uint32_t)parts[0];
+    lease.gateway = (uint32_t)parts[1];
+    lease.subnet = (uint32_t)parts[2];
+    lease.dns = count == 4 ? (uint32_t)parts[3] : lease.gateway;
+    return true;
+}
+
+const char *DeviceState::getWifiSSID() const
+{
+    return config.wifiSSID[0] ? config.wifiSSID : WIFI_SSID;
+}
+
+const char *DeviceState::getWifiPassword() const
+{
+    return config.wifiSSID[0] ? config.wifiPassword : WIFI_PASSWORD;
+}
+
 void DeviceState::handleDeviceConfig(const String &command)
 {
     // Parse SET_DEVICE:field:value
@@ -257,20 +399,26 @@ void DeviceState::handleDeviceConfig(const String &command)
     String value = command.substring(secondColon + 1);
 
     // Update the appropriate field
+    char *target;
+    size_t capacity;
+    const char *label;
     if (field == "DEVICE_NAME")
     {
-        deviceNameRuntime = value;
-        Serial.println("[CONFIG] SUCCESS: Device name updated to '" + value + "'");
+        target = config.deviceName;
+        capacity = sizeof(config.deviceName);
+        label = "Device name";
     }
     else if (field == "LOCATION")
     {
-        locationRuntime = value;
-        Serial.println("[CONFIG] SUCCESS: Location updated to '" + value + "'");
+        target = config.location;
+        capacity = sizeof(config.location);
+        label = "Location";
     }
     else if (field == "INSTALLATION_DATE")
     {
-        installationDateRuntime = value;
-        Serial.println("[CONFIG] SUCCESS: Installation date updated to '" + value + "'");
+        target = config.installationDate;
+        capacity = sizeof(config.installationDate);
+        label = "Installation date";
     }
     else
     {
@@ -278,6 +426,13 @@ void DeviceState::handleDeviceConfig(const String &command)
         return;
     }
 
+    if (!setField(target, capacity, value.c_str()))
+    {
+        Serial.printf("[CONFIG] ERROR: %s is limited to %u characters\n", label, (unsigned)capacity - 1);
+        return;
+    }
+    Serial.printf("[CONFIG] SUCCESS: %s updated to '%s'\n", label, target);
+
     Serial.println("[CONFIG] Note: Use SAVE_CONFIG to persist changes");
 }
 
@@ -285,72 +440,48 @@ void DeviceState::saveConfigToEEPROM()
 {
     Serial.println("[CONFIG] Saving configuration to EEPROM...");
 
-    EEPROM.begin(512); // Initialize EEPROM with 512 bytes
-
-    // Create JSON config
-    JsonDocument configDoc;
-    configDoc["wifi_ssid"] = wifiSSID;
-    configDoc["wifi_password"] = wifiPassword;
-    configDoc["device_name"] = deviceNameRuntime;
-    configDoc["location"] = locationRuntime;
-    configDoc["installation_date"] = installationDateRuntime;
-
-    // Serialize to string
-    String config;
-    serializeJson(configDoc, config);
-
-    // Write config length first
-    int configLen = config.length();
-    EEPROM.write(0, configLen & 0xFF);
-    EEPROM.write(1, (configLen >> 8) & 0xFF);
-
-    // Write config data
-    for (int i = 0; i < configLen && i < 510; i++)
+    if (!configStore.save(config))
     {
-        EEPROM.write(i + 2, config[i]);
+        Serial.println("[CONFIG] ERROR: EEPROM write failed");
+        return;
     }
 
-    EEPROM.commit();
-    EEPROM.end();
-
     Serial.println("[CONFIG] SUCCESS: Configuration saved to EEPROM");
-    Serial.println("[CONFIG] Saved: " + config);
+    Serial.printf("[CONFIG] Saved: slot %u, #%lu, SSID '%s'\n", configStore.activeSlot(),
+                  (unsigned long)configStore.sequence(), config.wifiSSID);
 }
 
 void DeviceState::loadConfigFromEEPROM()
 {
-    EEPROM.begin(512);
-
-    // Read config length
-    int configLen = EEPROM.read(0) | (EEPROM.read(1) << 8);
-
-    if (configLen > 0 && configLen < 510)
+    switch (configStore.load(config))
     {
-        // Read config data
-        String config = "";
-        for (int i = 0; i < configLen; i++)
-        {
-            config += char(EEPROM.read(i + 2));
-        }
-
-        Serial.println("[CONFIG] Loaded from EEPROM: " + config);
+    case ConfigSource::RECORD:
+        Serial.printf("[CONFIG] Loaded from EEPROM: slot %u, #%lu\n", configStore.activeSlot(),
+                      (unsigned long)configStore.sequence());
+        break;
 
-        // Parse JSON (simple parsing for key values)
-        parseConfigJSON(config);
-    }
-    else
+    case ConfigSource::LEGACY_JSON:
     {
+        // One-time conversion of the JSON layout older firmware wrote
+        char json[512];
+        size_t length = configStore.legacyJson(json, sizeof(json));
+        Serial.printf("[CONFIG] Converting %u-byte JSON config from EEPROM\n", (unsigned)length);
+        parseConfigJSON(json, length);
+        saveConfigToEEPROM();
+        break;
+    }
+
+    default:
         Serial.println("[CONFIG] No valid config found in EEPROM, using defaults");
         initializeDefaults();
+        break;
     }
-
-    EEPROM.end();
 }
 
-void DeviceState::parseConfigJSON(const String &json)
+void DeviceState::parseConfigJSON(const char *json, size_t length)
 {
     JsonDocument configDoc;
-    DeserializationError error = deserializeJson(configDoc, json);
+    DeserializationError error = deserializeJson(configDoc, json, length);
 
     if (error)
     {
@@ -360,40 +491,27 @@ void DeviceState::parseConfigJSON(const String &json)
         return;
     }
 
-    // Extract values using ArduinoJson
-    if (configDoc.containsKey("wifi_ssid"))
-    {
-        wifiSSID = configDoc["wifi_ssid"].as<String>();
-    }
-
-    if (configDoc.containsKey("wifi_password"))
-    {
-        wifiPassword = configDoc["wifi_password"].as<String>();
-    }
-
-    if (configDoc.containsKey("device_name"))
-    {
-        deviceNameRuntime = configDoc["device_name"].as<String>();
-    }
+    // Extract values using ArduinoJson; missing or too-long values stay unset
+    initializeDefaults();
+    const char *ssid = configDoc["wifi_ssid"];
+    if (ssid && strcmp(ssid, "placeholder") != 0) // Older "unset" marker
+        setField(config.wifiSSID, sizeof(config.wifiSSID), ssid);
+    setField(config.wifiPassword, sizeof(config.wifiPassword), configDoc["wifi_password"]);
 
-    if (configDoc.containsKey("location"))
+    if (configDoc.containsKey("static_ip"))
     {
-        locationRuntime = configDoc["location"].as<String>();
+        parseStaticIp(configDoc["static_ip"].as<String>(), config.staticIp);
     }
 
-    if (configDoc.containsKey("installation_date"))
-    {
-        installationDateRuntime = configDoc["installation_date"].as<String>();
-    }
+    setField(config.deviceName, sizeof(config.deviceName), configDoc["device_name"]);
+    setField(config.location, sizeof(config.location), configDoc["location"]);
+    setField(config.installationDate, sizeof(config.installationDate), configDoc["installation_date"]);
 }
 
 void DeviceState::initializeDefaults()
 {
-    wifiSSID = "placeholder";
-    wifiPassword = "placeholder";
-    deviceNameRuntime = deviceName;
-    locationRuntime = location;
-    installationDateRuntime = installationDate;
+    // All empty: env.h credentials, DHCP, env.h device info
+    memset(&config, 0, sizeof(config));
 }
 
 void DeviceState::resetConfigToDefaults()
@@ -407,12 +525,13 @@ void DeviceState::resetConfigToDefaults()
 }
 
 // Deep sleep management functions
-void DeviceState::prepareForDeepSleep(RemoteDataSource &remote)
+void DeviceState::prepareForDeepSleep(RemoteDataSource &remote, uint64_t sleepTimeUs)
 {
     Serial.println("[DEVICE] Preparing for deep sleep...");
+    stageProfiler.start(STAGE_SLEEP_ENTRY);
     
     // Update device status
-    currentStatus = "Entering Sleep";
+    linkStatus = LinkStatus::ENTERING_SLEEP;
     
     // Clean disconnect MQTT before deep sleep to prevent crashes
     Serial.println("[DEVICE] Disconnecting MQTT...");
@@ -429,15 +548,20 @@ void DeviceState::prepareForDeepSleep(RemoteDataSource &remote)
     delay(3000); // Give time for everything to shut down cleanly
     
     // Now it's safe to enter deep sleep
-    enterDeepSleep(10e6);
+    enterDeepSleep(sleepTimeUs);
 }
 
-void DeviceState::enterDeepSleep(unsigned long sleepTimeUs)
+void DeviceState::enterDeepSleep(uint64_t sleepTimeUs)
 {
-    Serial.printf("[DEVICE] Entering deep sleep for %lu seconds...\n", sleepTimeUs / 1000000);
+    Serial.printf("[DEVICE] Entering deep sleep for %lu seconds...\n", (unsigned long)(sleepTimeUs / 1000000));
     
     // Update status before sleep
-    currentStatus = "Deep Sleep";
+    linkStatus = LinkStatus::DEEP_SLEEP;
+
+    // Hand wall clock, network, token and this wake's timings to the next wake
+    wakeState.recordSleepEntry(millis(), stageProfiler.stop(STAGE_SLEEP_ENTRY));
+    memoryMonitor.save();
+    wakeState.save(timeService.now(), (uint32_t)(sleepTimeUs / 1000));
     
     // Enter deep sleep
     ESP.deepSleep(sleepTimeUs);
@@ -3,6 +3,8 @@
 #include <ESP8266WiFi.h>
 #include <ArduinoJson.h>
 #include "../../../lib/env.h"
+#include "../../hal/wifi_link.h"
+#include "../config/config_store.h"
 
 // Forward declarations
 class OtherUtils;
@@ -11,68 +13,113 @@ class RemoteDataSource;
 // Callback type
 typedef void (*StateCallback)();
 
+// Link state as the INFO output names it
+enum class LinkStatus : uint8_t
+{
+    OFFLINE,
+    ONLINE,
+    ENTERING_SLEEP,
+    DEEP_SLEEP
+};
+
+// Supply as read on A0; battery level and charging text follow from it
+enum class PowerSource : uint8_t
+{
+    UNKNOWN,
+    USB,         // Below 1.0 V: powered from the PC, no battery
+    BATTERY,     // 3.0-4.2 V
+    BATTERY_LOW, // 1.0-3.0 V
+    CHARGING     // Above 4.25 V
+};
+
 class DeviceState
 {
 public:
     DeviceState(); // Constructor
     // Constant device information
-    const String deviceName = DEVICE_NAME;
-    const String deviceType = DEVICE_TYPE;
-    const String deviceRepo = DEVICE_REPO;
-    String deviceId;
-    const String firmwareVersion = FIRMWARE_VERSION;
-    const String boardType = BOARD_TYPE;
-    const String macAddressStatic = MAC_ADDRESS;
-    const String installationDate = INSTALLATION_DATE;
-    const String location = LOCATION;
+    static constexpr const char *deviceName = DEVICE_NAME;
+    static constexpr const char *deviceType = DEVICE_TYPE;
+    static constexpr const char *deviceRepo = DEVICE_REPO;
+    char deviceId[24] = "";
+    static constexpr const char *firmwareVersion = FIRMWARE_VERSION;
+    static constexpr const char *boardType = BOARD_TYPE;
+    static constexpr const char *macAddressStatic = MAC_ADDRESS;
+    static constexpr const char *installationDate = INSTALLATION_DATE;
+    static constexpr const char *location = LOCATION;
+
+    // Sentinels for readings not taken yet
+    static const uint32_t NO_ADDRESS = 0;
+    static const int8_t NO_RSSI = 0; // Real readings are negative
 
 private:
-    // Dynamic status info
-    String currentStatus = "Offline";
-    String lastSeen = "Not available";
-    String connectionType = "Wi-Fi";
-    String ipAddress = "Not available";
-    String macAddress = "Not available";
-    String signalStrength = "Not available";
-
-    String powerSource = "Battery";
-    String batteryLevel = "Not available";
-    String chargingStatus = "Not Charging";
-    String voltageReading = "Not available";
-
-    // Runtime configuration variables
-    String wifiSSID = "placeholder";
-    String wifiPassword = "placeholder";
-    String deviceNameRuntime;
-    String locationRuntime;
-    String installationDateRuntime;
+    // Dynamic status info; formatted only when INFO asks for it
+    LinkStatus linkStatus = LinkStatus::OFFLINE;
+    uint32_t ipAddress = NO_ADDRESS;
+    int8_t rssiDbm = NO_RSSI;
+
+    PowerSource powerSource = PowerSource::BATTERY;
+    uint16_t voltageMv = 0;
+    int8_t batteryPercent = -1; // -1 on external power or unknown
+
+    // Runtime configuration
+    DeviceConfig config;
 
     StateCallback onChange = nullptr;
 
-    bool hasChanged(String oldVal, String newVal);
-    bool applyChange(String &field, const String &newVal);
+    // Plain field compare; assigns and reports a change
+    template <typename T>
+    static bool applyChange(T &field, T value)
+    {
+        if (field == value)
+            return false;
+        field = value;
+        return true;
+    }
+    // Copies into a config field; false (field untouched) if null or too long
+    static bool setField(char *field, size_t capacity, const char *value);
 
 public:
+    // Loads the saved config. Called from setup(): EEPROM is not ready
+    // during static initialization.
+    void begin();
     void updateFromSystem();
     void updatePowerStatus();
+    int8_t getBatteryPercent() const { return batteryPercent; }
+    uint16_t getVoltageMv() const { return voltageMv; }
+    int8_t getRssiDbm() const { return rssiDbm; }
     void printState();
     void addStateToJson(JsonDocument &doc);
     void setListener(StateCallback callback);
     void handleSerialCommand(const String &command);
 
+    static const char *statusName(LinkStatus status);
+    static const char *powerSourceName(PowerSource source);
+
     // Configuration management
     void handleWifiConfig(const String &command);
+    // Runtime Wi-Fi config, or the env.h credentials while unset
+    const char *getWifiSSID() const;
+    const char *getWifiPassword() const;
+    const WifiLease &getStaticIp() const { return config.staticIp; }
+    // Runtime device name, location and installation date, or env.h
+    const char *getDeviceName() const { return config.deviceName[0] ? config.deviceName : deviceName; }
+    const char *getLocation() const { return config.location[0] ? config.location : location; }
+    const char *getInstallationDate() const
+    {
+        return config.installationDate[0] ? config.installationDate : installationDate;
+    }
     void handleDeviceConfig(const String &command);
     void saveConfigToEEPROM();
     void loadConfigFromEEPROM();
     void resetConfigToDefaults();
 
     // Deep sleep management
-    void prepareForDeepSleep(RemoteDataSource &remote);
-    void enterDeepSleep(unsigned long sleepTimeUs = 300e6); // Default 5 minutes
+    void prepareForDeepSleep(RemoteDataSource &remote, uint64_t sleepTimeUs = 10e6);
+    void enterDeepSleep(uint64_t sleepTimeUs = 300e6); // Default 5 minutes
 
 private:
-    void parseConfigJSON(const String &json);
+    void parseConfigJSON(const char *json, size_t length);
+    static bool parseStaticIp(const String &spec, WifiLease &lease);
     void initializeDefaults();
 };
 
@@ -0,0 +1,207 @@
+#include "duty_cycle.h"
+#include "../memory/memory_monitor.h"
+#include "../../utils/crc32.h"
+
+#include <string.h>
+
+static_assert(sizeof(DutyRecord) % 4 == 0, "RTC memory is accessed in 4-byte blocks");
+static_assert(DUTY_CYCLE_RTC_OFFSET + sizeof(DutyRecord) <= MEMORY_MONITOR_RTC_OFFSET,
+              "DutyRecord runs into the memory watermark block");
+static_assert(DUTY_MAX_SLEEP_S <= 0xFFFF, "DutyRecord holds sleeps in 16 bits");
+
+DutyCycle dutyCycle(rtcStorage(), DUTY_CYCLE_RTC_OFFSET);
+
+DutyCycle::DutyCycle(Storage &storage, size_t offset, Clock &clock) : rtc(storage), clock(clock), offset(offset)
+{
+    memset(&record, 0, sizeof(record));
+}
+
+uint32_t DutyCycle::checksum() const
+{
+    return crc32(&record, offsetof(DutyRecord, crc));
+}
+
+void DutyCycle::write()
+{
+    record.crc = checksum();
+    rtc.write(offset, &record, sizeof(record));
+    rtc.commit();
+}
+
+bool DutyCycle::restore()
+{
+    bool restored = rtc.read(offset, &record, sizeof(record)) && record.magic == DutyRecord::MAGIC &&
+                    record.version == DutyRecord::VERSION && record.length == sizeof(DutyRecord) &&
+                    record.crc == checksum();
+    if (!restored)
+    {
+        memset(&record, 0, sizeof(record));
+        record.magic = DutyRecord::MAGIC;
+        record.version = DutyRecord::VERSION;
+        record.length = sizeof(DutyRecord);
+    }
+    return restored;
+}
+
+uint32_t DutyCycle::windowMs() const
+{
+    return record.windowS ? record.windowS * 1000UL : TELEMETRY_WINDOW_MS;
+}
+
+uint8_t DutyCycle::windowsPerBatch() const
+{
+    return record.windows ? record.windows : TELEMETRY_BATCH_SIZE;
+}
+
+uint32_t DutyCycle::maxSleepS()
+{
+    uint64_t limitS = clock.deepSleepMaxUs() / 1000000ULL;
+    return limitS < DUTY_MAX_SLEEP_S ? (uint32_t)limitS : DUTY_MAX_SLEEP_S;
+}
+
+bool DutyCycle::setBounds(uint32_t minS, uint32_t maxS)
+{
+    uint32_t ceiling = maxSleepS();
+    bool trimmed = minS > ceiling || maxS > ceiling;
+    if (minS > ceiling)
+        minS = ceiling;
+    if (maxS > ceiling)
+        maxS = ceiling;
+    if (maxS && minS > maxS)
+        minS = maxS;
+    record.boundMinS = (uint16_t)minS;
+    record.boundMaxS = (uint16_t)maxS;
+    write();
+    return !trimmed;
+}
+
+uint32_t DutyCycle::clamp(uint32_t sleepS)
+{
+    uint32_t low = record.boundMinS > DUTY_MIN_SLEEP_S ? record.boundMinS : DUTY_MIN_SLEEP_S;
+    uint32_t high = maxSleepS();
+    if (record.boundMaxS && record.boundMaxS < high)
+        high = record.boundMaxS;
+    if (low > high)
+        low = high;
+
+    if (sleepS < low)
+        return low;
+    return sleepS > high ? high : sleepS;
+}
+
+float DutyCycle::bpmSpread(const TelemetryBatch &batch)
+{
+    float low = 0, high = 0;
+    bool any = false;
+    for (uint8_t i = 0; i < batch.count; i++)
+    {
+        const VitalSummary &bpm = batch.windows[i].bpm;
+        if (bpm.count == 0)
+            continue;
+        if (!any || bpm.mean < low)
+            low = bpm.mean;
+        if (!any || bpm.mean > high)
+            high = bpm.mean;
+        any = true;
+    }
+    return high - low;
+}
+
+DutyDecision DutyCycle::decide(const TelemetryBatch &batch, float temperature, const DutyInputs &inputs,
+                               uint32_t awakeMs)
+{
+    // Temperature trend per hour across wakes, smoothed over two cycles
+    int16_t centi = temperature > 30.0f ? (int16_t)(temperature * 100.0f + 0.5f) : 0;
+    if (centi && record.lastTemperature)
+    {
+        uint32_t cycleMs = record.sleepS * 1000UL + record.cycleMs;
+        if (cycleMs > 0)
+        {
+            float perHour = (centi - record.lastTemperature) * 3600000.0f / cycleMs;
+            float trend = (record.trend + perHour) / 2;
+            record.trend = (int16_t)(trend > 2000 ? 2000 : trend < -2000 ? -2000 : trend);
+        }
+    }
+    if (centi)
+        record.lastTemperature = centi;
+
+    record.failedSends = inputs.delivered ? 0 : (record.failedSends < 8 ? record.failedSends + 1 : 8);
+
+    float projected = temperature + record.trend / 100.0f * DUTY_TREND_HORIZON_S / 3600.0f;
+    bool feverish = centi && (temperature >= DUTY_FEVER_C || projected >= DUTY_FEVER_C);
+    bool unsettled = bpmSpread(batch) >= DUTY_BPM_SPREAD;
+    record.stableCycles = feverish || unsettled ? 0 : (record.stableCycles < 4 ? record.stableCycles + 1 : 4);
+
+    DutyDecision decision;
+    decision.windowMs = TELEMETRY_WINDOW_MS;
+    decision.windowsPerBatch = TELEMETRY_BATCH_SIZE;
+    uint32_t sleepS;
+
+    if (feverish)
+    {
+        sleepS = DUTY_ALERT_SLEEP_S;
+        decision.windowMs = DUTY_SHORT_WINDOW_MS;
+        decision.reason = "fever";
+    }
+    else if (unsettled)
+    {
+        sleepS = DUTY_BASE_SLEEP_S / 2;
+        decision.windowMs = DUTY_SHORT_WINDOW_MS;
+        decision.reason = "unsettled";
+    }
+    else
+    {
+        // Each stable cycle doubles the sleep; a settled animal is covered
+        // by half as many, longer windows
+        sleepS = DUTY_BASE_SLEEP_S << (record.stableCycles > 1 ? record.stableCycles - 1 : 0);
+        if (record.stableCycles > 1)
+        {
+            decision.windowMs = DUTY_LONG_WINDOW_MS;
+            decision.windowsPerBatch = (TELEMETRY_BATCH_SIZE + 1) / 2;
+        }
+        decision.reason = "stable";
+    }
+
+    // Link down: the telemetry log keeps the data, so back off instead of
+    // paying for a handshake that will fail again
+    if (record.failedSends)
+    {
+        uint8_t shift = record.failedSends < 3 ? record.failedSends : 3;
+        sleepS <<= shift;
+        if (feverish && sleepS > DUTY_BASE_SLEEP_S)
+            sleepS = DUTY_BASE_SLEEP_S;
+        decision.reason = "link down";
+    }
+    else if (inputs.rssi != 0 && inputs.rssi < DUTY_WEAK_RSSI_DBM)
+    {
+        // Every send costs more air time: fewer, fuller messages
+        sleepS = sleepS * 3 / 2;
+        decision.windowsPerBatch = TELEMETRY_BATCH_SIZE;
+        decision.reason = "weak link";
+    }
+
+    if (inputs.batteryPercent >= 0 && inputs.batteryPercent < DUTY_CRITICAL_BATTERY_PERCENT)
+    {
+        // Staying alive beats everything, fever included
+        sleepS = DUTY_MAX_SLEEP_S;
+        decision.windowMs = DUTY_LONG_WINDOW_MS;
+        decision.windowsPerBatch = (TELEMETRY_BATCH_SIZE + 3) / 4;
+        decision.reason = "battery critical";
+    }
+    else if (inputs.batteryPercent >= 0 && inputs.batteryPercent < DUTY_LOW_BATTERY_PERCENT && !feverish)
+    {
+        // Fewer, longer windows: less time awake for a similar average
+        sleepS *= 2;
+        decision.windowMs = DUTY_LONG_WINDOW_MS;
+        decision.windowsPerBatch = (TELEMETRY_BATCH_SIZE + 1) / 2;
+        decision.reason = "battery low";
+    }
+
+    decision.sleepS = clamp(sleepS);
+    record.sleepS = (uint16_t)decision.sleepS;
+    record.cycleMs = awakeMs;
+    record.windowS = (uint16_t)(decision.windowMs / 1000);
+    record.windows = decision.windowsPerBatch;
+    write();
+    return decision;
+}
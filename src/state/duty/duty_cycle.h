@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+#include "../../data/telemetry_batch.h"
+
+// RTC offset of the policy block, after the TLS session block
+#ifndef DUTY_CYCLE_RTC_OFFSET
+#define DUTY_CYCLE_RTC_OFFSET 384
+#endif
+
+// Sleep between wakes, s. setSleepInterval narrows [min, max] further; the
+// max is also capped by how long the RTC timer can sleep.
+#ifndef DUTY_MIN_SLEEP_S
+#define DUTY_MIN_SLEEP_S 10
+#endif
+#ifndef DUTY_BASE_SLEEP_S
+#define DUTY_BASE_SLEEP_S 300
+#endif
+#ifndef DUTY_MAX_SLEEP_S
+#define DUTY_MAX_SLEEP_S 3600
+#endif
+
+// Sleep while at or heading for fever
+#ifndef DUTY_ALERT_SLEEP_S
+#define DUTY_ALERT_SLEEP_S 120
+#endif
+
+// Window lengths: short while feverish or unsettled for finer readings,
+// long while stable or saving battery to average out noise over fewer
+// windows
+#ifndef DUTY_SHORT_WINDOW_MS
+#define DUTY_SHORT_WINDOW_MS (TELEMETRY_WINDOW_MS / 2)
+#endif
+#ifndef DUTY_LONG_WINDOW_MS
+#define DUTY_LONG_WINDOW_MS (TELEMETRY_WINDOW_MS * 2)
+#endif
+
+// Core temperature (°C) treated as fever, and how far ahead the trend is
+// extrapolated when deciding whether it is heading there
+#ifndef DUTY_FEVER_C
+#define DUTY_FEVER_C 39.5f
+#endif
+#ifndef DUTY_TREND_HORIZON_S
+#define DUTY_TREND_HORIZON_S 3600
+#endif
+
+// Spread of window BPM means (max - min) above which a cycle is unsettled
+#ifndef DUTY_BPM_SPREAD
+#define DUTY_BPM_SPREAD 12.0f
+#endif
+
+// Below these the device saves power before anything else
+#ifndef DUTY_LOW_BATTERY_PERCENT
+#define DUTY_LOW_BATTERY_PERCENT 25
+#endif
+#ifndef DUTY_CRITICAL_BATTERY_PERCENT
+#define DUTY_CRITICAL_BATTERY_PERCENT 10
+#endif
+#ifndef DUTY_WEAK_RSSI_DBM
+#define DUTY_WEAK_RSSI_DBM -80
+#endif
+
+// Policy state carried across deep sleep, after TlsSessionRecord
+struct DutyRecord
+{
+    static const uint32_t MAGIC = 0x44555459; // "DUTY"
+    static const uint16_t VERSION = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+
+    int16_t lastTemperature; // Centi-°C, 0 = none yet
+    int16_t trend;           // Centi-°C per hour, smoothed
+    uint16_t boundMinS;      // From setSleepInterval, 0 = none
+    uint16_t boundMaxS;
+    uint16_t sleepS;         // Decided for the sleep just taken
+    uint8_t stableCycles;
+    uint8_t failedSends;
+    uint32_t cycleMs;        // Awake time of the last cycle
+
+    // Measurement for the next wake
+    uint16_t windowS;
+    uint8_t windows;
+    uint8_t reserved;
+
+    uint32_t crc;
+};
+
+// What the policy looks at besides the cycle's vitals
+struct DutyInputs
+{
+    int8_t batteryPercent; // -1 = external power or unknown
+    int8_t rssi;           // dBm, 0 = not connected
+    bool delivered;        // The cycle was acknowledged
+};
+
+struct DutyDecision
+{
+    uint32_t sleepS;
+    uint32_t windowMs;
+    uint8_t windowsPerBatch;
+    const char *reason;
+};
+
+// Picks the next deep-sleep length and window length from the vitals just
+// measured, the battery, the link and whether the send went through:
+// short sleeps and windows while the temperature is at or heading for
+// fever or the readings are unsettled, a sleep that grows with each stable
+// cycle, and longer sleeps and windows on a low battery or a link that
+// keeps failing. Bounds
+// from the setSleepInterval direct method always win. State lives in RTC
+// memory so the trend and streaks survive deep sleep.
+class DutyCycle
+{
+private:
+    Storage &rtc;
+    Clock &clock;
+    size_t offset;
+    DutyRecord record;
+
+    uint32_t checksum() const;
+    void write();
+    uint32_t clamp(uint32_t sleepS);
+
+public:
+    DutyCycle(Storage &storage, size_t offset, Clock &clock = systemClock());
+
+    // Loads the block left before the last sleep; false on cold boot
+    bool restore();
+
+    // Window length and batch size for this wake, from the last decision
+    uint32_t windowMs() const;
+    uint8_t windowsPerBatch() const;
+
+    // Decides the sleep after a cycle and saves the state
+    DutyDecision decide(const TelemetryBatch &batch, float temperature, const DutyInputs &inputs,
+                        uint32_t awakeMs);
+
+    // Longest sleep the policy may pick: DUTY_MAX_SLEEP_S, or less if
+    // the RTC timer cannot time that long
+    uint32_t maxSleepS();
+
+    // setSleepInterval: both 0 clears the bounds. Bounds past maxSleepS()
+    // are trimmed to it; false if any was.
+    bool setBounds(uint32_t minS, uint32_t maxS);
+    uint32_t boundMin() const { return record.boundMinS; }
+    uint32_t boundMax() const { return record.boundMaxS; }
+
+    // Max - min of the window BPM means with a reading
+    static float bpmSpread(const TelemetryBatch &batch);
+};
+
+extern DutyCycle dutyCycle;
@@ -1,8 +1,6 @@
 #include "job_state.h"
 #include "../sensor/sensor_state.h"
-#include "../device/device_state.h"
 
-// Forward declarations - both states are defined in their respective .cpp files
+// Forward declaration - sensor state is defined in its own .cpp file
 extern SensorState sensorState;
-extern DeviceState deviceState;
-JobState jobState(sensorState, deviceState);
+JobState jobState(sensorState);
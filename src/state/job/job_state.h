@@ -1,36 +1,74 @@
 // job_state.h
 #pragma once
 
-#include <Arduino.h>
+#include <stdint.h>
 #include "../sensor/sensor_state.h"
-#include "../device/device_state.h"
-#include "../../utils/others.h"
-#include "../../data/remote_datasource.h"
+#include "../../hal/hal.h"
+#include "../../utils/running_stats.h"
+#include "../../data/telemetry_batch.h"
+#include "../../utils/trace.h"
+
+// Posted by JobState::tick() when a batch of windows is complete and taken
+// by SendState in the send task
+struct CompletedCycle
+{
+    TelemetryBatch batch;
+    // Means over the cycle, for the single-reading message
+    float bpm;
+    float temperature;
+    float spO2;
+};
 
 class JobState
 {
 private:
-    float bpmBuffer[50];
-    float tempBuffer[50];
-    int index = 0;
-    int minute = 0;
+    uint32_t windowMs = TELEMETRY_WINDOW_MS;
+    uint8_t batchSize = TELEMETRY_BATCH_SIZE;
+
+    uint32_t windowStartMs = 0;
+
+    // Current window, fed with every queued sample. 0 BPM means no finger
+    // and 0 SpO2 means no estimate, so those are skipped.
+    RunningStats bpmWindow{true};
+    RunningStats tempWindow;
+    RunningStats spo2Window{true};
 
-    float bpmAvgPerMinute[5];
-    float tempAvgPerMinute[5];
+    // Whole wake cycle, fed with one mean per window
+    RunningStats bpmCycle{true};
+    RunningStats tempCycle;
+    RunningStats spo2Cycle{true};
+
+    TelemetryBatch batch;
+
+    // One-slot mailbox between the job and send tasks; a cycle not taken
+    // before the next one completes is overwritten
+    CompletedCycle completed;
+    volatile bool completedReady = false;
 
     bool active = false;
+    uint32_t droppedSeen = 0; // Sample ring drops already traced
 
-    // Add reference to sensor state and device state
+    // Add reference to sensor state and the platform clock
     SensorState &sensorState;
-    DeviceState &deviceState;
+    Clock &clock;
 
 public:
-    // Constructor to initialize sensor state and device state references
-    JobState(SensorState &sensor, DeviceState &device) : sensorState(sensor), deviceState(device) {}
+    // Constructor to initialize sensor state reference
+    JobState(SensorState &sensor, Clock &clk = systemClock()) : sensorState(sensor), clock(clk) {}
 
     // begin the job state
     void begin() { reset(); }
 
+    // Window length and windows per message; the batch size is capped by
+    // TELEMETRY_BATCH_SIZE, which sizes the buffer
+    void configure(uint32_t windowLengthMs, uint8_t windowsPerBatch)
+    {
+        windowMs = windowLengthMs;
+        batchSize = windowsPerBatch < TelemetryBatch::CAPACITY ? windowsPerBatch : TelemetryBatch::CAPACITY;
+        if (batchSize == 0)
+            batchSize = 1;
+    }
+
     // start the job state
     void startJob()
     {
@@ -38,101 +76,123 @@ public:
         reset();
     }
 
+    // Stop folding samples, e.g. before deep sleep
+    void stop() { active = false; }
+
     // reset the job state
     void reset()
     {
-        index = 0;
-        minute = 0;
-        readyForSleep = false;
-        memset(bpmBuffer, 0, sizeof(bpmBuffer));
-        memset(tempBuffer, 0, sizeof(tempBuffer));
-        memset(bpmAvgPerMinute, 0, sizeof(bpmAvgPerMinute));
-        memset(tempAvgPerMinute, 0, sizeof(tempAvgPerMinute));
+        completedReady = false;
+        windowStartMs = clock.millis();
+        bpmWindow.reset();
+        tempWindow.reset();
+        spo2Window.reset();
+        bpmCycle.reset();
+        tempCycle.reset();
+        spo2Cycle.reset();
+        batch.clear();
+        batch.windowMs = windowMs;
+        sensorState.clearSamples();
     }
 
-    // tick the job state
-    void tick(RemoteDataSource &remote)
+    // tick the job state. Runs as the job task, so it only folds samples
+    // and posts a finished batch; the send task sends it.
+    void tick()
     {
         if (!active)
             return;
 
-        // Read current sensor state
-        bpmBuffer[index] = sensorState.getBPM();
-        tempBuffer[index] = sensorState.getTemperature();
-        index++;
-        Serial.printf("BPM: %.2f, Temp: %.2f\n", bpmBuffer[index - 1], tempBuffer[index - 1]);
+        // Fold everything the sensor task queued since the last tick into the window
+        int count = 0;
+        VitalSample sample;
+        while (sensorState.popSample(sample))
+        {
+            bpmWindow.add(sample.bpm);
+            tempWindow.add(sample.temperature);
+            spo2Window.add(sample.spO2);
+            count++;
+        }
 
-        // Check if we have enough data for a minute
-        if (index >= 50)
+        if (count == 0)
+        {
+            // Nothing new queued, fall back to the latest state
+            bpmWindow.add(sensorState.getBPM());
+            tempWindow.add(sensorState.getTemperature());
+            spo2Window.add(sensorState.getSpO2());
+        }
+        TRACE(JOB_TICK, bpmWindow.mean(), tempWindow.mean(), spo2Window.mean(), count);
+        if (sensorState.droppedSamples() != droppedSeen)
         {
-            // Calculate average for the minute - FIX: use all 50 samples, not just 10
-            bpmAvgPerMinute[minute] = OtherUtils::getAverage(bpmBuffer, 50);
-            tempAvgPerMinute[minute] = OtherUtils::getAverage(tempBuffer, 50);
-
-            Serial.printf("[Minute %d] BPM Avg: %.2f, Temp Avg: %.2f\n", minute + 1, bpmAvgPerMinute[minute], tempAvgPerMinute[minute]);
-
-            index = 0;
-            minute++;
-
-            // Final calculation and send data
-            int nOfMinute = 1;
-            if (minute >= nOfMinute)
-            {
-                float finalBPM = OtherUtils::getAverage(bpmAvgPerMinute, nOfMinute);
-                float finalTemp = OtherUtils::getAverage(tempAvgPerMinute, nOfMinute);
-                Serial.printf("Final BPM: %.2f, Final Temp: %.2f\n", finalBPM, finalTemp);
-
-                // Try to send data with timeout protection
-                unsigned long startTime = millis();
-                bool dataSent = false;
-
-                // Attempt to connect and send data with 10 second timeout
-                while (millis() - startTime < 10000 && !dataSent)
-                {
-                    if (remote.connect())
-                    {
-                        dataSent = remote.sendData(finalBPM, finalTemp, 98.0);
-                        Serial.println("Data sent successfully");
-                    }
-                    else
-                    {
-                        Serial.println("Failed to connect, retrying...");
-                        delay(1000);
-                    }
-                }
-
-                if (!dataSent)
-                {
-                    Serial.println("Failed to send data within timeout");
-                }
-
-                // Mark as ready for deep sleep but don't call it directly from here
-                active = false;
-                readyForSleep = true;
-                Serial.println("Data collection complete. Ready for deep sleep...");
-            }
+            droppedSeen = sensorState.droppedSamples();
+            TRACE(JOB_SAMPLES_DROPPED, droppedSeen);
         }
+
+        // Check if the window is complete
+        uint32_t now = clock.millis();
+        if (now - windowStartMs < windowMs)
+            return;
+
+        closeWindow(now);
+
+        if (batch.full(batchSize))
+            post();
     }
 
-    // Check if ready for deep sleep
-    bool isReadyForSleep() const
+    // Hands over the last completed cycle, once
+    bool takeCompleted(CompletedCycle &out)
     {
-        return readyForSleep;
+        if (!completedReady)
+            return false;
+        out = completed;
+        completedReady = false;
+        return true;
     }
 
-    // Prepare for deep sleep using DeviceState (to be called from main loop)
-    void prepareForDeepSleep(RemoteDataSource &remote)
+    bool hasCompleted() const { return completedReady; }
+
+    // Cycles replaced in the mailbox before the send task took them
+    uint32_t overwrittenCycles = 0;
+
+private:
+
+    void closeWindow(uint32_t now)
     {
-        if (!readyForSleep)
-            return;
+        TRACE(JOB_WINDOW, batch.count + 1, bpmWindow.mean(), bpmWindow.stddev(), tempWindow.mean());
 
-        Serial.println("[JOB] Job complete, delegating sleep preparation to DeviceState...");
+        batch.add(windowStartMs, bpmWindow, tempWindow, spo2Window);
 
-        // Use DeviceState to handle the deep sleep preparation
-        deviceState.prepareForDeepSleep(remote);
-        // This line should never be reached as ESP.deepSleep() resets the device
+        // An empty window adds 0, which the cycle skips like a sample
+        bpmCycle.add(bpmWindow.mean());
+        tempCycle.add(tempWindow.mean());
+        spo2Cycle.add(spo2Window.mean());
+
+        bpmWindow.reset();
+        tempWindow.reset();
+        spo2Window.reset();
+        windowStartMs = now;
     }
 
-private:
-    bool readyForSleep = false;
+    // Posts the batch and starts the next one; sampling carries on while
+    // the send task sends
+    void post()
+    {
+        if (completedReady)
+            overwrittenCycles++;
+
+        completed.batch = batch;
+        completed.bpm = bpmCycle.mean();
+        completed.temperature = tempCycle.mean();
+        completed.spO2 = spo2Cycle.mean();
+        completedReady = true;
+        TRACE(JOB_POSTED, completed.bpm, completed.temperature, completed.spO2, batch.count);
+
+        batch.clear();
+        batch.windowMs = windowMs;
+        bpmCycle.reset();
+        tempCycle.reset();
+        spo2Cycle.reset();
+    }
 };
+
+// Singleton instance
+extern JobState jobState;
@@ -0,0 +1,123 @@
+#include "memory_monitor.h"
+#include "../../utils/crc32.h"
+#include "../../utils/trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(MemoryRecord) % 4 == 0, "RTC memory is accessed in 4-byte blocks");
+static_assert(MEMORY_MONITOR_RTC_OFFSET + sizeof(MemoryRecord) <= 512, "MemoryRecord runs past the RTC user area");
+
+MemoryMonitor memoryMonitor(systemMemory(), rtcStorage(), MEMORY_MONITOR_RTC_OFFSET);
+
+static const char *const CHECKPOINT_NAMES[MEM_CHECKPOINT_COUNT] = {"tls", "token", "publish"};
+
+MemoryMonitor::MemoryMonitor(MemoryInfo &memory, Storage &storage, size_t offset)
+    : memory(memory), rtc(storage), offset(offset)
+{
+    memset(&record, 0, sizeof(record));
+    memset(wake, 0, sizeof(wake));
+}
+
+const char *MemoryMonitor::name(MemoryCheckpoint checkpoint)
+{
+    return checkpoint < MEM_CHECKPOINT_COUNT ? CHECKPOINT_NAMES[checkpoint] : "?";
+}
+
+uint32_t MemoryMonitor::checksum() const
+{
+    return crc32(&record, offsetof(MemoryRecord, crc));
+}
+
+static uint16_t clamp16(uint32_t value)
+{
+    return value < 0xFFFF ? (uint16_t)value : 0xFFFF;
+}
+
+void MemoryMonitor::fold(MemoryWatermark &mark, const MemorySnapshot &snapshot)
+{
+    uint16_t heap = clamp16(snapshot.freeHeap);
+    uint16_t block = clamp16(snapshot.maxFreeBlock);
+    uint16_t stack = clamp16(snapshot.freeStack);
+
+    if (!mark.seen || heap < mark.freeHeap)
+        mark.freeHeap = heap;
+    if (!mark.seen || block < mark.maxFreeBlock)
+        mark.maxFreeBlock = block;
+    if (!mark.seen || stack < mark.freeStack)
+        mark.freeStack = stack;
+    if (!mark.seen || snapshot.fragmentation > mark.fragmentation)
+        mark.fragmentation = snapshot.fragmentation;
+    mark.seen = 1;
+}
+
+bool MemoryMonitor::restore()
+{
+    bool restored = rtc.read(offset, &record, sizeof(record)) && record.magic == MemoryRecord::MAGIC &&
+                    record.version == MemoryRecord::VERSION && record.length == sizeof(MemoryRecord) &&
+                    record.crc == checksum();
+    if (!restored)
+    {
+        memset(&record, 0, sizeof(record));
+        record.magic = MemoryRecord::MAGIC;
+        record.version = MemoryRecord::VERSION;
+        record.length = sizeof(MemoryRecord);
+    }
+    return restored;
+}
+
+void MemoryMonitor::write()
+{
+    record.magic = MemoryRecord::MAGIC;
+    record.version = MemoryRecord::VERSION;
+    record.length = sizeof(MemoryRecord);
+    record.crc = checksum();
+    rtc.write(offset, &record, sizeof(record));
+    rtc.commit();
+}
+
+void MemoryMonitor::save()
+{
+    record.wakes++;
+    write();
+}
+
+void MemoryMonitor::clear()
+{
+    memset(wake, 0, sizeof(wake));
+    memset(&record, 0, sizeof(record));
+    write();
+}
+
+MemorySnapshot MemoryMonitor::checkpoint(MemoryCheckpoint checkpoint)
+{
+    MemorySnapshot snapshot = memory.snapshot();
+    fold(wake[checkpoint], snapshot);
+    fold(record.worst[checkpoint], snapshot);
+    TRACE(MEM_CHECKPOINT, (uint8_t)checkpoint, snapshot.freeHeap, snapshot.maxFreeBlock, snapshot.freeStack);
+    return snapshot;
+}
+
+size_t MemoryMonitor::formatJson(char *out, size_t capacity, bool acrossWakes) const
+{
+    const MemoryWatermark *marks = acrossWakes ? record.worst : wake;
+    int used = snprintf(out, capacity, "{");
+    bool first = true;
+
+    for (uint8_t i = 0; i < MEM_CHECKPOINT_COUNT && used > 0 && (size_t)used < capacity; i++)
+    {
+        const MemoryWatermark &mark = marks[i];
+        if (!mark.seen)
+            continue;
+        used += snprintf(out + used, capacity - used, "%s\"%s\":[%u,%u,%u,%u]", first ? "" : ",",
+                         name((MemoryCheckpoint)i), mark.freeHeap, mark.maxFreeBlock, mark.fragmentation,
+                         mark.freeStack);
+        first = false;
+    }
+
+    if (used > 0 && (size_t)used < capacity)
+        used += snprintf(out + used, capacity - used, "}");
+    if (used <= 0 || (size_t)used >= capacity)
+        return 0;
+    return (size_t)used;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+
+// RTC offset of the watermark block, after DutyRecord
+#ifndef MEMORY_MONITOR_RTC_OFFSET
+#define MEMORY_MONITOR_RTC_OFFSET 416
+#endif
+
+// Points in the wake where memory is at its tightest
+enum MemoryCheckpoint : uint8_t
+{
+    MEM_TLS_CONNECT, // TLS buffers and session allocated
+    MEM_TOKEN,       // After signing or fetching the SAS token
+    MEM_PUBLISH,     // Payload handed to the in-flight window
+    MEM_CHECKPOINT_COUNT
+};
+
+// Worst values seen at one checkpoint. 16 bits is plenty on the ESP8266
+// (about 50 KB of heap, 4 KB of cont stack).
+struct MemoryWatermark
+{
+    uint16_t freeHeap;     // Lowest
+    uint16_t maxFreeBlock; // Lowest
+    uint16_t freeStack;    // Lowest
+    uint8_t fragmentation; // Highest
+    uint8_t seen;          // 0 until the checkpoint is first reached
+};
+
+// Watermarks across wakes, after DutyRecord in RTC memory
+struct MemoryRecord
+{
+    static const uint32_t MAGIC = 0x4D454D57; // "MEMW"
+    static const uint16_t VERSION = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t wakes; // Wakes folded into the watermarks
+
+    MemoryWatermark worst[MEM_CHECKPOINT_COUNT];
+
+    uint32_t crc;
+};
+
+// Low-water marks of free heap, largest free block and free stack, and the
+// high-water mark of fragmentation, at each checkpoint. Kept for this wake
+// and, in RTC memory, across wakes since the last cold boot or clear().
+class MemoryMonitor
+{
+private:
+    MemoryInfo &memory;
+    Storage &rtc;
+    size_t offset;
+    MemoryRecord record;
+    MemoryWatermark wake[MEM_CHECKPOINT_COUNT];
+
+    uint32_t checksum() const;
+    void write();
+    static void fold(MemoryWatermark &mark, const MemorySnapshot &snapshot);
+
+public:
+    MemoryMonitor(MemoryInfo &memory, Storage &storage, size_t offset);
+
+    static const char *name(MemoryCheckpoint checkpoint);
+
+    // Loads the watermarks left before the last sleep; false on cold boot
+    bool restore();
+    // Writes them back, this wake included. Call before deep sleep.
+    void save();
+    // Forgets every watermark, in RTC memory too
+    void clear();
+
+    MemorySnapshot checkpoint(MemoryCheckpoint checkpoint);
+
+    const MemoryWatermark &thisWake(MemoryCheckpoint checkpoint) const { return wake[checkpoint]; }
+    const MemoryWatermark &worst(MemoryCheckpoint checkpoint) const { return record.worst[checkpoint]; }
+    uint32_t wakes() const { return record.wakes; }
+
+    // {"tls":[heap,block,frag,stack],..} for the checkpoints reached, from
+    // this wake or across wakes. Returns the length, 0 if it did not fit.
+    size_t formatJson(char *out, size_t capacity, bool acrossWakes) const;
+};
+
+extern MemoryMonitor memoryMonitor;
@@ -0,0 +1,120 @@
+#include "send_state.h"
+
+#include "../../utils/trace.h"
+
+SendState sendState(jobState);
+
+SendState::SendState(JobState &job, Clock &clock) : job(job), clock(clock)
+{
+}
+
+void SendState::enter(State next)
+{
+    uint32_t now = clock.millis();
+    phaseMs[(uint8_t)current] += now - phaseStartedMs;
+    TRACE(SEND_STATE, (uint8_t)current, (uint8_t)next, now - phaseStartedMs);
+
+    current = next;
+    phaseStartedMs = now;
+}
+
+void SendState::publish(TelemetrySink &sink)
+{
+#if TELEMETRY_BATCHING
+    bool queued = sink.sendBatch(cycle.batch);
+#else
+    bool queued = sink.sendData(cycle.bpm, cycle.temperature, cycle.spO2);
+#endif
+
+    // Not connected, the sink logged it for later: nothing to wait for
+    if (queued && sink.connected())
+    {
+        enter(State::AWAIT_ACK);
+        return;
+    }
+    if (!queued)
+        HAL_LOG("[SEND] Cycle could not be queued\n");
+    enter(State::DONE);
+}
+
+SendState::State SendState::tick(TelemetrySink &sink)
+{
+    uint32_t now = clock.millis();
+    uint32_t elapsed = now - phaseStartedMs;
+
+    switch (current)
+    {
+    case State::IDLE:
+    case State::DONE:
+        // DONE only ends this cycle; loop() decides on sleep through
+        // readyForSleep(). A cycle the job task completed meanwhile is sent
+        // first.
+        if (job.takeCompleted(cycle))
+        {
+            for (uint32_t &ms : phaseMs)
+                ms = 0;
+            connectTried = false;
+            enter(State::WAIT_NETWORK);
+        }
+        break;
+
+    case State::WAIT_NETWORK:
+        if (sink.networkReady())
+        {
+            enter(State::CONNECTING);
+        }
+        else if (elapsed >= SEND_NETWORK_TIMEOUT_MS)
+        {
+            HAL_LOG("[SEND] No network after %lu ms\n", (unsigned long)elapsed);
+            timeouts++;
+            enter(State::PUBLISHING);
+        }
+        break;
+
+    case State::CONNECTING:
+        if (sink.connected())
+        {
+            enter(State::PUBLISHING);
+        }
+        else if (elapsed >= SEND_CONNECT_TIMEOUT_MS)
+        {
+            HAL_LOG("[SEND] MQTT connect timed out after %lu ms\n", (unsigned long)elapsed);
+            timeouts++;
+            enter(State::PUBLISHING);
+        }
+        else if (!connectTried || now - lastConnectMs >= SEND_CONNECT_RETRY_MS)
+        {
+            // One attempt per tick; the TLS handshake itself still blocks
+            connectTried = true;
+            lastConnectMs = now;
+            sink.connect(1);
+        }
+        break;
+
+    case State::PUBLISHING:
+        publish(sink);
+        break;
+
+    case State::AWAIT_ACK:
+        if (sink.allDelivered())
+        {
+            delivered++;
+            enter(State::DONE);
+        }
+        else if (elapsed >= SEND_ACK_TIMEOUT_MS)
+        {
+            HAL_LOG("[SEND] Not acknowledged after %lu ms\n", (unsigned long)elapsed);
+            timeouts++;
+            enter(State::DONE);
+        }
+        break;
+    }
+    return current;
+}
+
+void SendState::printTimings() const
+{
+    HAL_LOG("[SEND] network %lu ms, connect %lu ms, publish %lu ms, ack %lu ms\n",
+            (unsigned long)phaseMs[(uint8_t)State::WAIT_NETWORK], (unsigned long)phaseMs[(uint8_t)State::CONNECTING],
+            (unsigned long)phaseMs[(uint8_t)State::PUBLISHING], (unsigned long)phaseMs[(uint8_t)State::AWAIT_ACK]);
+}
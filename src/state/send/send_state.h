@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+#include "../../data/telemetry_sink.h"
+#include "../job/job_state.h"
+
+// Wi-Fi join and SNTP, from the cycle being posted
+#ifndef SEND_NETWORK_TIMEOUT_MS
+#define SEND_NETWORK_TIMEOUT_MS 20000
+#endif
+
+// MQTT connect, one attempt every SEND_CONNECT_RETRY_MS
+#ifndef SEND_CONNECT_TIMEOUT_MS
+#define SEND_CONNECT_TIMEOUT_MS 20000
+#endif
+#ifndef SEND_CONNECT_RETRY_MS
+#define SEND_CONNECT_RETRY_MS 1000
+#endif
+
+// PUBACKs for everything published
+#ifndef SEND_ACK_TIMEOUT_MS
+#define SEND_ACK_TIMEOUT_MS 10000
+#endif
+
+// Sends what JobState posts without blocking the scheduler: each tick()
+// checks the current state once and moves on, so sampling, MQTT keep-alive
+// and serial commands keep running while a send is in progress. Every state
+// has its own timeout; a batch that cannot be delivered in time is still
+// handed to the sink, which keeps it in the telemetry log for the next
+// wake.
+class SendState
+{
+public:
+    enum class State : uint8_t
+    {
+        IDLE,         // Waiting for a completed cycle
+        WAIT_NETWORK, // Wi-Fi join and time sync
+        CONNECTING,
+        PUBLISHING,
+        AWAIT_ACK,
+        DONE // Cycle delivered or given up on; sleep is loop()'s call
+    };
+
+private:
+    static const uint8_t STATE_COUNT = 6;
+
+    JobState &job;
+    Clock &clock;
+    CompletedCycle cycle;
+
+    State current = State::IDLE;
+    uint32_t phaseStartedMs = 0;
+    uint32_t lastConnectMs = 0;
+    bool connectTried = false;
+    uint32_t phaseMs[STATE_COUNT] = {};
+
+    void enter(State next);
+    void publish(TelemetrySink &sink);
+
+public:
+    // Counters since boot
+    uint32_t delivered = 0; // Cycles acknowledged in full
+    uint32_t timeouts = 0;
+
+    SendState(JobState &job, Clock &clock = systemClock());
+
+    // Runs as the send task; returns the state after any transition
+    State tick(TelemetrySink &sink);
+
+    State state() const { return current; }
+    bool busy() const { return current != State::IDLE && current != State::DONE; }
+    // Polled by loop() between scheduler runs. True once this cycle is done
+    // and the job task has not posted another; loop() then stops the job
+    // task and hands over to DeviceState::prepareForDeepSleep().
+    bool readyForSleep() const { return current == State::DONE && !job.hasCompleted(); }
+    // The cycle being (or last) sent
+    const CompletedCycle &lastCycle() const { return cycle; }
+
+    // Time spent in each state by the last send
+    void printTimings() const;
+};
+
+extern SendState sendState;
@@ -1,20 +1,45 @@
 #pragma once
 
+#include <stdint.h>
+#include "../../utils/sample_ring.h"
+
 typedef void (*StateCallback)();
 
+// One reading taken by the sensor task, queued for the job task
+struct VitalSample
+{
+    uint32_t timestampMs;
+    float temperature;
+    float bpm;
+    float spO2; // 0 when no valid estimate
+};
+
 class SensorState
 {
+public:
+    // A job period's worth of sensor task runs (1.2 s / 25 ms = 48) with room
+    // to spare when the job task runs late
+    static const size_t SAMPLE_CAPACITY = 64;
+
 private:
     float bpm = 0.0f;
     float temperature = 0.0f;
+    float spO2 = 0.0f;
     StateCallback onChange = nullptr;
 
+    // The sensor task produces, the job task (JobState::tick()) consumes
+    SampleRing<VitalSample, SAMPLE_CAPACITY> samples;
+
 public:
-    void setState(float newTemp, float newBpm)
+    void setState(float newTemp, float newBpm, float newSpO2 = 0.0f, uint32_t timestampMs = 0)
     {
-        bool hasChanged = (bpm != newBpm) || (temperature != newTemp);
+        bool hasChanged = (bpm != newBpm) || (temperature != newTemp) || (spO2 != newSpO2);
         bpm = newBpm;
         temperature = newTemp;
+        spO2 = newSpO2;
+
+        VitalSample sample = {timestampMs, newTemp, newBpm, newSpO2};
+        samples.push(sample);
 
         if (hasChanged && onChange != nullptr)
         {
@@ -24,8 +49,13 @@ public:
 
     float getBPM() const { return bpm; }
     float getTemperature() const { return temperature; }
+    float getSpO2() const { return spO2; }
 
-    
+    // Consumer side of the sample queue
+    bool popSample(VitalSample &sample) { return samples.pop(sample); }
+    size_t drainSamples(VitalSample *out, size_t maxCount) { return samples.drain(out, maxCount); }
+    void clearSamples() { samples.clear(); }
+    uint32_t droppedSamples() const { return samples.dropped(); }
 
     void setListener(StateCallback callback)
     {
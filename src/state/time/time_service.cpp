@@ -0,0 +1,83 @@
+#include "time_service.h"
+#include "../wake/wake_probe.h"
+
+TimeService timeService(systemWallClock(), systemClock(), wakeState);
+
+TimeService::TimeService(WallClock &wall, Clock &clock, WakeState &cache) : wall(wall), clock(clock), cache(cache)
+{
+}
+
+void TimeService::anchor(uint64_t epochMs, Source source)
+{
+    anchorEpochMs = epochMs;
+    anchorMs = clock.millis();
+    currentSource = source;
+}
+
+void TimeService::restore()
+{
+    uint32_t estimate = cache.estimateEpoch();
+    if (estimate == 0)
+        return;
+
+    wall.set(estimate);
+    anchor((uint64_t)estimate * 1000, Source::RTC_ESTIMATE);
+    HAL_LOG("[TIME] Clock restored from RTC (drift %ld ppm)\n", (long)cache.driftPpm());
+}
+
+void TimeService::startSync()
+{
+    wall.startSync(NTP_PRIMARY_SERVER, NTP_SECONDARY_SERVER);
+    syncPending = true;
+    timedOut = false;
+    syncStartedMs = clock.millis();
+}
+
+void TimeService::tick()
+{
+    // SNTP keeps running after a timeout, so a late answer is still taken
+    if (currentSource != Source::NTP && (syncPending || timedOut) && wall.synced())
+    {
+        uint64_t epochMs = wall.nowMs();
+        anchor(epochMs, Source::NTP);
+        cache.recordTimeSync((uint32_t)(epochMs / 1000));
+        syncPending = false;
+        timedOut = false;
+        wakeProbe.mark(WAKE_TIME);
+        HAL_LOG("[TIME] SNTP sync after %lu ms\n", (unsigned long)(clock.millis() - syncStartedMs));
+        return;
+    }
+
+    if (syncPending && clock.millis() - syncStartedMs >= TIME_SYNC_TIMEOUT_MS)
+    {
+        syncPending = false;
+        timedOut = true;
+        HAL_LOG("[TIME] SNTP timed out, %s\n",
+                known() ? "keeping the RTC estimate" : "timestamps stay monotonic");
+    }
+
+    if (!syncPending && known())
+        wakeProbe.mark(WAKE_TIME);
+}
+
+bool TimeService::waitUntilSettled(uint32_t timeoutMs)
+{
+    uint32_t started = clock.millis();
+    tick();
+    while (!settled() && clock.millis() - started < timeoutMs)
+    {
+        clock.delay(10);
+        tick();
+    }
+    return known();
+}
+
+uint32_t TimeService::epochAt(uint32_t monotonicMs) const
+{
+    if (!known())
+        return 0;
+
+    // Signed: stamps taken before the anchor are in the past
+    int64_t epochMs = (int64_t)anchorEpochMs + (int32_t)(monotonicMs - anchorMs);
+    return epochMs > 0 ? (uint32_t)(epochMs / 1000) : 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+#include "../wake/wake_state.h"
+
+// How long connect() may wait for SNTP before giving up on wall-clock time
+#ifndef TIME_SYNC_TIMEOUT_MS
+#define TIME_SYNC_TIMEOUT_MS 5000
+#endif
+
+#define NTP_PRIMARY_SERVER "pool.ntp.org"
+#define NTP_SECONDARY_SERVER "time.nist.gov"
+
+// Maps monotonic millis() stamps to epoch seconds without ever blocking.
+// Samples are stamped with millis() when taken and converted at send time,
+// so readings taken before SNTP answers still get a real timestamp.
+class TimeService
+{
+public:
+    enum class Source : uint8_t
+    {
+        NONE,         // Only monotonic time; publish with the monotonic flag
+        RTC_ESTIMATE, // Carried across deep sleep by WakeState
+        NTP
+    };
+
+private:
+    WallClock &wall;
+    Clock &clock;
+    WakeState &cache;
+
+    Source currentSource = Source::NONE;
+    bool syncPending = false;
+    bool timedOut = false;
+    uint32_t syncStartedMs = 0;
+
+    // anchorEpochMs was the wall-clock time at millis() == anchorMs
+    uint64_t anchorEpochMs = 0;
+    uint32_t anchorMs = 0;
+
+    void anchor(uint64_t epochMs, Source source);
+
+public:
+    TimeService(WallClock &wall, Clock &clock, WakeState &cache);
+
+    // Adopts the wall clock carried in RTC memory, if any (call after
+    // WakeState::restore())
+    void restore();
+    // Starts SNTP in the background
+    void startSync();
+    // Called by the network task; picks up the SNTP result or gives up on timeout
+    void tick();
+    // Ticks until synced/timed out; for callers that really need the time
+    bool waitUntilSettled(uint32_t timeoutMs = TIME_SYNC_TIMEOUT_MS);
+
+    bool known() const { return currentSource != Source::NONE; }
+    // Nothing more to wait for: time is known or SNTP timed out
+    bool settled() const { return (known() && !syncPending) || timedOut; }
+    bool syncing() const { return syncPending; }
+    Source source() const { return currentSource; }
+
+    // Epoch seconds for a millis() stamp from this boot, 0 if unknown
+    uint32_t epochAt(uint32_t monotonicMs) const;
+    uint32_t now() const { return epochAt(clock.millis()); }
+};
+
+extern TimeService timeService;
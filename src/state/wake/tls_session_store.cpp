@@ -0,0 +1,98 @@
+#include "tls_session_store.h"
+#include "../duty/duty_cycle.h"
+#include "../../utils/crc32.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(TlsSessionRecord) % 4 == 0, "RTC memory is accessed in 4-byte blocks");
+static_assert(TLS_SESSION_RTC_OFFSET + sizeof(TlsSessionRecord) <= DUTY_CYCLE_RTC_OFFSET,
+              "TlsSessionRecord runs into the duty-cycle block");
+
+TlsSessionStore tlsSessionStore(rtcStorage(), TLS_SESSION_RTC_OFFSET);
+
+TlsSessionStore::TlsSessionStore(Storage &storage, size_t offset) : rtc(storage), offset(offset)
+{
+    memset(&record, 0, sizeof(record));
+}
+
+uint32_t TlsSessionStore::checksum() const
+{
+    return crc32(&record, offsetof(TlsSessionRecord, crc));
+}
+
+uint32_t TlsSessionStore::endpointHash(const char *host, uint16_t port)
+{
+    char endpoint[96];
+    int length = snprintf(endpoint, sizeof(endpoint), "%s:%u", host, (unsigned)port);
+    if (length < 0)
+        length = 0;
+    if ((size_t)length >= sizeof(endpoint))
+        length = sizeof(endpoint) - 1;
+    return crc32(endpoint, (size_t)length);
+}
+
+bool TlsSessionStore::restore(const char *host, uint16_t port)
+{
+    uint32_t hash = endpointHash(host, port);
+    bool restored = rtc.read(offset, &record, sizeof(record)) && record.magic == TlsSessionRecord::MAGIC &&
+                    record.version == TlsSessionRecord::VERSION && record.length == sizeof(TlsSessionRecord) &&
+                    record.endpointHash == hash && record.crc == checksum() &&
+                    record.sessionLength <= TlsSessionRecord::SESSION_CAPACITY;
+
+    if (!restored)
+    {
+        memset(&record, 0, sizeof(record));
+        record.magic = TlsSessionRecord::MAGIC;
+        record.version = TlsSessionRecord::VERSION;
+        record.length = sizeof(TlsSessionRecord);
+        record.endpointHash = hash;
+    }
+
+    valid = true;
+    return restored;
+}
+
+bool TlsSessionStore::session(void *out, size_t length) const
+{
+    if (!hasSession() || record.sessionLength != length)
+        return false;
+    memcpy(out, record.session, length);
+    return true;
+}
+
+void TlsSessionStore::write()
+{
+    record.crc = checksum();
+    rtc.write(offset, &record, sizeof(record));
+    rtc.commit();
+}
+
+void TlsSessionStore::saveSession(const void *data, size_t length)
+{
+    if (!valid || length > TlsSessionRecord::SESSION_CAPACITY)
+        return;
+
+    memcpy(record.session, data, length);
+    record.sessionLength = (uint16_t)length;
+    write();
+}
+
+void TlsSessionStore::forgetSession()
+{
+    if (!valid || record.sessionLength == 0)
+        return;
+
+    memset(record.session, 0, sizeof(record.session));
+    record.sessionLength = 0;
+    write();
+}
+
+void TlsSessionStore::recordMfln(bool supported)
+{
+    if (!valid)
+        return;
+
+    record.mfln = supported ? MFLN_SUPPORTED : MFLN_UNSUPPORTED;
+    write();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+
+// RTC offset of the TLS block, after WakeRecord
+#ifndef TLS_SESSION_RTC_OFFSET
+#define TLS_SESSION_RTC_OFFSET 256
+#endif
+
+// TLS state worth keeping across deep sleep: the session parameters for an
+// abbreviated handshake and whether the broker negotiates a smaller record
+// size (MFLN). Bound to the host:port it came from. The session bytes are
+// opaque here (BearSSL's br_ssl_session_parameters on the board).
+struct TlsSessionRecord
+{
+    static const uint32_t MAGIC = 0x544C5353; // "TLSS"
+    static const uint16_t VERSION = 1;
+    static const size_t SESSION_CAPACITY = 96;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t endpointHash; // crc32 of "host:port"
+
+    uint8_t mfln;          // TlsSessionStore::Mfln
+    uint8_t reserved;
+    uint16_t sessionLength; // 0 = no session
+    uint8_t session[SESSION_CAPACITY];
+
+    uint32_t crc;
+};
+
+class TlsSessionStore
+{
+public:
+    enum Mfln : uint8_t
+    {
+        MFLN_UNKNOWN = 0,
+        MFLN_SUPPORTED = 1,
+        MFLN_UNSUPPORTED = 2
+    };
+
+private:
+    Storage &rtc;
+    size_t offset;
+    TlsSessionRecord record;
+    bool valid = false;
+
+    uint32_t checksum() const;
+    static uint32_t endpointHash(const char *host, uint16_t port);
+    void write();
+
+public:
+    TlsSessionStore(Storage &storage, size_t offset);
+
+    // Loads the block for this endpoint; anything else (cold boot, other
+    // host, bad CRC) starts empty
+    bool restore(const char *host, uint16_t port);
+
+    bool hasSession() const { return valid && record.sessionLength != 0; }
+    // Copies the session out if it is exactly length bytes
+    bool session(void *out, size_t length) const;
+    // Stores the session written back by the last handshake. Each call goes
+    // straight to RTC memory, so a crash before sleep does not lose it.
+    void saveSession(const void *data, size_t length);
+    // After a failed handshake: the next one starts from scratch
+    void forgetSession();
+
+    Mfln mfln() const { return valid ? (Mfln)record.mfln : MFLN_UNKNOWN; }
+    void recordMfln(bool supported);
+};
+
+extern TlsSessionStore tlsSessionStore;
@@ -0,0 +1,32 @@
+#include "wake_probe.h"
+
+WakeProbe wakeProbe(systemClock());
+
+static const char *const STAGE_NAMES[WAKE_STAGE_COUNT] = {"wifi", "time", "token", "mqtt", "first publish"};
+
+void WakeProbe::mark(WakeStage stage)
+{
+    if (marked[stage])
+        return;
+
+    stamps[stage] = clock.millis();
+    marked[stage] = true;
+
+    if (stage == WAKE_FIRST_PUBLISH)
+        report();
+}
+
+void WakeProbe::report() const
+{
+    HAL_LOG("[WAKE] %s wake timings (ms since boot):\n", warm ? "Warm" : "Cold");
+
+    uint32_t previous = 0;
+    for (uint8_t i = 0; i < WAKE_STAGE_COUNT; i++)
+    {
+        if (!marked[i])
+            continue;
+        HAL_LOG("[WAKE]   %-14s %6lu (+%lu)\n", STAGE_NAMES[i], (unsigned long)stamps[i],
+                (unsigned long)(stamps[i] - previous));
+        previous = stamps[i];
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+
+// Milestones from boot (wake) to the first publish. Each is stamped once
+// with the clock's millis(), which restarts at every wake.
+enum WakeStage : uint8_t
+{
+    WAKE_WIFI,
+    WAKE_TIME,
+    WAKE_TOKEN,
+    WAKE_MQTT,
+    WAKE_FIRST_PUBLISH,
+    WAKE_STAGE_COUNT
+};
+
+class WakeProbe
+{
+private:
+    Clock &clock;
+    uint32_t stamps[WAKE_STAGE_COUNT] = {0};
+    bool marked[WAKE_STAGE_COUNT] = {false};
+    bool warm = false;
+
+public:
+    explicit WakeProbe(Clock &clock) : clock(clock) {}
+
+    // Whether this wake reused RTC state (for the report)
+    void setWarm(bool reused) { warm = reused; }
+
+    void mark(WakeStage stage);
+    bool reached(WakeStage stage) const { return marked[stage]; }
+    uint32_t at(WakeStage stage) const { return stamps[stage]; }
+
+    // Logs each stage's time since wake and since the previous stage
+    void report() const;
+};
+
+extern WakeProbe wakeProbe;
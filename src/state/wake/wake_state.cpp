@@ -0,0 +1,138 @@
+#include "wake_state.h"
+#include "tls_session_store.h"
+#include "../../utils/crc32.h"
+
+#include <string.h>
+
+static_assert(sizeof(WakeRecord) % 4 == 0, "RTC memory is accessed in 4-byte blocks");
+static_assert(sizeof(WakeRecord) <= TLS_SESSION_RTC_OFFSET, "WakeRecord runs into the TLS session block");
+
+WakeState wakeState(rtcStorage(), systemClock());
+
+WakeState::WakeState(Storage &storage, Clock &clock) : rtc(storage), clock(clock)
+{
+    memset(&record, 0, sizeof(record));
+}
+
+uint32_t WakeState::checksum() const
+{
+    return crc32(&record, offsetof(WakeRecord, crc));
+}
+
+bool WakeState::restore()
+{
+    valid = rtc.read(0, &record, sizeof(record)) && record.magic == WakeRecord::MAGIC &&
+            record.version == WakeRecord::VERSION && record.length == sizeof(WakeRecord) &&
+            record.crc == checksum();
+
+    if (!valid)
+    {
+        memset(&record, 0, sizeof(record));
+        return false;
+    }
+
+    record.wakeCount++;
+    record.sasToken[WakeRecord::TOKEN_CAPACITY - 1] = '\0';
+    return true;
+}
+
+void WakeState::save(uint32_t epochNow, uint32_t sleepMs)
+{
+    record.magic = WakeRecord::MAGIC;
+    record.version = WakeRecord::VERSION;
+    record.length = sizeof(WakeRecord);
+    record.epochAtSleep = epochNow;
+    record.sleepMs = sleepMs;
+    if (record.lastSyncEpoch)
+        record.sleptSinceSyncMs += sleepMs;
+    record.crc = checksum();
+
+    rtc.write(0, &record, sizeof(record));
+    rtc.commit();
+}
+
+void WakeState::clear()
+{
+    memset(&record, 0, sizeof(record));
+    valid = false;
+    rtc.write(0, &record, sizeof(record));
+    rtc.commit();
+}
+
+uint32_t WakeState::estimateEpoch() const
+{
+    if (!valid || record.epochAtSleep == 0)
+        return 0;
+
+    int64_t sleptMs = record.sleepMs + (int64_t)record.sleepMs * record.sleepDriftPpm / 1000000;
+    return record.epochAtSleep + (uint32_t)((sleptMs + clock.millis()) / 1000);
+}
+
+bool WakeState::needsTimeSync(uint32_t maxAgeSeconds) const
+{
+    uint32_t now = estimateEpoch();
+    return now == 0 || record.lastSyncEpoch == 0 || now - record.lastSyncEpoch > maxAgeSeconds;
+}
+
+void WakeState::recordTimeSync(uint32_t epoch)
+{
+    // Learn how far the sleep timer drifted since the last sync. Needs
+    // enough accumulated sleep for the 1 s epoch resolution to matter.
+    uint32_t estimate = estimateEpoch();
+    if (estimate && record.sleptSinceSyncMs >= 600000UL)
+    {
+        int64_t errorMs = ((int64_t)epoch - estimate) * 1000;
+        int64_t ppm = record.sleepDriftPpm + errorMs * 1000000 / record.sleptSinceSyncMs;
+        if (ppm > 100000)
+            ppm = 100000;
+        if (ppm < -100000)
+            ppm = -100000;
+        record.sleepDriftPpm = (int32_t)ppm;
+    }
+
+    record.lastSyncEpoch = epoch;
+    record.sleptSinceSyncMs = 0;
+}
+
+void WakeState::recordNetwork(const uint8_t *bssid, uint8_t channel, uint32_t ip, uint32_t gateway, uint32_t subnet,
+                              uint32_t dns)
+{
+    memcpy(record.bssid, bssid, sizeof(record.bssid));
+    record.channel = channel;
+    record.ip = ip;
+    record.gateway = gateway;
+    record.subnet = subnet;
+    record.dns = dns;
+}
+
+void WakeState::forgetNetwork()
+{
+    memset(record.bssid, 0, sizeof(record.bssid));
+    record.channel = 0;
+    record.ip = record.gateway = record.subnet = record.dns = 0;
+}
+
+bool WakeState::tokenValid(uint32_t epochNow, uint32_t marginSeconds) const
+{
+    return record.sasToken[0] != '\0' && epochNow != 0 && record.tokenExpiresAt > epochNow + marginSeconds;
+}
+
+void WakeState::recordToken(const char *token, uint32_t expiresAt)
+{
+    size_t length = strlen(token);
+    if (length >= WakeRecord::TOKEN_CAPACITY)
+    {
+        record.sasToken[0] = '\0';
+        record.tokenExpiresAt = 0;
+        return;
+    }
+
+    memcpy(record.sasToken, token, length + 1);
+    record.tokenExpiresAt = expiresAt;
+}
+
+void WakeState::recordSleepEntry(uint32_t awakeMs, uint32_t entryUs)
+{
+    record.awakeMs = awakeMs;
+    record.sleepEntryUs = entryUs;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../hal/hal.h"
+
+// How long a wall-clock estimate carried across sleeps is trusted before
+// NTP is asked again
+#ifndef TIME_RESYNC_INTERVAL_S
+#define TIME_RESYNC_INTERVAL_S (6UL * 3600UL)
+#endif
+
+// Everything a wake needs to skip the slow connect steps. Lives in RTC
+// memory; a CRC over the whole block rejects cold-boot garbage and torn
+// writes. Size must stay a multiple of 4 (RTC block size).
+struct WakeRecord
+{
+    static const uint32_t MAGIC = 0x57414B45; // "WAKE"
+    static const uint16_t VERSION = 2;
+    static const size_t TOKEN_CAPACITY = 168;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t wakeCount;
+
+    // Wall clock
+    uint32_t epochAtSleep;   // 0 = unknown
+    uint32_t sleepMs;        // Programmed sleep length
+    uint32_t lastSyncEpoch;  // Last NTP sync
+    uint32_t sleptSinceSyncMs;
+    int32_t sleepDriftPpm;   // RTC timer error learned at NTP resync
+
+    // Wi-Fi association and DHCP lease
+    uint8_t bssid[6];
+    uint8_t channel; // 0 = none
+    uint8_t reserved;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+
+    // SAS token
+    uint32_t tokenExpiresAt;
+    char sasToken[TOKEN_CAPACITY];
+
+    // Previous wake's timings, reported by the next one
+    uint32_t awakeMs;      // Boot to deep sleep
+    uint32_t sleepEntryUs; // Sleep preparation up to ESP.deepSleep()
+
+    uint32_t crc;
+};
+
+class WakeState
+{
+private:
+    Storage &rtc;
+    Clock &clock;
+    WakeRecord record;
+    bool valid = false;
+
+    uint32_t checksum() const;
+
+public:
+    WakeState(Storage &storage, Clock &clock);
+
+    // Reads the block left by the previous wake. False on cold boot.
+    bool restore();
+    // Writes the block just before deep sleep
+    void save(uint32_t epochNow, uint32_t sleepMs);
+    void clear();
+
+    bool restored() const { return valid; }
+    uint32_t wakeCount() const { return record.wakeCount; }
+
+    // Wall clock carried across sleep: epoch at sleep + sleep length
+    // (drift corrected) + time since this boot. 0 if unknown.
+    uint32_t estimateEpoch() const;
+    bool needsTimeSync(uint32_t maxAgeSeconds = TIME_RESYNC_INTERVAL_S) const;
+    void recordTimeSync(uint32_t epoch);
+    int32_t driftPpm() const { return record.sleepDriftPpm; }
+
+    bool hasNetwork() const { return record.channel != 0; }
+    const uint8_t *bssid() const { return record.bssid; }
+    uint8_t channel() const { return record.channel; }
+    uint32_t ip() const { return record.ip; }
+    uint32_t gateway() const { return record.gateway; }
+    uint32_t subnet() const { return record.subnet; }
+    uint32_t dns() const { return record.dns; }
+    void recordNetwork(const uint8_t *bssid, uint8_t channel, uint32_t ip, uint32_t gateway, uint32_t subnet,
+                       uint32_t dns);
+    void forgetNetwork();
+
+    // Valid if it expires more than marginSeconds after epochNow
+    bool tokenValid(uint32_t epochNow, uint32_t marginSeconds) const;
+    const char *token() const { return record.sasToken; }
+    uint32_t tokenExpiresAt() const { return record.tokenExpiresAt; }
+    // Tokens too long for the block are simply not carried over
+    void recordToken(const char *token, uint32_t expiresAt);
+
+    // Timings of the wake that saved the block; 0 on cold boot
+    uint32_t lastAwakeMs() const { return record.awakeMs; }
+    uint32_t lastSleepEntryUs() const { return record.sleepEntryUs; }
+    void recordSleepEntry(uint32_t awakeMs, uint32_t entryUs);
+};
+
+extern WakeState wakeState;
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+// The cell reaches A0 through a 220k/100k divider, and A0 reads 0-3.3 V
+// as 0-1023
+#ifndef BATTERY_DIVIDER_TOP_KOHM
+#define BATTERY_DIVIDER_TOP_KOHM 220
+#endif
+#ifndef BATTERY_DIVIDER_BOTTOM_KOHM
+#define BATTERY_DIVIDER_BOTTOM_KOHM 100
+#endif
+#ifndef BATTERY_ADC_FULL_SCALE_MV
+#define BATTERY_ADC_FULL_SCALE_MV 3300
+#endif
+
+// Li-ion range the percentage spans
+#define BATTERY_EMPTY_MV 3000
+#define BATTERY_FULL_MV 4200
+// Above a full cell by more than a few ADC steps (about 10 mV each): charger
+#define BATTERY_CHARGING_MV 4250
+
+// Cell voltage from a raw A0 reading
+inline uint16_t batteryMillivolts(int adc)
+{
+    if (adc < 0)
+        adc = 0;
+    return (uint16_t)((uint32_t)adc * BATTERY_ADC_FULL_SCALE_MV *
+                      (BATTERY_DIVIDER_TOP_KOHM + BATTERY_DIVIDER_BOTTOM_KOHM) / (1023 * BATTERY_DIVIDER_BOTTOM_KOHM));
+}
+
+// Charge left, linear between BATTERY_EMPTY_MV and BATTERY_FULL_MV
+inline int8_t batteryPercent(uint16_t millivolts)
+{
+    if (millivolts <= BATTERY_EMPTY_MV)
+        return 0;
+    if (millivolts >= BATTERY_FULL_MV)
+        return 100;
+    return (int8_t)((millivolts - BATTERY_EMPTY_MV) * 100 / (BATTERY_FULL_MV - BATTERY_EMPTY_MV));
+}
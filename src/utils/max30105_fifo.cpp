@@ -0,0 +1,144 @@
+#include "max30105_fifo.h"
+
+// SPO2_CONFIG.SR encodings
+static const uint16_t SAMPLE_RATES[8] = {50, 100, 200, 400, 800, 1000, 1600, 3200};
+
+uint8_t Max30105Fifo::sampleRateBits(uint16_t hz)
+{
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        if (hz <= SAMPLE_RATES[i])
+            return i;
+    }
+    return 7;
+}
+
+uint8_t Max30105Fifo::sampleAverageBits(uint8_t average)
+{
+    uint8_t bits = 0;
+    while (bits < 5 && (1u << bits) < average)
+    {
+        bits++;
+    }
+    return bits;
+}
+
+bool Max30105Fifo::waitForReset()
+{
+    uint32_t start = clock.millis();
+    for (;;)
+    {
+        uint8_t mode = MODE_RESET;
+        if (bus.readRegisters(I2C_ADDRESS, REG_MODE_CONFIG, &mode, 1) && (mode & MODE_RESET) == 0)
+            return true;
+        if (clock.millis() - start >= MAX30105_RESET_TIMEOUT_MS)
+            return false;
+        clock.delay(1);
+    }
+}
+
+bool Max30105Fifo::begin(const Max30105FifoConfig &cfg)
+{
+    config = cfg;
+    config.sampleRateHz = SAMPLE_RATES[sampleRateBits(cfg.sampleRateHz)];
+    config.sampleAverage = (uint8_t)(1u << sampleAverageBits(cfg.sampleAverage));
+    if (config.almostFullRemaining > 15)
+        config.almostFullRemaining = 15;
+
+    if (read(REG_PART_ID) != PART_ID)
+        return false;
+
+    // Soft reset clears the FIFO and all configuration; writes made before
+    // the RESET bit clears again can be lost
+    write(REG_MODE_CONFIG, MODE_RESET);
+    if (!waitForReset())
+        return false;
+
+    // Averaging, rollover enabled, almost-full threshold
+    write(REG_FIFO_CONFIG, (uint8_t)((sampleAverageBits(config.sampleAverage) << 5) | 0x10 | config.almostFullRemaining));
+
+    // ADC range 4096 nA, sample rate, 411 us pulse width (18-bit)
+    write(REG_SPO2_CONFIG, (uint8_t)((0x01 << 5) | (sampleRateBits(config.sampleRateHz) << 2) | 0x03));
+
+    write(REG_LED1_PA, config.redAmplitude);
+    write(REG_LED2_PA, config.irAmplitude);
+    write(REG_LED3_PA, 0);
+
+    write(REG_FIFO_WR_PTR, 0);
+    write(REG_FIFO_OVF, 0);
+    write(REG_FIFO_RD_PTR, 0);
+
+    write(REG_INT_ENABLE1, INT_A_FULL);
+    write(REG_INT_ENABLE2, 0);
+    read(REG_INT_STATUS1); // Clear any stale interrupt
+
+    interruptFlag = false;
+    return write(REG_MODE_CONFIG, MODE_SPO2);
+}
+
+void Max30105Fifo::shutDown()
+{
+    write(REG_MODE_CONFIG, MODE_SHDN | MODE_SPO2);
+}
+
+void Max30105Fifo::wakeUp()
+{
+    write(REG_MODE_CONFIG, MODE_SPO2);
+}
+
+uint8_t Max30105Fifo::pending()
+{
+    // WR_PTR, OVF_COUNTER and RD_PTR are consecutive registers
+    uint8_t pointers[3] = {0, 0, 0};
+    if (!bus.readRegisters(I2C_ADDRESS, REG_FIFO_WR_PTR, pointers, sizeof(pointers)))
+        return 0;
+
+    uint8_t count = (uint8_t)((pointers[0] - pointers[2]) & (FIFO_DEPTH - 1));
+    if (pointers[1] != 0)
+    {
+        // Overflowed: the FIFO is full and the oldest samples were overwritten
+        overflows += pointers[1];
+        count = FIFO_DEPTH;
+    }
+    return count;
+}
+
+size_t Max30105Fifo::drain(PpgSample *out, size_t maxSamples)
+{
+    if (interruptFlag)
+    {
+        interruptFlag = false;
+        read(REG_INT_STATUS1); // Reading status releases the INT pin
+    }
+
+    size_t count = pending();
+    if (count > maxSamples)
+        count = maxSamples;
+    if (count == 0)
+        return 0;
+
+    // Whole samples per read: a read the bus splits mid-sample would leave
+    // the next one starting inside a sample
+    size_t perRead = bus.maxReadLength() / BYTES_PER_SAMPLE;
+    if (perRead == 0)
+        perRead = 1;
+
+    uint8_t raw[FIFO_DEPTH * BYTES_PER_SAMPLE];
+    for (size_t done = 0; done < count; done += perRead)
+    {
+        size_t samples = count - done < perRead ? count - done : perRead;
+        if (!bus.readRegisters(I2C_ADDRESS, REG_FIFO_DATA, raw + done * BYTES_PER_SAMPLE, samples * BYTES_PER_SAMPLE))
+        {
+            count = done; // Keep what already left the FIFO
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t *p = raw + i * BYTES_PER_SAMPLE;
+        out[i].red = (((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2]) & 0x3FFFF;
+        out[i].ir = (((uint32_t)p[3] << 16) | ((uint32_t)p[4] << 8) | p[5]) & 0x3FFFF;
+    }
+    return count;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../hal/hal.h"
+
+// One red/IR pair as stored in the MAX30105 FIFO (18-bit ADC counts)
+// Longest wait for a soft reset to finish before begin() gives up
+#ifndef MAX30105_RESET_TIMEOUT_MS
+#define MAX30105_RESET_TIMEOUT_MS 100
+#endif
+
+struct PpgSample
+{
+    uint32_t red;
+    uint32_t ir;
+};
+
+struct Max30105FifoConfig
+{
+    uint16_t sampleRateHz = 400;    // ADC rate: 50, 100, 200, 400, 800, 1000, 1600, 3200
+    uint8_t sampleAverage = 4;      // On-chip averaging: 1, 2, 4, 8, 16, 32
+    uint8_t almostFullRemaining = 8; // Interrupt when only this many free slots are left
+    uint8_t redAmplitude = 0x1F;
+    uint8_t irAmplitude = 0x1F;
+};
+
+// Register-level MAX30105 driver running the FIFO in SpO2 (red + IR) mode.
+// Samples are paced by the sensor's own clock and collected in one I2C burst
+// per drain instead of one getIR() transaction per loop() pass.
+class Max30105Fifo
+{
+public:
+    static const uint8_t I2C_ADDRESS = 0x57;
+    static const uint8_t FIFO_DEPTH = 32;
+    static const uint8_t BYTES_PER_SAMPLE = 6;
+
+    explicit Max30105Fifo(I2CBus &i2c, Clock &clock = systemClock()) : bus(i2c), clock(clock) {}
+
+    // Resets and configures the part; false if it is missing or does not
+    // come out of reset within MAX30105_RESET_TIMEOUT_MS
+    bool begin(const Max30105FifoConfig &cfg = Max30105FifoConfig());
+    void shutDown();
+    void wakeUp();
+
+    // Effective output rate after on-chip averaging
+    uint16_t outputRateHz() const { return config.sampleRateHz / config.sampleAverage; }
+    uint32_t samplePeriodUs() const { return 1000000UL / outputRateHz(); }
+
+    // Number of unread samples, including a full FIFO after overflow
+    uint8_t pending();
+
+    // Reads every pending sample (up to maxSamples) in as few bursts as the
+    // bus allows, each holding whole samples. Returns the number of samples
+    // written to out.
+    size_t drain(PpgSample *out, size_t maxSamples);
+
+    // Called from the INT pin ISR; drain() acknowledges it
+    void onInterrupt() { interruptFlag = true; }
+    bool interruptPending() const { return interruptFlag; }
+
+    uint32_t overflowCount() const { return overflows; }
+
+private:
+    // Register map
+    static const uint8_t REG_INT_STATUS1 = 0x00;
+    static const uint8_t REG_INT_ENABLE1 = 0x02;
+    static const uint8_t REG_INT_ENABLE2 = 0x03;
+    static const uint8_t REG_FIFO_WR_PTR = 0x04;
+    static const uint8_t REG_FIFO_OVF = 0x05;
+    static const uint8_t REG_FIFO_RD_PTR = 0x06;
+    static const uint8_t REG_FIFO_DATA = 0x07;
+    static const uint8_t REG_FIFO_CONFIG = 0x08;
+    static const uint8_t REG_MODE_CONFIG = 0x09;
+    static const uint8_t REG_SPO2_CONFIG = 0x0A;
+    static const uint8_t REG_LED1_PA = 0x0C;
+    static const uint8_t REG_LED2_PA = 0x0D;
+    static const uint8_t REG_LED3_PA = 0x0E;
+    static const uint8_t REG_PART_ID = 0xFF;
+
+    static const uint8_t PART_ID = 0x15;
+    static const uint8_t INT_A_FULL = 0x80;
+    static const uint8_t MODE_SPO2 = 0x03;
+    static const uint8_t MODE_RESET = 0x40;
+    static const uint8_t MODE_SHDN = 0x80;
+
+    I2CBus &bus;
+    Clock &clock;
+    Max30105FifoConfig config;
+    volatile bool interruptFlag = false;
+    uint32_t overflows = 0;
+
+    bool write(uint8_t reg, uint8_t value) { return bus.writeRegister(I2C_ADDRESS, reg, value); }
+    uint8_t read(uint8_t reg) { return bus.readRegister(I2C_ADDRESS, reg); }
+
+    bool waitForReset();
+    static uint8_t sampleRateBits(uint16_t hz);
+    static uint8_t sampleAverageBits(uint8_t average);
+};
@@ -3,6 +3,10 @@
 #include <Arduino.h>
 #include <Wire.h>
 
+#include "battery.h"
+#include "trace.h"
+#include "stage_profiler.h"
+
 class OtherUtils
 {
 public:
@@ -52,9 +56,14 @@ public:
             Serial.println("Device ID: " + getDeviceId());
             Serial.printf("Free Heap: %d bytes\n", ESP.getFreeHeap());
             Serial.printf("Uptime: %lu ms\n", millis());
+        } else if (command == "perf") {
+            stageProfiler.print();
+        } else if (command == "trace") {
+            // Decode on the host with scripts/decode_trace.py
+            traceBuffer.dumpHex([](const char *line) { Serial.println(line); });
         } else {
             Serial.println("Unknown command: " + command);
-            Serial.println("Available commands: status, reset, info");
+            Serial.println("Available commands: status, reset, info, perf, trace");
         }
     }
 
@@ -63,22 +72,9 @@ public:
         return "PETSA-02-" + String(ESP.getChipId(), HEX); // or DEC for decimal
     }
 
-    static int getAverage(float data[], int size)
-    {
-        int sum = 0;
-        for (int i = 0; i < size; i++)
-        {
-            sum += data[i];
-        }
-        return size > 0 ? sum / size : 0;
-    }
-
     static float readBatteryVoltage()
     {
-        int raw = analogRead(A0);                    // Analog read from voltage divider
-        float vout = (raw / 1023.0) * 3.3;           // Convert ADC reading to voltage (assuming 3.3V ref)
-        float vbat = vout * (220.0 + 100.0) / 100.0; // Reverse voltage divider formula
-        return vbat;
+        return batteryMillivolts(analogRead(A0)) / 1000.0f;
     }
 
     static int batteryPercentage(float voltage)
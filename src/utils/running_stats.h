@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// O(1)-memory accumulator: Welford mean/variance plus min/max and count.
+// With excludeZero set, 0 readings ("no finger", "no estimate") are counted
+// as skipped instead of pulling the mean down.
+class RunningStats
+{
+private:
+    uint32_t n = 0;
+    uint32_t skipped = 0;
+    float meanValue = 0;
+    float m2 = 0;
+    float minValue = 0;
+    float maxValue = 0;
+    bool excludeZero;
+
+public:
+    explicit RunningStats(bool ignoreZero = false) : excludeZero(ignoreZero) {}
+
+    void reset()
+    {
+        n = 0;
+        skipped = 0;
+        meanValue = 0;
+        m2 = 0;
+        minValue = 0;
+        maxValue = 0;
+    }
+
+    void add(float value)
+    {
+        if (excludeZero && value == 0.0f)
+        {
+            skipped++;
+            return;
+        }
+
+        n++;
+        if (n == 1)
+        {
+            minValue = maxValue = value;
+        }
+        else
+        {
+            if (value < minValue)
+                minValue = value;
+            if (value > maxValue)
+                maxValue = value;
+        }
+
+        float delta = value - meanValue;
+        meanValue += delta / n;
+        m2 += delta * (value - meanValue);
+    }
+
+    uint32_t count() const { return n; }
+    uint32_t skippedCount() const { return skipped; }
+    bool empty() const { return n == 0; }
+
+    float mean() const { return meanValue; }
+    float min() const { return minValue; }
+    float max() const { return maxValue; }
+    float variance() const { return n > 1 ? m2 / (n - 1) : 0.0f; }
+    float stddev() const { return sqrtf(variance()); }
+};
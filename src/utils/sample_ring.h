@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-capacity single-producer/single-consumer ring buffer.
+//
+// One context pushes (loop(), an ISR or a Ticker callback) and exactly one
+// other context pops. Head and tail are free-running 32-bit counters, each
+// written by only one side, so no locking or interrupt masking is needed.
+// When the ring is full the newest sample is dropped and counted; the
+// producer never touches the consumer's index.
+template <typename T, size_t N>
+class SampleRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SampleRing capacity must be a power of two");
+
+private:
+    static const uint32_t MASK = (uint32_t)N - 1;
+
+    T slots[N];
+    std::atomic<uint32_t> head{0}; // Written by producer only
+    std::atomic<uint32_t> tail{0}; // Written by consumer only
+    std::atomic<uint32_t> droppedCount{0};
+
+public:
+    static constexpr size_t capacity() { return N; }
+
+    // Producer side
+    bool push(const T &sample)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N)
+        {
+            droppedCount.store(droppedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        slots[h & MASK] = sample;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T &sample)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t)
+            return false;
+
+        sample = slots[t & MASK];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: pops up to maxCount samples in order
+    size_t drain(T *out, size_t maxCount)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t available = head.load(std::memory_order_acquire) - t;
+        size_t count = available < maxCount ? available : maxCount;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = slots[(t + i) & MASK];
+        }
+        tail.store(t + (uint32_t)count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side: discards everything currently queued
+    void clear()
+    {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // Neither side running: empties the ring with both counters at start
+    // and forgets the drop count. Host checks start near UINT32_MAX to
+    // cross the counter wrap.
+    void reset(uint32_t start = 0)
+    {
+        head.store(start, std::memory_order_relaxed);
+        tail.store(start, std::memory_order_relaxed);
+        droppedCount.store(0, std::memory_order_relaxed);
+    }
+
+    // Approximate from the other side, exact from either owner
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Samples rejected because the ring was full. Only the producer
+    // increments it, so it is safe to read from anywhere.
+    uint32_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,163 @@
+#include "scheduler.h"
+
+#include <string.h>
+
+Scheduler scheduler(systemClock());
+
+Scheduler::Scheduler(Clock &clock) : clock(clock)
+{
+}
+
+int Scheduler::add(const char *name, TaskFunction run, void *context, uint32_t periodMs, uint32_t budgetUs,
+                   uint32_t offsetMs)
+{
+    if (count >= SCHEDULER_MAX_TASKS || periodMs == 0)
+        return -1;
+    if (count == 0)
+        startedUs = clock.micros();
+
+    uint8_t index = count++;
+    Task &task = tasks[index];
+    task.name = name;
+    task.run = run;
+    task.context = context;
+    task.periodMs = periodMs;
+    task.budgetUs = budgetUs;
+    task.releaseMs = clock.millis() + offsetMs;
+    task.enabled = true;
+    memset(&task.stats, 0, sizeof(task.stats));
+
+    queue[index] = index;
+    requeue(index);
+    return index;
+}
+
+// Moves a task whose deadline changed back into order. Insertion sort over
+// at most SCHEDULER_MAX_TASKS entries.
+void Scheduler::requeue(uint8_t index)
+{
+    uint8_t position = 0;
+    while (queue[position] != index)
+        position++;
+
+    // Take it out, then shift until its deadline fits
+    memmove(queue + position, queue + position + 1, count - position - 1);
+    uint32_t deadline = tasks[index].deadlineMs();
+    uint8_t insert = 0;
+    while (insert < count - 1 && !before(deadline, tasks[queue[insert]].deadlineMs()))
+        insert++;
+    memmove(queue + insert + 1, queue + insert, count - 1 - insert);
+    queue[insert] = index;
+}
+
+void Scheduler::setPeriod(int id, uint32_t periodMs)
+{
+    if (id < 0 || id >= count || periodMs == 0)
+        return;
+    tasks[id].periodMs = periodMs;
+    requeue((uint8_t)id);
+}
+
+void Scheduler::setEnabled(int id, bool enabled)
+{
+    if (id < 0 || id >= count)
+        return;
+    Task &task = tasks[id];
+    if (enabled && !task.enabled)
+    {
+        task.releaseMs = clock.millis();
+        requeue((uint8_t)id);
+    }
+    task.enabled = enabled;
+}
+
+bool Scheduler::runOnce()
+{
+    uint32_t now = clock.millis();
+    for (uint8_t position = 0; position < count; position++)
+    {
+        uint8_t index = queue[position];
+        Task &task = tasks[index];
+        if (!task.enabled || before(now, task.releaseMs))
+            continue;
+
+        uint32_t lateness = now - task.releaseMs;
+        uint32_t started = clock.micros();
+        task.run(task.context);
+        uint32_t elapsed = clock.micros() - started;
+        uint32_t finished = clock.millis();
+
+        TaskStats &stats = task.stats;
+        stats.runs++;
+        stats.totalUs += elapsed;
+        busyUs += elapsed;
+        if (elapsed > stats.worstUs)
+            stats.worstUs = elapsed;
+        if (lateness > stats.worstLatenessMs)
+            stats.worstLatenessMs = lateness;
+        if (task.budgetUs && elapsed > task.budgetUs)
+            stats.overruns++;
+        if (before(task.deadlineMs(), finished))
+            stats.missed++;
+
+        // Next release one period on; a task a whole period behind skips
+        // the releases it missed instead of running back to back
+        task.releaseMs += task.periodMs;
+        if (!before(finished, task.deadlineMs()))
+        {
+            uint32_t behind = (finished - task.releaseMs) / task.periodMs;
+            stats.skipped += behind;
+            task.releaseMs += behind * task.periodMs;
+        }
+        requeue(index);
+        return true;
+    }
+    return false;
+}
+
+uint32_t Scheduler::idleMs()
+{
+    uint32_t now = clock.millis();
+    uint32_t idle = UINT32_MAX;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const Task &task = tasks[i];
+        if (!task.enabled)
+            continue;
+        if (!before(now, task.releaseMs))
+            return 0;
+        if (task.releaseMs - now < idle)
+            idle = task.releaseMs - now;
+    }
+    return idle == UINT32_MAX ? 0 : idle;
+}
+
+float Scheduler::load() const
+{
+    uint32_t elapsed = clock.micros() - startedUs;
+    return elapsed ? 100.0f * (float)busyUs / (float)elapsed : 0.0f;
+}
+
+void Scheduler::resetStats()
+{
+    for (uint8_t i = 0; i < count; i++)
+        memset(&tasks[i].stats, 0, sizeof(tasks[i].stats));
+    startedUs = clock.micros();
+    busyUs = 0;
+}
+
+void Scheduler::printStats() const
+{
+    HAL_LOG("[SCHED] load %.1f%%\n", load());
+    HAL_LOG("[SCHED] %-8s %7s %6s %8s %8s %6s %6s %7s\n", "task", "period", "runs", "avg us", "worst us", "over",
+            "missed", "late ms");
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const Task &task = tasks[i];
+        const TaskStats &stats = task.stats;
+        HAL_LOG("[SCHED] %-8s %7lu %6lu %8lu %8lu %6lu %6lu %7lu\n", task.name, (unsigned long)task.periodMs,
+                (unsigned long)stats.runs, (unsigned long)(stats.runs ? stats.totalUs / stats.runs : 0),
+                (unsigned long)stats.worstUs, (unsigned long)stats.overruns,
+                (unsigned long)(stats.missed + stats.skipped), (unsigned long)stats.worstLatenessMs);
+    }
+}
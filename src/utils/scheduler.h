@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../hal/hal.h"
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8
+#endif
+
+typedef void (*TaskFunction)(void *context);
+
+// Per-task accounting since boot. Times are measured around the call.
+struct TaskStats
+{
+    uint32_t runs;
+    uint32_t overruns;    // Ran longer than the budget
+    uint32_t missed;      // Finished after the deadline
+    uint32_t skipped;     // Releases dropped because the task fell a period behind
+    uint32_t worstUs;
+    uint32_t worstLatenessMs; // Start after release
+    uint64_t totalUs;
+};
+
+// Cooperative earliest-deadline-first scheduler. A task is released every
+// periodMs and must finish within one period (its deadline); runOnce()
+// runs the released task with the earliest deadline and returns, so one
+// slow task delays the others but cannot starve them. Nothing preempts:
+// a task that runs past budgetUs is only counted. Between releases the
+// caller may sleep for idleMs().
+class Scheduler
+{
+public:
+    struct Task
+    {
+        const char *name;
+        TaskFunction run;
+        void *context;
+        uint32_t periodMs;
+        uint32_t budgetUs;
+        uint32_t releaseMs;
+        bool enabled;
+        TaskStats stats;
+
+        uint32_t deadlineMs() const { return releaseMs + periodMs; }
+    };
+
+private:
+    Clock &clock;
+    Task tasks[SCHEDULER_MAX_TASKS];
+    uint8_t count = 0;
+
+    // Run queue: task indexes by deadline, earliest first
+    uint8_t queue[SCHEDULER_MAX_TASKS];
+
+    uint32_t startedUs = 0;
+    uint64_t busyUs = 0;
+
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+    void requeue(uint8_t index);
+
+public:
+    explicit Scheduler(Clock &clock = systemClock());
+
+    // Returns the task id, or -1 when the table is full. The first release
+    // is offsetMs from now, so tasks of the same period can be staggered.
+    int add(const char *name, TaskFunction run, void *context, uint32_t periodMs, uint32_t budgetUs,
+            uint32_t offsetMs = 0);
+    void setPeriod(int id, uint32_t periodMs);
+    void setEnabled(int id, bool enabled);
+
+    // Runs at most one released task. True if one ran.
+    bool runOnce();
+
+    // Time until the next release, 0 if a task is already released
+    uint32_t idleMs();
+
+    const Task &task(int id) const { return tasks[id]; }
+    uint8_t size() const { return count; }
+
+    // Share of time spent in tasks since the first add(), in percent
+    float load() const;
+    void resetStats();
+    void printStats() const;
+};
+
+extern Scheduler scheduler;
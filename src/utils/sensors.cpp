@@ -0,0 +1,4 @@
+#include "sensors.h"
+
+// ISR target definition - MUST be in .cpp file to avoid redefinition
+MAX30105Sensor *MAX30105Sensor::isrTarget = nullptr;
@@ -3,13 +3,11 @@
 #include <Wire.h>
 #include <Adafruit_MLX90614.h>
 
-// Prevent I2C_BUFFER_LENGTH redefinition warning
-#ifndef I2C_BUFFER_LENGTH
-#define I2C_BUFFER_LENGTH BUFFER_LENGTH
-#endif
-
-#include "MAX30105.h"
-#include "heartRate.h"
+#include "../hal/hal.h"
+#include "../dsp/ppg_pipeline.h"
+#include "stage_profiler.h"
+#include "../dsp/spo2_estimator.h"
+#include "max30105_fifo.h"
 
 class MLX90614Sensor
 {
@@ -37,13 +35,13 @@ public:
     float readCoreBodyTemperature()
     {
         // Set I2C speed to 100kHz for MLX90614
-        Wire.setClock(100000);
+        systemI2C().setClock(100000);
 
         float tEar = mlx.readObjectTempC();      // Suhu telinga
         float tAmbient = mlx.readAmbientTempC(); // Suhu lingkungan
 
         // Restore I2C speed to 400kHz (default for MAX30105)
-        Wire.setClock(400000);
+        systemI2C().setClock(400000);
 
         // Silently validate sensor readings
         if (isnan(tEar) || isnan(tAmbient) || 
@@ -68,63 +66,112 @@ public:
     }
 };
 
+// INT pin of the MAX30105 (active low, open drain). Set to -1 to poll the
+// FIFO pointers instead of waiting for the almost-full interrupt.
+#ifndef MAX30105_INT_PIN
+#define MAX30105_INT_PIN D5
+#endif
+
 class MAX30105Sensor
 {
 private:
-    MAX30105 particleSensor;
-    long lastBeat = 0;
-    float beatsPerMinute = 0;
+    Max30105Fifo fifo;
+    PpgPipeline pipeline;
+    Spo2Estimator spo2;
+    PpgSample block[Max30105Fifo::FIFO_DEPTH];
+    uint32_t lastDrainMs = 0;
+
+    // ISR trampoline target, defined in sensors.cpp
+    static MAX30105Sensor *isrTarget;
+
+    static void IRAM_ATTR onFifoInterrupt()
+    {
+        if (isrTarget != nullptr)
+            isrTarget->fifo.onInterrupt();
+    }
+
+    bool drainDue()
+    {
+        if (MAX30105_INT_PIN >= 0)
+            return fifo.interruptPending();
+
+        // Polling: the FIFO holds 32 samples, check at least twice per fill
+        uint32_t fillMs = (uint32_t)Max30105Fifo::FIFO_DEPTH * 1000UL / fifo.outputRateHz();
+        return millis() - lastDrainMs >= fillMs / 2;
+    }
 
 public:
+    MAX30105Sensor() : fifo(systemI2C()) {}
+
     bool begin()
     {
         Serial.println("Initializing MAX30105...");
-        if (!particleSensor.begin(Wire, I2C_SPEED_FAST))
+        systemI2C().setClock(400000);
+
+        // 400 Hz ADC with 4x on-chip averaging -> 100 Hz, interrupt at 24 samples
+        Max30105FifoConfig config;
+        config.sampleRateHz = 400;
+        config.sampleAverage = 4;
+        config.almostFullRemaining = 8;
+        if (!fifo.begin(config))
         {
             Serial.println("MAX30105 not found. Check wiring.");
             return false;
         }
-        particleSensor.setup();
-        particleSensor.setPulseAmplitudeRed(0x1F);
-        particleSensor.setPulseAmplitudeGreen(0);
-        Serial.println("MAX30105 Loaded!");
+
+        if (MAX30105_INT_PIN >= 0)
+        {
+            isrTarget = this;
+            pinMode(MAX30105_INT_PIN, INPUT_PULLUP);
+            attachInterrupt(digitalPinToInterrupt(MAX30105_INT_PIN), onFifoInterrupt, FALLING);
+        }
+
+        PpgPipelineConfig ppg;
+        ppg.sampleRateHz = fifo.outputRateHz();
+        pipeline.begin(ppg);
+        pipeline.attach(&spo2);
+
+        Serial.printf("MAX30105 Loaded! FIFO mode at %u Hz\n", fifo.outputRateHz());
         return true;
     }
 
     void setSleep()
     {
-        particleSensor.shutDown();        
+        if (MAX30105_INT_PIN >= 0)
+            detachInterrupt(digitalPinToInterrupt(MAX30105_INT_PIN));
+        fifo.shutDown();
     }
 
+    // Drains the FIFO when it is due and runs the whole block through the
+    // fixed-point PPG chain. Cheap to call every sensor task run; returns the
+    // latest BPM.
     float readHeartBeat()
     {
-        long irValue = particleSensor.getIR();
-        if (irValue < 20000)
+        if (drainDue())
         {
-            delay(100);
-            return 0;
-        }
-        static float prevIR = 0;
-        float filteredIR = irValue - 0.99 * prevIR;
-        prevIR = irValue;
-
-        if (checkForBeat(filteredIR))
-        {            
-            unsigned long now = millis();
-            unsigned long delta = now - lastBeat;
-            lastBeat = now;
-
-            beatsPerMinute = 60.0 / (delta / 1000.0);
-            if (beatsPerMinute > 30 && beatsPerMinute < 100)
-            {
-                return beatsPerMinute;
-            }
+            lastDrainMs = millis();
+            size_t count = fifo.drain(block, Max30105Fifo::FIFO_DEPTH);
+            PROFILE_SCOPE(STAGE_DSP_BLOCK);
+            pipeline.processBlock(block, count);
         }
 
-        return beatsPerMinute;
+        return pipeline.bpm();
+    }
+
+    // SpO2 from the same blocks (red/IR ratio per beat), 0 without a finger
+    // or before the first good beat window. Call after readHeartBeat().
+    float readSpO2()
+    {
+        return pipeline.hasFinger() ? spo2.spo2() : 0;
     }
 };
 
+// Time after begin() before readings are valid. begin() does not wait it
+// out: the scheduler starts the sensor task this late.
+#ifndef SENSOR_SETTLE_MS
+#define SENSOR_SETTLE_MS 1000
+#endif
+
 class Sensor
 {
 private:
@@ -135,7 +182,6 @@ public:
     bool begin()
     {
         mlx.begin();
-        delay(1000);
         return max.begin();
     }
 
@@ -162,4 +208,9 @@ public:
     {
         return max.readHeartBeat();
     }
+
+    float readSpO2()
+    {
+        return max.readSpO2();
+    }
 };
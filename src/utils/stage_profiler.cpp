@@ -0,0 +1,157 @@
+#include "stage_profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+StageProfiler stageProfiler(systemClock());
+
+static const char *const STAGE_NAMES[STAGE_COUNT] = {"wifi",    "tls",    "token", "mqtt",       "publish",
+                                                     "sensor", "dsp", "sleep", "wake2sleep"};
+
+StageProfiler::StageProfiler(Clock &clock) : clock(clock)
+{
+    reset();
+}
+
+const char *StageProfiler::name(ProfileStage stage)
+{
+    return stage < STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
+
+uint8_t StageProfiler::bucketFor(uint32_t us)
+{
+    uint8_t bucket = 0;
+    while (us > 1 && bucket < PROFILE_BUCKETS - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+uint32_t StageProfiler::elapsedUs(uint32_t fromCycles, uint32_t fromUs)
+{
+    // Cycles are exact for short stretches; micros() takes over before
+    // the counter can wrap
+    uint32_t us = clock.micros() - fromUs;
+    if (us >= PROFILE_CYCLE_LIMIT_US)
+        return us;
+    return (clock.cycles() - fromCycles) / clock.cyclesPerMicro();
+}
+
+void StageProfiler::record(ProfileStage stage, uint32_t us)
+{
+    Histogram &h = stages[stage];
+    h.count++;
+    h.totalUs += us;
+    if (us < h.minUs)
+        h.minUs = us;
+    if (us > h.maxUs)
+        h.maxUs = us;
+
+    uint16_t &bucket = h.buckets[bucketFor(us)];
+    if (bucket != UINT16_MAX)
+        bucket++;
+}
+
+void StageProfiler::start(ProfileStage stage)
+{
+    startCycles[stage] = clock.cycles();
+    startUs[stage] = clock.micros();
+    running |= 1 << stage;
+}
+
+uint32_t StageProfiler::stop(ProfileStage stage)
+{
+    if (!isRunning(stage))
+        return 0;
+    running &= ~(1 << stage);
+    uint32_t us = elapsedUs(startCycles[stage], startUs[stage]);
+    record(stage, us);
+    return us;
+}
+
+uint32_t StageProfiler::percentileUs(ProfileStage stage, float fraction) const
+{
+    const Histogram &h = stages[stage];
+    if (h.count == 0)
+        return 0;
+
+    uint32_t total = 0;
+    for (uint16_t n : h.buckets)
+        total += n;
+
+    uint32_t target = (uint32_t)(fraction * total + 0.5f);
+    if (target == 0)
+        target = 1;
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < PROFILE_BUCKETS; i++)
+    {
+        seen += h.buckets[i];
+        if (seen >= target)
+        {
+            // Bucket edge, but never past the largest value seen
+            uint32_t edge = i + 1 < 32 ? (1UL << (i + 1)) - 1 : UINT32_MAX;
+            return edge < h.maxUs ? edge : h.maxUs;
+        }
+    }
+    return h.maxUs;
+}
+
+void StageProfiler::reset()
+{
+    memset(stages, 0, sizeof(stages));
+    for (Histogram &h : stages)
+        h.minUs = UINT32_MAX;
+    running = 0;
+}
+
+void StageProfiler::print() const
+{
+    HAL_LOG("%-10s %6s %10s %10s %10s %10s  (us)\n", "stage", "count", "min", "p50", "p90", "max");
+    for (uint8_t i = 0; i < STAGE_COUNT; i++)
+    {
+        ProfileStage stage = (ProfileStage)i;
+        const Histogram &h = stages[i];
+        if (h.count == 0)
+            continue;
+
+        HAL_LOG("%-10s %6lu %10lu %10lu %10lu %10lu\n", name(stage), (unsigned long)h.count, (unsigned long)h.minUs,
+                (unsigned long)percentileUs(stage, 0.5f), (unsigned long)percentileUs(stage, 0.9f),
+                (unsigned long)h.maxUs);
+        HAL_LOG("          ");
+        for (uint8_t b = 0; b < PROFILE_BUCKETS; b++)
+        {
+            if (h.buckets[b])
+                HAL_LOG(" >=%lu:%u", (unsigned long)bucketFloorUs(b), h.buckets[b]);
+        }
+        HAL_LOG("\n");
+    }
+}
+
+size_t StageProfiler::formatMetrics(char *out, size_t capacity, const char *firmware) const
+{
+    int used = snprintf(out, capacity, "{\"fw\":\"%s\",\"s\":{", firmware);
+    bool first = true;
+
+    for (uint8_t i = 0; i < STAGE_COUNT && used > 0 && (size_t)used < capacity; i++)
+    {
+        ProfileStage stage = (ProfileStage)i;
+        const Histogram &h = stages[i];
+        if (h.count == 0)
+            continue;
+
+        used += snprintf(out + used, capacity - used, "%s\"%s\":[%lu,%lu,%lu,%lu,%lu]", first ? "" : ",",
+                         name(stage), (unsigned long)h.count, (unsigned long)percentileUs(stage, 0.5f),
+                         (unsigned long)percentileUs(stage, 0.9f), (unsigned long)h.maxUs,
+                         (unsigned long)(h.totalUs / h.count));
+        first = false;
+    }
+
+    if (used > 0 && (size_t)used < capacity)
+        used += snprintf(out + used, capacity - used, "}}");
+    if (used <= 0 || (size_t)used >= capacity)
+        return 0;
+    return (size_t)used;
+}
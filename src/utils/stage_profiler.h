@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../hal/hal.h"
+
+// Histogram buckets per stage: bucket 0 is under 2 us, bucket i holds
+// [2^i, 2^(i+1)) us and the last one everything longer (~67 s and up)
+#ifndef PROFILE_BUCKETS
+#define PROFILE_BUCKETS 27
+#endif
+
+// Past this the cycle counter may have wrapped; micros() is used instead
+#ifndef PROFILE_CYCLE_LIMIT_US
+#define PROFILE_CYCLE_LIMIT_US 20000000UL
+#endif
+
+enum ProfileStage : uint8_t
+{
+    STAGE_WIFI_JOIN,
+    STAGE_TLS_HANDSHAKE,
+    STAGE_TOKEN,
+    STAGE_MQTT_CONNECT, // TLS handshake included
+    STAGE_PUBLISH,
+    STAGE_SENSOR_READ,
+    STAGE_DSP_BLOCK,
+    STAGE_SLEEP_ENTRY,
+    STAGE_WAKE_TO_SLEEP,
+    STAGE_COUNT
+};
+
+// Latency of each wake-cycle stage since boot, as fixed log2 histograms
+// fed from the CPU cycle counter. Recording is a few adds; nothing is
+// formatted until print() or formatMetrics() is asked for.
+class StageProfiler
+{
+public:
+    struct Histogram
+    {
+        uint32_t count;
+        uint32_t minUs;
+        uint32_t maxUs;
+        uint64_t totalUs;
+        uint16_t buckets[PROFILE_BUCKETS]; // Saturate at 65535
+    };
+
+private:
+    Clock &clock;
+    Histogram stages[STAGE_COUNT];
+    uint32_t startCycles[STAGE_COUNT];
+    uint32_t startUs[STAGE_COUNT];
+    uint16_t running = 0; // Bit per stage between start() and stop()
+
+public:
+    explicit StageProfiler(Clock &clock = systemClock());
+
+    static const char *name(ProfileStage stage);
+    static uint8_t bucketFor(uint32_t us);
+    // Smallest value bucket i holds
+    static uint32_t bucketFloorUs(uint8_t bucket) { return bucket == 0 ? 0 : 1UL << bucket; }
+
+    // Elapsed time between two stamps of the same stretch
+    uint32_t elapsedUs(uint32_t fromCycles, uint32_t fromUs);
+
+    void record(ProfileStage stage, uint32_t us);
+
+    // For stages that span calls or tasks (Wi-Fi join). stop() without a
+    // start() is ignored, so it is safe on paths taken more than once.
+    // Returns the recorded time, 0 if the stage was not running.
+    void start(ProfileStage stage);
+    uint32_t stop(ProfileStage stage);
+    bool isRunning(ProfileStage stage) const { return (running >> stage) & 1; }
+
+    const Histogram &histogram(ProfileStage stage) const { return stages[stage]; }
+    // Upper edge of the bucket holding the given fraction of samples
+    uint32_t percentileUs(ProfileStage stage, float fraction) const;
+
+    void reset();
+
+    // One line per stage with samples: count, min, p50, p90, max, and the
+    // non-empty buckets
+    void print() const;
+
+    // Compact JSON for a metrics message:
+    // {"fw":..,"s":{"wifi":[count,p50,p90,max,mean],..}} in us. Returns
+    // the length, 0 if it did not fit.
+    size_t formatMetrics(char *out, size_t capacity, const char *firmware) const;
+
+    // Times one scope into a stage
+    class Probe
+    {
+    private:
+        StageProfiler &profiler;
+        ProfileStage stage;
+        uint32_t cycles;
+        uint32_t us;
+
+    public:
+        Probe(StageProfiler &profiler, ProfileStage stage)
+            : profiler(profiler), stage(stage), cycles(profiler.clock.cycles()), us(profiler.clock.micros())
+        {
+        }
+        ~Probe() { profiler.record(stage, profiler.elapsedUs(cycles, us)); }
+    };
+};
+
+extern StageProfiler stageProfiler;
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// Times the rest of the enclosing scope into a stage
+#define PROFILE_SCOPE(stage) StageProfiler::Probe PROFILE_CONCAT(profileProbe, __LINE__)(stageProfiler, stage)
@@ -0,0 +1,67 @@
+#include "trace.h"
+
+static_assert(sizeof(TraceRecord) == 24, "decode_trace.py expects 24-byte records");
+static_assert(sizeof(TraceBuffer::DumpHeader) == 16, "decode_trace.py expects a 16-byte header");
+
+TraceBuffer traceBuffer(systemClock());
+
+const TraceRecord &TraceBuffer::at(uint32_t i) const
+{
+    uint32_t first = head - size();
+    return records[(first + i) % TRACE_BUFFER_RECORDS];
+}
+
+TraceBuffer::DumpHeader TraceBuffer::header(uint32_t count)
+{
+    uint32_t first = head - size();
+    uint32_t dropped = first > lastDumped ? first - lastDumped : 0;
+    lastDumped = head;
+    return {DUMP_MAGIC, (uint16_t)sizeof(TraceRecord), (uint16_t)count, dropped, clock.millis()};
+}
+
+size_t TraceBuffer::dump(uint8_t *out, size_t capacity, uint32_t &from)
+{
+    if (from >= size() || capacity < sizeof(DumpHeader) + sizeof(TraceRecord))
+        return 0;
+
+    uint32_t count = size() - from;
+    uint32_t fits = (uint32_t)((capacity - sizeof(DumpHeader)) / sizeof(TraceRecord));
+    if (count > fits)
+        count = fits;
+
+    // Only the first chunk reports the records lost since the last dump
+    DumpHeader chunk = header(count);
+    if (from > 0)
+        chunk.dropped = 0;
+    memcpy(out, &chunk, sizeof(chunk));
+    for (uint32_t i = 0; i < count; i++)
+        memcpy(out + sizeof(chunk) + i * sizeof(TraceRecord), &at(from + i), sizeof(TraceRecord));
+
+    from += count;
+    return sizeof(chunk) + count * sizeof(TraceRecord);
+}
+
+void TraceBuffer::dumpHex(void (*writeLine)(const char *line))
+{
+    static const char digits[] = "0123456789abcdef";
+    uint32_t count = size();
+    DumpHeader first = header(count);
+
+    // One line for the header, one per record: no dump-sized buffer needed
+    char line[8 + 2 * sizeof(TraceRecord) + 1];
+    memcpy(line, "TRACE ", 6);
+    auto emit = [&](const void *data, size_t length) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        for (size_t i = 0; i < length; i++)
+        {
+            line[6 + i * 2] = digits[bytes[i] >> 4];
+            line[7 + i * 2] = digits[bytes[i] & 0x0F];
+        }
+        line[6 + length * 2] = '\0';
+        writeLine(line);
+    };
+
+    emit(&first, sizeof(first));
+    for (uint32_t i = 0; i < count; i++)
+        emit(&at(i), sizeof(TraceRecord));
+}
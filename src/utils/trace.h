@@ -0,0 +1,176 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+#include "../hal/hal.h"
+
+// Levels: an event is kept when its level is at or below TRACE_LEVEL
+#define TRACE_LEVEL_OFF 0
+#define TRACE_LEVEL_ERROR 1
+#define TRACE_LEVEL_WARN 2
+#define TRACE_LEVEL_INFO 3
+#define TRACE_LEVEL_DEBUG 4
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LEVEL_INFO
+#endif
+
+// Modules, as a bit mask in TRACE_MODULES
+#define TRACE_MODULE_JOB 0x01
+#define TRACE_MODULE_MQTT 0x02
+#define TRACE_MODULE_SEND 0x04
+#define TRACE_MODULE_MEM 0x08
+
+#ifndef TRACE_MODULES
+#define TRACE_MODULES 0xFF
+#endif
+
+// Records kept in RAM; the oldest is overwritten when full
+#ifndef TRACE_BUFFER_RECORDS
+#define TRACE_BUFFER_RECORDS 64
+#endif
+
+#define TRACE_MAX_ARGS 4
+
+enum TraceEvent : uint16_t
+{
+#define TRACE_EVENT(name, module, level, format) TRACE_##name,
+#include "trace_events.def"
+#undef TRACE_EVENT
+    TRACE_EVENT_COUNT
+};
+
+// Whether an event survives TRACE_LEVEL and TRACE_MODULES, known at compile
+// time so a disabled TRACE() is removed along with its arguments
+constexpr bool traceEnabled(TraceEvent event)
+{
+    constexpr bool enabled[] = {
+#define TRACE_EVENT(name, module, level, format) \
+    (TRACE_LEVEL_##level <= TRACE_LEVEL && (TRACE_MODULES & TRACE_MODULE_##module) != 0),
+#include "trace_events.def"
+#undef TRACE_EVENT
+        false};
+    return enabled[event];
+}
+
+// Argument types, two bits each in TraceRecord::types
+enum TraceArgType : uint8_t
+{
+    TRACE_ARG_INT = 0,
+    TRACE_ARG_UINT = 1,
+    TRACE_ARG_FLOAT = 2
+};
+
+// 24 bytes on the wire and in RAM, little endian
+struct TraceRecord
+{
+    uint32_t timestampMs;
+    uint16_t event;
+    uint8_t count; // Arguments used
+    uint8_t types;
+    uint32_t args[TRACE_MAX_ARGS];
+};
+
+// Ring of binary trace records. record() costs a few stores instead of a
+// formatted UART write; the ring is read out on demand with dump() and
+// turned back into text on the host by scripts/decode_trace.py. Not safe
+// to call from interrupts.
+class TraceBuffer
+{
+public:
+    // Dump header, followed by count records oldest first
+    struct DumpHeader
+    {
+        uint32_t magic; // "TRC1"
+        uint16_t recordSize;
+        uint16_t count;
+        uint32_t dropped; // Overwritten since the last dump
+        uint32_t nowMs;
+    };
+    static const uint32_t DUMP_MAGIC = 0x31435254;
+
+private:
+    Clock &clock;
+    TraceRecord records[TRACE_BUFFER_RECORDS];
+    uint32_t head = 0; // Records written since boot
+    uint32_t lastDumped = 0; // head at the last dump
+
+    DumpHeader header(uint32_t count);
+
+    template <typename T>
+    static void put(TraceRecord &record, T value)
+    {
+        TraceArgType type;
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            float narrowed = (float)value;
+            memcpy(&record.args[record.count], &narrowed, sizeof(narrowed));
+            type = TRACE_ARG_FLOAT;
+        }
+        else
+        {
+            record.args[record.count] = (uint32_t)value;
+            type = std::is_signed<T>::value ? TRACE_ARG_INT : TRACE_ARG_UINT;
+        }
+        record.types |= type << (record.count++ * 2);
+    }
+
+    static void putAll(TraceRecord &) {}
+    template <typename T, typename... Rest>
+    static void putAll(TraceRecord &record, T value, Rest... rest)
+    {
+        put(record, value);
+        putAll(record, rest...);
+    }
+
+public:
+    explicit TraceBuffer(Clock &clock = systemClock()) : clock(clock) {}
+
+    template <typename... Args>
+    void record(TraceEvent event, Args... args)
+    {
+        static_assert(sizeof...(Args) <= TRACE_MAX_ARGS, "too many trace arguments");
+        TraceRecord &slot = records[head % TRACE_BUFFER_RECORDS];
+        slot.timestampMs = clock.millis();
+        slot.event = event;
+        slot.count = 0;
+        slot.types = 0;
+        putAll(slot, args...);
+        head++;
+    }
+
+    // Records still in the ring, oldest first
+    uint32_t size() const { return head < TRACE_BUFFER_RECORDS ? head : TRACE_BUFFER_RECORDS; }
+    uint32_t written() const { return head; }
+    const TraceRecord &at(uint32_t i) const;
+
+    // Header plus as many records as fit, starting at ring index from
+    // (0 = oldest), into out. from is advanced past the records written;
+    // call again until it returns 0 to dump the whole ring in chunks.
+    size_t dump(uint8_t *out, size_t capacity, uint32_t &from);
+
+    // The whole ring as hex lines ("TRACE <hex>"), the header and then one
+    // record a line, through a line writer (Serial.println on the board)
+    void dumpHex(void (*writeLine)(const char *line));
+
+    void clear() { head = 0; }
+};
+
+extern TraceBuffer traceBuffer;
+
+#if TRACE_LEVEL > TRACE_LEVEL_OFF
+#define TRACE(name, ...)                                            \
+    do                                                              \
+    {                                                               \
+        if (traceEnabled(TRACE_##name))                             \
+            traceBuffer.record(TRACE_##name, ##__VA_ARGS__);        \
+    } while (0)
+#else
+#define TRACE(name, ...) \
+    do                   \
+    {                    \
+    } while (0)
+#endif